@@ -0,0 +1,101 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "sha256.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t const sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t rotr(uint32_t const x, unsigned const n)
+{
+	return x >> n | x << (32 - n);
+}
+
+void sha256_init(sha256_t *const h)
+{
+	static uint32_t const initial[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+	memcpy(h->state, initial, sizeof(h->state));
+	h->length = 0;
+}
+
+static void sha256_block(sha256_t *const h)
+{
+	uint32_t w[64];
+	for (unsigned i = 0; i < 16; ++i) {
+		unsigned char const *const b = &h->block[i * 4];
+		w[i] = (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16
+		     | (uint32_t)b[2] << 8  | (uint32_t)b[3];
+	}
+	for (unsigned i = 16; i < 64; ++i) {
+		uint32_t const s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ w[i-15] >> 3;
+		uint32_t const s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ w[i-2] >> 10;
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	uint32_t v[8];
+	memcpy(v, h->state, sizeof(v));
+	for (unsigned i = 0; i < 64; ++i) {
+		uint32_t const s1  = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+		uint32_t const ch  = (v[4] & v[5]) ^ (~v[4] & v[6]);
+		uint32_t const t1  = v[7] + s1 + ch + sha256_k[i] + w[i];
+		uint32_t const s0  = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+		uint32_t const maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+		memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+		v[4] += t1;
+		v[0]  = t1 + s0 + maj;
+	}
+	for (unsigned i = 0; i < 8; ++i) {
+		h->state[i] += v[i];
+	}
+}
+
+void sha256_add(sha256_t *const h, void const *const data, size_t const size)
+{
+	unsigned char const *p = (unsigned char const*)data;
+	for (size_t i = 0; i < size; ++i) {
+		h->block[h->length++ % 64] = p[i];
+		if (h->length % 64 == 0)
+			sha256_block(h);
+	}
+}
+
+void sha256_add_string(sha256_t *const h, char const *const string)
+{
+	/* include the terminator to keep consecutive strings apart */
+	sha256_add(h, string, strlen(string) + 1);
+}
+
+void sha256_finish(sha256_t *const h, char hex[65])
+{
+	unsigned long long const bits = h->length * 8;
+	unsigned char const      one  = 0x80;
+	unsigned char const      zero = 0;
+	sha256_add(h, &one, 1);
+	while (h->length % 64 != 56)
+		sha256_add(h, &zero, 1);
+	for (unsigned i = 8; i-- > 0;) {
+		unsigned char const b = (unsigned char)(bits >> (i * 8));
+		sha256_add(h, &b, 1);
+	}
+	for (unsigned i = 0; i < 8; ++i) {
+		snprintf(&hex[i * 8], 9, "%08x", (unsigned)h->state[i]);
+	}
+}
@@ -0,0 +1,32 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief SHA-256 message digest, used to key cached compilation results
+ */
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct sha256_t {
+	uint32_t           state[8];
+	unsigned long long length;
+	unsigned char      block[64];
+} sha256_t;
+
+void sha256_init(sha256_t *h);
+
+void sha256_add(sha256_t *h, void const *data, size_t size);
+
+/** Adds a string including its terminator. */
+void sha256_add_string(sha256_t *h, char const *string);
+
+/** Finishes the digest and writes it as 64 hex digits and a terminator. */
+void sha256_finish(sha256_t *h, char hex[65]);
+
+#endif
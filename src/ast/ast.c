@@ -37,11 +37,13 @@
 #include "type_t.h"
 #include "types.h"
 
-c_dialect_t dialect = {
+static c_dialect_t const default_dialect = {
 	.char_is_signed = true,
 	.long_long_size = 8,
 };
 
+c_dialect_t dialect;
+
 struct obstack ast_obstack;
 
 static int indent;
@@ -1160,6 +1162,16 @@ void print_initializer(const initializer_t *initializer)
 		print_designator(initializer->designator.designator);
 		print_string(" = ");
 		return;
+
+	case INITIALIZER_DATA: {
+		const initializer_data_t *data = &initializer->data;
+		for (size_t i = 0; i < data->len; ++i) {
+			if (i > 0)
+				print_string(", ");
+			print_format("%llu", get_init_data_value(data, i));
+		}
+		return;
+	}
 	}
 
 	panic("invalid initializer kind found");
@@ -1427,6 +1439,7 @@ expression_classification_t is_constant_initializer(const initializer_t *initial
 	switch (initializer->kind) {
 	case INITIALIZER_STRING:
 	case INITIALIZER_DESIGNATOR:
+	case INITIALIZER_DATA:
 		return EXPR_CLASS_CONSTANT;
 
 	case INITIALIZER_VALUE:
@@ -2021,6 +2034,9 @@ gnu_c90_inline:
 
 void init_ast(void)
 {
+	dialect              = default_dialect;
+	print_implicit_casts = false;
+	print_parenthesis    = false;
 	obstack_init(&ast_obstack);
 	init_typehash();
 }
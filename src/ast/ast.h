@@ -42,6 +42,7 @@ typedef struct initializer_base_t                    initializer_base_t;
 typedef struct initializer_list_t                    initializer_list_t;
 typedef struct initializer_value_t                   initializer_value_t;
 typedef struct initializer_designator_t              initializer_designator_t;
+typedef struct initializer_data_t                    initializer_data_t;
 typedef union  initializer_t                         initializer_t;
 
 typedef struct statement_base_t                      statement_base_t;
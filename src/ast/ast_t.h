@@ -413,7 +413,8 @@ typedef enum initializer_kind_t {
 	INITIALIZER_VALUE,
 	INITIALIZER_LIST,
 	INITIALIZER_STRING,
-	INITIALIZER_DESIGNATOR
+	INITIALIZER_DESIGNATOR,
+	INITIALIZER_DATA
 } initializer_kind_t;
 
 struct initializer_base_t {
@@ -437,12 +438,26 @@ struct initializer_designator_t {
 	designator_t       *designator;
 };
 
+/**
+ * A run of consecutive array elements of integer type, which are all
+ * initialized by integer literals. Large constant tables use this instead of
+ * an expression and an initializer per element.
+ */
+struct initializer_data_t {
+	initializer_base_t   base;
+	type_t              *type;         /**< the element type */
+	size_t               len;          /**< number of elements */
+	unsigned             element_size; /**< bytes per element in data */
+	unsigned char const *data;        /**< little endian element values */
+};
+
 union initializer_t {
 	initializer_kind_t       kind;
 	initializer_base_t       base;
 	initializer_value_t      value;
 	initializer_list_t       list;
 	initializer_designator_t designator;
+	initializer_data_t       data;
 };
 
 static inline string_literal_expression_t const *get_init_string(initializer_t const *const init)
@@ -452,6 +467,17 @@ static inline string_literal_expression_t const *get_init_string(initializer_t c
 	return &init->value.value->string_literal;
 }
 
+static inline unsigned long long get_init_data_value(initializer_data_t const *const data, size_t const i)
+{
+	assert(i < data->len);
+	unsigned char const *const p     = &data->data[i * data->element_size];
+	unsigned long long         value = 0;
+	for (unsigned b = data->element_size; b-- != 0;) {
+		value = value << 8 | p[b];
+	}
+	return value;
+}
+
 /**
  * The statement kinds.
  */
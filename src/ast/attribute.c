@@ -8,6 +8,7 @@
 #include "adt/bitfiddle.h"
 #include "adt/panic.h"
 #include "adt/strutil.h"
+#include "adt/util.h"
 #include "ast_t.h"
 #include "attribute_t.h"
 #include "constfold.h"
@@ -27,6 +28,7 @@ static const char *const attribute_names[ATTRIBUTE_LAST+1] = {
 	[ATTRIBUTE_GNU_ALLOC_SIZE]             = "alloc_size",
 	[ATTRIBUTE_GNU_ALWAYS_INLINE]          = "always_inline",
 	[ATTRIBUTE_GNU_CDECL]                  = "cdecl",
+	[ATTRIBUTE_GNU_COLD]                   = "cold",
 	[ATTRIBUTE_GNU_COMMON]                 = "common",
 	[ATTRIBUTE_GNU_CONST]                  = "const",
 	[ATTRIBUTE_GNU_CONSTRUCTOR]            = "constructor",
@@ -44,6 +46,7 @@ static const char *const attribute_names[ATTRIBUTE_LAST+1] = {
 	[ATTRIBUTE_GNU_FUNCTION_VECTOR]        = "function_vector",
 	[ATTRIBUTE_GNU_GCC_STRUCT]             = "gcc_struct",
 	[ATTRIBUTE_GNU_GNU_INLINE]             = "gnu_inline",
+	[ATTRIBUTE_GNU_HOT]                    = "hot",
 	[ATTRIBUTE_GNU_INTERRUPT_HANDLER]      = "interrupt_handler",
 	[ATTRIBUTE_GNU_INTERRUPT]              = "interrupt",
 	[ATTRIBUTE_GNU_LEAF]                   = "leaf",
@@ -65,6 +68,7 @@ static const char *const attribute_names[ATTRIBUTE_LAST+1] = {
 	[ATTRIBUTE_GNU_NORETURN]               = "noreturn",
 	[ATTRIBUTE_GNU_NOTHROW]                = "nothrow",
 	[ATTRIBUTE_GNU_NOTSHARED]              = "notshared",
+	[ATTRIBUTE_GNU_OPTIMIZE]               = "optimize",
 	[ATTRIBUTE_GNU_PACKED]                 = "packed",
 	[ATTRIBUTE_GNU_PURE]                   = "pure",
 	[ATTRIBUTE_GNU_REGPARM]                = "regparm",
@@ -241,6 +245,59 @@ static void handle_attribute_visibility(const attribute_t *attribute,
 	}
 }
 
+int get_optimize_level(char const *string)
+{
+	/* accept "-O2", "O2" and "2" */
+	if (string[0] == '-')
+		++string;
+	if (string[0] == 'O')
+		++string;
+	if (string[0] == '\0')
+		return 1;
+	if (is_digit(string[0]) && string[1] == '\0')
+		return MIN(string[0] - '0', 3);
+	if (streq(string, "s") || streq(string, "z"))
+		return 2;
+	if (streq(string, "fast"))
+		return 3;
+	if (streq(string, "g"))
+		return 0;
+	return -1;
+}
+
+static void handle_attribute_optimize(const attribute_t *attribute,
+                                      entity_t *entity)
+{
+	string_t const *const string = get_argument_string(attribute->a.arguments);
+	if (string == NULL) {
+		errorf(&attribute->pos, "__attribute__((optimize(X))) requires a string argument");
+		return;
+	}
+	int const level = get_optimize_level(string->begin);
+	if (level < 0) {
+		warningf(WARN_OTHER, &attribute->pos, "unsupported optimization level '%S' ignored", string);
+		return;
+	}
+
+	if (entity->kind != ENTITY_FUNCTION) {
+		warningf(WARN_OTHER, &attribute->pos, "optimize attribute specification on '%N' ignored", entity);
+		return;
+	}
+	entity->function.optimize = level + 1;
+}
+
+static void handle_attribute_hotness(const attribute_t *attribute,
+                                     entity_t *entity)
+{
+	bool const is_hot = attribute->kind == ATTRIBUTE_GNU_HOT;
+	if (entity->kind != ENTITY_FUNCTION) {
+		warningf(WARN_OTHER, &attribute->pos, "%s attribute specification on '%N' ignored", is_hot ? "hot" : "cold", entity);
+		return;
+	}
+	entity->function.is_hot  =  is_hot;
+	entity->function.is_cold = !is_hot;
+}
+
 static void warn_arguments(const attribute_t *attribute)
 {
 	if (attribute->a.arguments == NULL)
@@ -392,6 +449,15 @@ void handle_entity_attributes(const attribute_t *attributes, entity_t *entity)
 			handle_attribute_visibility(attribute, entity);
 			break;
 
+		case ATTRIBUTE_GNU_OPTIMIZE:
+			handle_attribute_optimize(attribute, entity);
+			break;
+
+		case ATTRIBUTE_GNU_COLD:
+		case ATTRIBUTE_GNU_HOT:
+			handle_attribute_hotness(attribute, entity);
+			break;
+
 		case ATTRIBUTE_MS_ALIGN:
 		case ATTRIBUTE_GNU_ALIGNED:
 			handle_attribute_aligned(attribute, entity);
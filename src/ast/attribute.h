@@ -17,6 +17,14 @@ type_t *handle_type_attributes(const attribute_t *attributes, type_t *type);
 void handle_entity_attributes(const attribute_t *attributes, entity_t *entity);
 type_t *handle_attribute_mode(const attribute_t *attribute, type_t *orig_type);
 
+/**
+ * Interpret an argument of attribute((optimize)) or #pragma GCC optimize like
+ * the -O switch, e.g. "O2" or "-Os".
+ *
+ * @return the optimization level 0-3 or -1 if the string is not understood
+ */
+int get_optimize_level(char const *string);
+
 /** array of entities using attribute((alias())) */
 extern entity_t **alias_entities;
 
@@ -23,6 +23,7 @@ typedef enum attribute_kind_t {
 	ATTRIBUTE_GNU_ALWAYS_INLINE,
 	ATTRIBUTE_GNU_ASM,
 	ATTRIBUTE_GNU_CDECL,
+	ATTRIBUTE_GNU_COLD,
 	ATTRIBUTE_GNU_COMMON,
 	ATTRIBUTE_GNU_CONST,
 	ATTRIBUTE_GNU_CONSTRUCTOR,
@@ -40,6 +41,7 @@ typedef enum attribute_kind_t {
 	ATTRIBUTE_GNU_FUNCTION_VECTOR,
 	ATTRIBUTE_GNU_GCC_STRUCT,
 	ATTRIBUTE_GNU_GNU_INLINE,
+	ATTRIBUTE_GNU_HOT,
 	ATTRIBUTE_GNU_INTERRUPT,
 	ATTRIBUTE_GNU_INTERRUPT_HANDLER,
 	ATTRIBUTE_GNU_LEAF,
@@ -61,6 +63,7 @@ typedef enum attribute_kind_t {
 	ATTRIBUTE_GNU_NORETURN,
 	ATTRIBUTE_GNU_NOTHROW,
 	ATTRIBUTE_GNU_NOTSHARED,
+	ATTRIBUTE_GNU_OPTIMIZE,
 	ATTRIBUTE_GNU_PACKED,
 	ATTRIBUTE_GNU_PURE,
 	ATTRIBUTE_GNU_REGPARM,
@@ -37,6 +37,9 @@ typedef struct c_dialect_t {
 	bool               gnu            : 1;
 	bool               ms             : 1;
 	bool               long_double_x87_80bit_float : 1;
+	/** the target does not reorder loads with loads or stores with stores,
+	 * which the lowering of ordered atomic operations relies on */
+	bool               total_store_order : 1;
 	/** enable hack to add call to __main into the main function (mingw) */
 	bool enable_main_collect2_hack : 1;
 	unsigned char      long_double_size;
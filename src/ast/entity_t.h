@@ -59,6 +59,14 @@ typedef enum elf_visibility_t {
 typedef enum {
 	BUILTIN_NONE = 0,
 	BUILTIN_ALLOCA,
+	BUILTIN_ASSUME_ALIGNED,
+	BUILTIN_ATOMIC_COMPARE_EXCHANGE,
+	BUILTIN_ATOMIC_EXCHANGE,
+	BUILTIN_ATOMIC_FENCE,
+	BUILTIN_ATOMIC_FETCH_OP,
+	BUILTIN_ATOMIC_LOAD,
+	BUILTIN_ATOMIC_OP_FETCH,
+	BUILTIN_ATOMIC_STORE,
 	BUILTIN_CIMAG,
 	BUILTIN_CREAL,
 	BUILTIN_EXPECT,
@@ -70,9 +78,21 @@ typedef enum {
 	BUILTIN_OBJECT_SIZE,
 	BUILTIN_ROTL,
 	BUILTIN_ROTR,
+	BUILTIN_SYNC_BOOL_COMPARE_SWAP,
+	BUILTIN_UNREACHABLE,
 	BUILTIN_VA_END,
 } builtin_kind_t;
 
+/** The operation of BUILTIN_ATOMIC_FETCH_OP and BUILTIN_ATOMIC_OP_FETCH. */
+typedef enum {
+	ATOMIC_OP_ADD,
+	ATOMIC_OP_SUB,
+	ATOMIC_OP_AND,
+	ATOMIC_OP_OR,
+	ATOMIC_OP_XOR,
+	ATOMIC_OP_NAND,
+} atomic_op_t;
+
 /**
  * A scope containing entities.
  */
@@ -217,6 +237,11 @@ struct function_t {
 	ENUMBF(elf_visibility_t) elf_visibility   : 3;
 	/** builtin is library, this means you can safely take its address */
 	bool                     builtin_in_lib   : 1;
+	bool                     is_cold          : 1; /**< attribute((cold)) */
+	bool                     is_hot           : 1; /**< attribute((hot)) */
+	/** optimization level + 1 from attribute((optimize)) or #pragma GCC
+	 * optimize, 0 to use the global level */
+	unsigned                 optimize         : 3;
 	scope_t        parameters;
 	statement_t   *body;
 	symbol_t      *actual_name;        /**< gnu extension __REDIRECT */
@@ -229,6 +254,7 @@ struct function_t {
 	union {
 		ir_builtin_kind firm_builtin_kind;
 		unsigned        chk_arg_pos;
+		atomic_op_t     atomic_op;
 	} b;
 	ir_entity *irentity;
 };
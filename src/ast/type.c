@@ -215,6 +215,10 @@ void print_type_qualifiers(type_qualifiers_t const qualifiers, QualifierSeparato
 		print_string(&" restrict"[sep]);
 		sep = 0;
 	}
+	if (qualifiers & TYPE_QUALIFIER_ATOMIC) {
+		print_string(&" _Atomic"[sep]);
+		sep = 0;
+	}
 	if (sep == 0 && q & QUAL_SEP_END)
 		print_char(' ');
 }
@@ -47,12 +47,13 @@ typedef enum type_qualifiers_t {
 	TYPE_QUALIFIER_CONST    = 1 << 0,
 	TYPE_QUALIFIER_RESTRICT = 1 << 1,
 	TYPE_QUALIFIER_VOLATILE = 1 << 2,
+	TYPE_QUALIFIER_ATOMIC   = 1 << 3,
 	/* microsoft extended qualifiers */
-	TYPE_QUALIFIER_W64      = 1 << 3,
-	TYPE_QUALIFIER_PTR32    = 1 << 4,
-	TYPE_QUALIFIER_PTR64    = 1 << 5,
-	TYPE_QUALIFIER_SPTR     = 1 << 6,
-	TYPE_QUALIFIER_UPTR     = 1 << 7,
+	TYPE_QUALIFIER_W64      = 1 << 4,
+	TYPE_QUALIFIER_PTR32    = 1 << 5,
+	TYPE_QUALIFIER_PTR64    = 1 << 6,
+	TYPE_QUALIFIER_SPTR     = 1 << 7,
+	TYPE_QUALIFIER_UPTR     = 1 << 8,
 } type_qualifiers_t;
 
 typedef struct type_base_t          type_base_t;
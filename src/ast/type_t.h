@@ -34,7 +34,7 @@ typedef enum type_kind_t {
 
 struct type_base_t {
 	ENUMBF(type_kind_t)       kind       : 8;
-	ENUMBF(type_qualifiers_t) qualifiers : 8;
+	ENUMBF(type_qualifiers_t) qualifiers : 9;
 
 	/* cached ast2firm infos */
 	ir_type *firm_type;
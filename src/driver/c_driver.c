@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <libfirm/statev.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -21,13 +22,19 @@
 #include "ast/printer.h"
 #include "ast/types.h"
 #include "ast/type_t.h"
+#include "cache.h"
 #include "diagnostic.h"
 #include "driver_t.h"
 #include "firm/ast2firm.h"
+#include "firm/binary_ir.h"
 #include "firm/firm_opt.h"
+#include "firm/function_cache.h"
+#include "firm/lto.h"
 #include "parser/parser.h"
 #include "parser/preprocessor.h"
+#include "parser/vfs_pack.h"
 #include "predefs.h"
+#include "subprocess.h"
 #include "target.h"
 #include "timing.h"
 #include "version.h"
@@ -86,6 +93,13 @@ const char     *dumpfunction;
 const char     *isysroot;
 const char     *lsysroot;
 const char     *print_file_name_file;
+bool            driver_lto;
+bool            driver_whole_program;
+bool            driver_link_shared;
+bool            driver_ir_text;
+
+/** Unit whose IR is kept in the program to be optimized when linking. */
+static compilation_unit_t *lto_unit;
 
 typedef struct define_t {
 	bool        is_define;
@@ -397,6 +411,7 @@ static bool run_external_preprocessor(compilation_env_t *env,
 		const char *dep_target_name = get_dependency_filename(env, unit);
 		driver_add_flag(&cppflags_obst, "-MF");
 		driver_add_flag(&cppflags_obst, dep_target_name);
+		unit->dependencies_written = true;
 	}
 	assert(unit->input == NULL);
 	driver_add_flag(&cppflags_obst, unit->name);
@@ -405,7 +420,7 @@ static bool run_external_preprocessor(compilation_env_t *env,
 	if (driver_verbose) {
 		puts(commandline);
 	}
-	FILE *f = popen(commandline, "r");
+	FILE *f = open_command_pipe(commandline, false);
 	if (f == NULL) {
 		position_t const pos = { unit->name, 0, 0, 0 };
 		errorf(&pos, "invoking preprocessor failed");
@@ -452,7 +467,12 @@ static void decide_assembler(void)
 	driver_assembler = obstack_nul_finish(&file_obst);
 }
 
-static bool assemble(compilation_unit_t *unit, const char *o_name)
+/**
+ * Builds the command line assembling @p input ("-" for stdin) into
+ * @p o_name on asflags_obst.
+ */
+static char *get_assembler_commandline(char const *const input,
+                                       char const *const o_name)
 {
 	if (!asflags)
 		asflags = obstack_nul_finish(&asflags_obst);
@@ -462,13 +482,21 @@ static bool assemble(compilation_unit_t *unit, const char *o_name)
 	if (asflags[0] != '\0')
 		obstack_printf(&asflags_obst, " %s", asflags);
 
-	obstack_printf(&asflags_obst, " %s -o %s", unit->name, o_name);
+	driver_add_flag(&asflags_obst, "%s", input);
+	driver_add_flag(&asflags_obst, "-o");
+	driver_add_flag(&asflags_obst, "%s", o_name);
 
 	char *const commandline = obstack_nul_finish(&asflags_obst);
 	if (driver_verbose) {
 		puts(commandline);
 	}
-	int err = system(commandline);
+	return commandline;
+}
+
+static bool assemble(compilation_unit_t *unit, const char *o_name)
+{
+	char *const commandline = get_assembler_commandline(unit->name, o_name);
+	int err = run_command(commandline);
 	if (err != EXIT_SUCCESS) {
 		position_t const pos = { unit->name, 0, 0, 0 };
 		errorf(&pos, "assembler reported an error");
@@ -476,29 +504,44 @@ static bool assemble(compilation_unit_t *unit, const char *o_name)
 		return false;
 	}
 	obstack_free(&asflags_obst, commandline);
+	cache_store(o_name);
 	unit->type = COMPILATION_UNIT_OBJECT;
 	unit->name = o_name;
 	return true;
 }
 
-bool assemble_final(compilation_env_t *env, compilation_unit_t *unit)
+static const char *get_final_object_name(compilation_env_t *env,
+                                         compilation_unit_t *unit)
 {
 	const char *outname = env->outname;
 	if (outname == NULL) {
 		outname = get_output_name(unit->original_name, ".o");
 	}
-	return assemble(unit, outname);
+	return outname;
 }
 
-bool assemble_intermediate(compilation_env_t *env, compilation_unit_t *unit)
+static const char *get_intermediate_object_name(compilation_unit_t *unit)
 {
-	(void)env;
 	const char *o_name;
 	FILE *tempf = open_temp_file(unit->name, ".o", &o_name);
 	if (tempf == NULL)
 		return NULL;
 	/* hackish... */
 	fclose(tempf);
+	return o_name;
+}
+
+bool assemble_final(compilation_env_t *env, compilation_unit_t *unit)
+{
+	return assemble(unit, get_final_object_name(env, unit));
+}
+
+bool assemble_intermediate(compilation_env_t *env, compilation_unit_t *unit)
+{
+	(void)env;
+	const char *o_name = get_intermediate_object_name(unit);
+	if (o_name == NULL)
+		return false;
 	return assemble(unit, o_name);
 }
 
@@ -578,7 +621,84 @@ static bool start_preprocessing(compilation_env_t *env,
 	return true;
 }
 
-static bool preprocess(compilation_env_t *env, compilation_unit_t *unit)
+/**
+ * Returns the extension of the file the handler chain produces from @p unit
+ * if it may be taken from the compilation cache, NULL otherwise.
+ */
+static char const *get_cacheable_extension(compilation_unit_t const *unit)
+{
+	compilation_unit_type_t tokens;
+	switch (unit->type) {
+	case COMPILATION_UNIT_C:   tokens = COMPILATION_UNIT_LEXER_TOKENS_C;   break;
+	case COMPILATION_UNIT_CXX: tokens = COMPILATION_UNIT_LEXER_TOKENS_CXX; break;
+	default:                   return NULL;
+	}
+	/* profiles are read from outside the translation unit */
+	if (streq(unit->name, "-") || profile_use || !cache_enabled())
+		return NULL;
+	if (get_unit_handler(tokens) != do_parsing || get_unit_stop_after(tokens)
+	 || get_unit_handler(COMPILATION_UNIT_AST) != build_firm_ir
+	 || get_unit_stop_after(COMPILATION_UNIT_AST))
+		return NULL;
+
+	compilation_unit_type_t const ir
+		= COMPILATION_UNIT_INTERMEDIATE_REPRESENTATION;
+	compilation_unit_handler const codegen = get_unit_handler(ir);
+	if (codegen == generate_code_final)
+		return ".s";
+	if (codegen != generate_code_intermediate || get_unit_stop_after(ir))
+		return NULL;
+	compilation_unit_handler const assembler
+		= get_unit_handler(COMPILATION_UNIT_PREPROCESSED_ASSEMBLER);
+	if (assembler == assemble_final
+	 || (assembler == assemble_intermediate && !driver_lto))
+		return ".o";
+	return NULL;
+}
+
+/**
+ * Puts the @p cached result of compiling @p unit where the compilation would
+ * have placed it.
+ */
+static bool copy_from_cache(compilation_env_t *env, compilation_unit_t *unit,
+                            char const *const extension,
+                            char const *const cached)
+{
+	FILE *const in = fopen(cached, "rb");
+	if (in == NULL)
+		return false;
+
+	if (streq(extension, ".s")) {
+		if (!open_output_for_unit(env, unit, ".s")) {
+			fclose(in);
+			return false;
+		}
+		copy_file(env->out, in);
+		close_output(env);
+		unit->name = env->outname;
+		/* nothing left to do for the unit */
+		unit->type = COMPILATION_UNIT_UNKNOWN;
+	} else {
+		compilation_unit_handler const assembler
+			= get_unit_handler(COMPILATION_UNIT_PREPROCESSED_ASSEMBLER);
+		const char *const o_name = assembler == assemble_final
+			? get_final_object_name(env, unit)
+			: get_intermediate_object_name(unit);
+		FILE *const out = o_name != NULL ? fopen(o_name, "wb") : NULL;
+		if (out == NULL) {
+			fclose(in);
+			return false;
+		}
+		copy_file(out, in);
+		fclose(out);
+		unit->name = o_name;
+		unit->type = COMPILATION_UNIT_OBJECT;
+	}
+	fclose(in);
+	return true;
+}
+
+static compilation_unit_handler get_preprocessor(compilation_unit_t *unit)
 {
 	if (driver_use_integrated_preprocessor == -1) {
 		/* don't use the integrated preprocessor when crosscompiling
@@ -586,11 +706,64 @@ static bool preprocess(compilation_env_t *env, compilation_unit_t *unit)
 		 * system headers compiled in. */
 		driver_use_integrated_preprocessor = target.triple == NULL;
 	}
-	compilation_unit_handler preprocessor
-		= driver_use_integrated_preprocessor
+	if (!driver_use_integrated_preprocessor && vfs_packs_loaded()) {
+		position_t const pos = { unit->name, 0, 0, 0 };
+		warningf(WARN_OTHER, &pos, "'%hs' has no effect with an external preprocessor", "-ivfspack");
+	}
+	return driver_use_integrated_preprocessor
 		? start_preprocessing : run_external_preprocessor;
+}
 
-	return preprocessor(env, unit);
+static bool do_print_preprocessing_tokens(FILE *out, compilation_env_t *env,
+                                          compilation_unit_t *unit);
+
+/**
+ * Preprocesses @p unit into a temporary file and looks up the result of the
+ * compilation in the cache by the preprocessed source. On a hit the result is
+ * put where the compilation would have placed it, on a miss the compilation
+ * continues with the preprocessed source, so headers are read and macros are
+ * expanded only once.
+ */
+static bool preprocess_cached(compilation_env_t *env, compilation_unit_t *unit,
+                              char const *const extension)
+{
+	compilation_unit_type_t const type = unit->type == COMPILATION_UNIT_CXX
+		? COMPILATION_UNIT_PREPROCESSED_CXX : COMPILATION_UNIT_PREPROCESSED_C;
+	const char *i_name;
+	FILE *const out = open_temp_file(unit->original_name, ".i", &i_name);
+	if (out == NULL)
+		return false;
+	bool res = get_preprocessor(unit)(env, unit);
+	if (res) {
+		if (driver_use_integrated_preprocessor) {
+			res = do_print_preprocessing_tokens(out, env, unit);
+		} else {
+			copy_file(out, unit->input);
+			res = close_input(unit);
+		}
+	}
+	if (fclose(out) != 0 || !res)
+		return false;
+	unit->name = i_name;
+	unit->type = type;
+
+	FILE *const in = fopen(i_name, "r");
+	if (in == NULL)
+		return true;
+	char const *const cached = cache_lookup(unit, extension, in);
+	fclose(in);
+	/* if the cached file cannot be copied, compile the preprocessed source */
+	if (cached != NULL)
+		copy_from_cache(env, unit, extension, cached);
+	return true;
+}
+
+static bool preprocess(compilation_env_t *env, compilation_unit_t *unit)
+{
+	char const *const extension = get_cacheable_extension(unit);
+	if (extension != NULL)
+		return preprocess_cached(env, unit, extension);
+	return get_preprocessor(unit)(env, unit);
 }
 
 static void write_preproc_dependencies(FILE *out, compilation_env_t *env,
@@ -622,7 +795,8 @@ static bool finish_preprocessing(compilation_env_t *env,
 	if (!res || error_count > 0)
 		return false;
 
-	if (construct_dep_target) {
+	/* the preprocessed source of a cached compilation has no includes */
+	if (construct_dep_target && !unit->dependencies_written) {
 		const char *dep_target_name = get_dependency_filename(env, unit);
 		FILE       *dep_out         = fopen(dep_target_name, "w");
 		if (dep_out == NULL) {
@@ -632,6 +806,7 @@ static bool finish_preprocessing(compilation_env_t *env,
 		}
 		write_preproc_dependencies(dep_out, env, unit);
 		fclose(dep_out);
+		unit->dependencies_written = true;
 	}
 	return true;
 }
@@ -751,6 +926,21 @@ static unsigned long long count_firm_nodes(void)
 
 static bool already_constructed_firm = false;
 
+/** Caches the code of single functions if the whole unit was not cached. */
+static void init_function_cache(void)
+{
+	if (!cache_enabled() || profile_use || profile_generate || driver_lto)
+		return;
+	/* the cached functions are only available as assembly */
+	compilation_unit_handler const codegen
+		= get_unit_handler(COMPILATION_UNIT_INTERMEDIATE_REPRESENTATION);
+	if (codegen != generate_code_final && codegen != generate_code_intermediate)
+		return;
+	char const *const options_key = cache_get_options_key();
+	if (options_key != NULL)
+		function_cache_init(cache_get_dir(), options_key);
+}
+
 bool build_firm_ir(compilation_env_t *env, compilation_unit_t *unit)
 {
 	(void)env;
@@ -761,6 +951,7 @@ bool build_firm_ir(compilation_env_t *env, compilation_unit_t *unit)
 		panic("compiling multiple files/translation units not yet supported");
 	already_constructed_firm = true;
 	init_implicit_optimizations();
+	init_function_cache();
 	translation_unit_to_firm(unit->ast);
 	timer_stop(t_construct);
 	if (stat_ev_enabled) {
@@ -780,11 +971,22 @@ static bool read_ir_file(compilation_env_t *env, compilation_unit_t *unit)
 	(void)env;
 	if (!open_input(unit))
 		return false;
-	if (ir_import_file(unit->input, unit->name)) {
-		position_t const pos = { unit->name, 0, 0, 0 };
-		errorf(&pos, "import of firm graph failed");
-		return false;
+	ir_timer_t *t_import = ir_timer_new();
+	timer_register(t_import, "Firm: IR import");
+	timer_start(t_import);
+	bool ok;
+	if (binary_ir_detect(unit->input)) {
+		ok = binary_ir_read(unit->input, unit->name);
+	} else {
+		ok = !ir_import_file(unit->input, unit->name);
+		if (!ok) {
+			position_t const pos = { unit->name, 0, 0, 0 };
+			errorf(&pos, "import of firm graph failed");
+		}
 	}
+	timer_stop(t_import);
+	if (!ok)
+		return false;
 	already_constructed_firm = true;
 	unit->type = COMPILATION_UNIT_INTERMEDIATE_REPRESENTATION;
 	return true;
@@ -831,13 +1033,134 @@ bool generate_code_final(compilation_env_t *env, compilation_unit_t *unit)
 	close_output(env);
 	if (!res)
 		unlink(env->outname);
+	else if (env->out != stdout)
+		cache_store(env->outname);
 	return res;
 }
 
+/**
+ * Generates code into a pipe read by the assembler, so the assembler runs
+ * while the code is generated instead of waiting for a temporary file.
+ */
+#ifdef SIGPIPE
+#ifdef HAVE_PTHREAD
+#define set_signal_mask pthread_sigmask
+#else
+#define set_signal_mask sigprocmask
+#endif
+
+typedef struct sigpipe_guard_t {
+	sigset_t old_mask;
+	bool     was_pending;
+} sigpipe_guard_t;
+
+/**
+ * Blocks SIGPIPE in the calling thread: An assembler exiting early must not
+ * kill us while we are writing to it, the failure shows in its exit status.
+ * Unlike ignoring the signal, this leaves the handler of a program embedding
+ * the compiler and the other threads alone.
+ */
+static void block_sigpipe(sigpipe_guard_t *const guard)
+{
+	sigset_t sigpipe;
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	set_signal_mask(SIG_BLOCK, &sigpipe, &guard->old_mask);
+	sigset_t pending;
+	sigpending(&pending);
+	guard->was_pending = sigismember(&pending, SIGPIPE);
+}
+
+/** Discards a SIGPIPE raised by our writes and restores the signal mask. */
+static void unblock_sigpipe(sigpipe_guard_t const *const guard)
+{
+	sigset_t pending;
+	sigpending(&pending);
+	if (!guard->was_pending && sigismember(&pending, SIGPIPE)) {
+		sigset_t sigpipe;
+		sigemptyset(&sigpipe);
+		sigaddset(&sigpipe, SIGPIPE);
+		int sig;
+		sigwait(&sigpipe, &sig);
+	}
+	set_signal_mask(SIG_SETMASK, &guard->old_mask, NULL);
+}
+#endif
+
+static bool generate_code_into_assembler(compilation_unit_t *unit,
+                                         const char *o_name)
+{
+	char *const commandline = get_assembler_commandline("-", o_name);
+	FILE *const asm_out     = open_command_pipe(commandline, true);
+	obstack_free(&asflags_obst, commandline);
+
+	position_t const pos = { unit->name, 0, 0, 0 };
+	if (asm_out == NULL) {
+		errorf(&pos, "invoking assembler failed");
+		return false;
+	}
+#ifdef SIGPIPE
+	sigpipe_guard_t guard;
+	block_sigpipe(&guard);
+#endif
+	bool const res    = do_generate_code(asm_out, unit);
+	int  const status = close_command_pipe(asm_out);
+#ifdef SIGPIPE
+	unblock_sigpipe(&guard);
+#endif
+	if (status != EXIT_SUCCESS || !res) {
+		if (status != EXIT_SUCCESS)
+			errorf(&pos, "assembler failed with exit status %d", status);
+		unlink(o_name);
+		return false;
+	}
+	cache_store(o_name);
+	unit->type = COMPILATION_UNIT_OBJECT;
+	unit->name = o_name;
+	return true;
+}
+
+/** Writes the IR of @p unit instead of machine code into the object. */
+static bool write_lto_object(compilation_unit_t *unit, const char *o_name)
+{
+	FILE *const out    = fopen(o_name, "wb");
+	bool        errors = out == NULL || !lto_write_object(out);
+	if (out != NULL && fclose(out) != 0)
+		errors = true;
+	if (errors) {
+		position_t const pos = { o_name, 0, 0, 0 };
+		errorf(&pos, "writing to output failed");
+		unlink(o_name);
+		return false;
+	}
+	cache_store(o_name);
+	unit->type = COMPILATION_UNIT_OBJECT;
+	unit->name = o_name;
+	return true;
+}
+
 bool generate_code_intermediate(compilation_env_t *env,
                                 compilation_unit_t *unit)
 {
-	(void)env;
+	compilation_unit_handler const assembler
+		= get_unit_handler(COMPILATION_UNIT_PREPROCESSED_ASSEMBLER);
+	if (driver_lto && assembler == assemble_final) {
+		const char *const o_name = get_final_object_name(env, unit);
+		return o_name != NULL && write_lto_object(unit, o_name);
+	} else if (driver_lto && assembler == assemble_intermediate) {
+		/* the IR is already in the program the objects are imported into */
+		lto_unit   = unit;
+		unit->type = COMPILATION_UNIT_UNKNOWN;
+		return true;
+	}
+	if (assembler == assemble_final || assembler == assemble_intermediate) {
+		const char *const o_name = assembler == assemble_final
+			? get_final_object_name(env, unit)
+			: get_intermediate_object_name(unit);
+		if (o_name == NULL)
+			return false;
+		return generate_code_into_assembler(unit, o_name);
+	}
 	const char *s_name;
 	FILE *asm_out = open_temp_file(unit->name, ".s", &s_name);
 	if (asm_out == NULL)
@@ -863,8 +1186,61 @@ static void decide_linker(void)
 	driver_linker = obstack_nul_finish(&file_obst);
 }
 
+static unsigned get_n_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long const n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_cpus > 0)
+		return (unsigned)n_cpus;
+#endif
+	return 1;
+}
+
+/**
+ * Imports the objects written with -flto into one program and compiles it
+ * into a single object, which replaces them on the linker command line.
+ */
+static bool compile_lto_objects(compilation_unit_t *units)
+{
+	bool native_objects = false;
+	for (compilation_unit_t *unit = units; unit != NULL; unit = unit->next) {
+		if (unit->type != COMPILATION_UNIT_OBJECT)
+			continue;
+		if (!lto_is_object(unit->name)) {
+			native_objects = true;
+			continue;
+		}
+
+		FILE *const in = fopen(unit->name, "rb");
+		if (in == NULL || !lto_read_object(in, unit->name)) {
+			position_t const pos = { unit->name, 0, 0, 0 };
+			errorf(&pos, "import of firm graph failed");
+			if (in != NULL)
+				fclose(in);
+			return false;
+		}
+		fclose(in);
+		if (lto_unit == NULL)
+			lto_unit = unit;
+		unit->type = COMPILATION_UNIT_UNKNOWN;
+	}
+	if (lto_unit == NULL)
+		return true;
+
+	if (!lto_resolve(driver_whole_program && !native_objects
+	                 && !driver_link_shared))
+		return false;
+	/* the whole program is compiled at once, use all cores for it */
+	set_default_codegen_jobs(get_n_cpus());
+	const char *const o_name = get_intermediate_object_name(lto_unit);
+	return o_name != NULL && generate_code_into_assembler(lto_unit, o_name);
+}
+
 bool link_program(compilation_env_t *env, compilation_unit_t *units)
 {
+	if (!compile_lto_objects(units))
+		return false;
+
 	const char *outname = env->outname;
 	if (outname == NULL) {
 		outname = driver_default_exe_output;
@@ -899,7 +1275,7 @@ bool link_program(compilation_env_t *env, compilation_unit_t *units)
 	if (driver_verbose) {
 		puts(commandline);
 	}
-	int err = system(commandline);
+	int err = run_command(commandline);
 	if (err != EXIT_SUCCESS) {
 		position_t const pos = { outname, 0, 0, 0 };
 		errorf(&pos, "linker reported an error");
@@ -913,7 +1289,13 @@ bool write_ir_file(compilation_env_t *env, compilation_unit_t *unit)
 {
 	if (!open_output_for_unit(env, unit, ".ir"))
 		return false;
-	ir_export_file(env->out);
+	ir_timer_t *t_export = ir_timer_new();
+	timer_register(t_export, "Firm: IR export");
+	timer_start(t_export);
+	/* the binary format does not support everything, fall back to text */
+	if (driver_ir_text || !binary_ir_write(env->out))
+		ir_export_file(env->out);
+	timer_stop(t_export);
 	int errors = ferror(env->out);
 	close_output(env);
 
@@ -972,7 +1354,7 @@ int action_print_file_name(const char *argv0)
 	if (driver_verbose) {
 		puts(commandline);
 	}
-	int err = system(commandline);
+	int err = run_command(commandline);
 	if (err != EXIT_SUCCESS) {
 		position_t const pos = { print_file_name_file, 0, 0, 0 };
 		errorf(&pos, "linker reported an error");
@@ -1010,6 +1392,36 @@ void set_default_handlers(void)
 
 void init_default_driver(void)
 {
+	driver_linker                               = NULL;
+	driver_preprocessor                         = NULL;
+	driver_assembler                            = NULL;
+	asflags                                     = NULL;
+	construct_dep_target                        = false;
+	driver_use_integrated_preprocessor          = -1;
+	driver_no_stdinc                            = false;
+	driver_verbose                              = false;
+	dump_defines                                = false;
+	print_dependencies_instead_of_preprocessing = false;
+	include_system_headers_in_dependencies      = false;
+	print_phony_targets                         = false;
+	dependency_file                             = NULL;
+	dependency_target                           = NULL;
+	dont_escape_target                          = false;
+	features_on                                 = 0;
+	features_off                                = 0;
+	standard                                    = STANDARD_DEFAULT;
+	dumpfunction                                = NULL;
+	isysroot                                    = NULL;
+	lsysroot                                    = NULL;
+	print_file_name_file                        = NULL;
+	driver_lto                                  = false;
+	driver_whole_program                        = false;
+	driver_link_shared                          = false;
+	driver_ir_text                              = false;
+	lto_unit                                    = NULL;
+	current_unit                                = NULL;
+	already_constructed_firm                    = false;
+
 	obstack_init(&codegenflags_obst);
 	obstack_init(&cppflags_obst);
 	obstack_init(&c_cpp_cppflags_obst);
@@ -1019,6 +1431,10 @@ void init_default_driver(void)
 
 void exit_default_driver(void)
 {
+	if (cmdline_defines != NULL) {
+		DEL_ARR_F(cmdline_defines);
+		cmdline_defines = NULL;
+	}
 	obstack_free(&codegenflags_obst, NULL);
 	obstack_free(&cppflags_obst, NULL);
 	obstack_free(&c_cpp_cppflags_obst, NULL);
@@ -46,6 +46,10 @@ extern const char     *driver_default_exe_output;
 extern const char     *isysroot;
 extern const char     *lsysroot;
 extern const char     *print_file_name_file;
+extern bool            driver_lto;
+extern bool            driver_whole_program;
+extern bool            driver_link_shared;
+extern bool            driver_ir_text;
 
 void record_cmdline_define(bool is_define, char const *define);
 
@@ -0,0 +1,461 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "enable_posix.h"
+#include "cache.h"
+
+#include <assert.h>
+#include <libfirm/firm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_DIRENT
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+#include "adt/array.h"
+#include "adt/sha256.h"
+#include "adt/strutil.h"
+#include "adt/util.h"
+#include "adt/xmalloc.h"
+#include "c_driver.h"
+#include "diagnostic.h"
+#include "driver_t.h"
+#include "version.h"
+#include <revision.h>
+
+char const        *cache_dir;
+unsigned long long cache_max_size = 1024ULL * 1024 * 1024;
+
+static int          cache_argc;
+static char const **cache_argv;
+static char        *pending_entry;
+
+/** Options naming outputs, they are neither hashed nor passed on. */
+static char const *const output_options[] = { "-o", "-MF" };
+/** Options selecting the compilation mode, the key has its own extension. */
+static char const *const mode_flags[] = { "-c", "-S", "-E" };
+/** Options only affecting preprocessing, which the key covers already. */
+static char const *const preprocessor_options[] = {
+	"-I", "-D", "-U", "-MT", "-MQ", "-include", "-idirafter", "-isystem",
+	"-iquote", "-isysroot", "-ivfspack", "-Wp,", "--cache-",
+};
+static char const *const preprocessor_flags[] = {
+	"-MD", "-MMD", "-MP", "-nostdinc",
+};
+
+void cache_set_commandline(int const argc, char **const argv)
+{
+	cache_argc = argc;
+	cache_argv = XMALLOCN(char const*, argc);
+	memcpy(cache_argv, argv, argc * sizeof(*cache_argv));
+}
+
+char const *cache_get_dir(void)
+{
+	if (cache_dir == NULL)
+		cache_dir = getenv("CPARSER_CACHE_DIR");
+	return cache_dir;
+}
+
+bool cache_enabled(void)
+{
+	char const *const dir = cache_get_dir();
+	return dir != NULL && dir[0] != '\0' && cache_argv != NULL;
+}
+
+static bool is_input(char const *const arg)
+{
+	for (compilation_unit_t const *unit = units; unit != NULL;
+	     unit = unit->next) {
+		if (unit->original_name == arg)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns whether @p arg is one of @p options; options with a value either
+ * have it attached or take the next argument (@p takes_value).
+ */
+static bool match_option(char const *const arg, char const *const *options,
+                         size_t const n_options, bool const has_value,
+                         bool *const takes_value)
+{
+	for (size_t i = 0; i < n_options; ++i) {
+		char const *const rest = strstart(arg, options[i]);
+		if (rest == NULL || (!has_value && rest[0] != '\0'))
+			continue;
+		*takes_value = has_value && rest[0] == '\0';
+		return true;
+	}
+	return false;
+}
+
+static void hash_version(sha256_t *const h)
+{
+	sha256_add_string(h, CPARSER_VERSION);
+	sha256_add_string(h, cparser_REVISION);
+	char firm_version[64];
+	snprintf(firm_version, sizeof(firm_version), "%u.%u(%s)",
+	         ir_get_version_major(), ir_get_version_minor(),
+	         ir_get_version_revision());
+	sha256_add_string(h, firm_version);
+}
+
+/**
+ * Adds the options influencing code generation to @p h.
+ *
+ * @return whether debug information is produced
+ */
+static bool hash_options(sha256_t *const h)
+{
+	bool debug_info = false;
+	for (int i = 1; i < cache_argc; ++i) {
+		char const *const arg = cache_argv[i];
+		if (arg == NULL || is_input(arg))
+			continue;
+		/* arguments of the program run with --run */
+		if (streq(arg, "--"))
+			break;
+
+		bool takes_value = false;
+		if (match_option(arg, output_options, ARRAY_SIZE(output_options),
+		                 true, &takes_value)
+		 || match_option(arg, mode_flags, ARRAY_SIZE(mode_flags), false,
+		                 &takes_value)
+		 || match_option(arg, preprocessor_options,
+		                 ARRAY_SIZE(preprocessor_options), true, &takes_value)
+		 || match_option(arg, preprocessor_flags,
+		                 ARRAY_SIZE(preprocessor_flags), false, &takes_value)) {
+			i += takes_value;
+			continue;
+		}
+
+		sha256_add_string(h, arg);
+		if (arg[1] == 'g' && !streq(arg, "-g0"))
+			debug_info = true;
+	}
+	return debug_info;
+}
+
+char const *cache_get_options_key(void)
+{
+	static bool done;
+	static char key[65];
+	if (!done) {
+		done = true;
+		sha256_t h;
+		sha256_init(&h);
+		hash_version(&h);
+		bool const debug_info = hash_options(&h);
+		sha256_finish(&h, key);
+		/* debug information contains source positions */
+		if (debug_info)
+			key[0] = '\0';
+	}
+	return key[0] != '\0' ? key : NULL;
+}
+
+static bool is_blank_line(char const *const line, size_t const len)
+{
+	for (size_t i = 0; i != len; ++i) {
+		if (line[i] != ' ' && line[i] != '\t' && line[i] != '\n')
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Adds the preprocessed source to @p h. Unless debug information is produced
+ * line markers and blank lines are skipped, so moving the sources to another
+ * directory or changing line breaks does not invalidate the cache.
+ */
+static void hash_preprocessed(sha256_t *const h, FILE *const in,
+                              bool const debug_info)
+{
+	char   *line     = NULL;
+	size_t  capacity = 0;
+	for (;;) {
+		size_t len = 0;
+		for (int c; (c = getc(in)) != EOF;) {
+			if (len == capacity) {
+				capacity = capacity * 2 + 128;
+				line     = XREALLOC(line, char, capacity);
+			}
+			line[len++] = (char)c;
+			if (c == '\n')
+				break;
+		}
+		if (len == 0)
+			break;
+		/* line markers are "# <line>", pragmas are kept */
+		if (!debug_info && (is_blank_line(line, len)
+		 || (len > 1 && line[0] == '#' && line[1] == ' ')))
+			continue;
+		sha256_add(h, line, len);
+	}
+	free(line);
+}
+
+/** Contents of the stats file of the cache. */
+typedef struct cache_stats_t {
+	unsigned long      hits;
+	unsigned long      misses;
+	unsigned long long size; /**< estimated size of the entries */
+} cache_stats_t;
+
+static void read_stats(char const *const dir, cache_stats_t *const stats)
+{
+	char name[4096];
+	snprintf(name, sizeof(name), "%s/stats", dir);
+	memset(stats, 0, sizeof(*stats));
+	FILE *const in = fopen(name, "r");
+	if (in == NULL)
+		return;
+	int const n = fscanf(in, "%lu %lu %llu", &stats->hits, &stats->misses,
+	                     &stats->size);
+	if (n < 2) {
+		memset(stats, 0, sizeof(*stats));
+	} else if (n == 2) {
+		/* older caches do not record the size, force a scan */
+		stats->size = cache_max_size + 1;
+	}
+	fclose(in);
+}
+
+static void write_stats(char const *const dir,
+                        cache_stats_t const *const stats)
+{
+	char name[4096];
+	char temp_name[4096];
+	snprintf(name, sizeof(name), "%s/stats", dir);
+	snprintf(temp_name, sizeof(temp_name), "%s/stats.tmp%ld", dir,
+	         (long)getpid());
+
+	/* concurrent updates may get lost, which is fine for statistics */
+	FILE *const out = fopen(temp_name, "w");
+	if (out == NULL)
+		return;
+	fprintf(out, "%lu %lu %llu\n", stats->hits, stats->misses, stats->size);
+	if (fclose(out) != 0 || rename(temp_name, name) != 0)
+		unlink(temp_name);
+}
+
+static void update_stats(bool const hit)
+{
+	char const *const dir = cache_get_dir();
+	mkdir(dir, 0777);
+	cache_stats_t stats;
+	read_stats(dir, &stats);
+	if (hit) {
+		++stats.hits;
+	} else {
+		++stats.misses;
+	}
+	write_stats(dir, &stats);
+}
+
+char const *cache_lookup(compilation_unit_t const *const unit,
+                         char const *const extension,
+                         FILE *const preprocessed)
+{
+	free(pending_entry);
+	pending_entry = NULL;
+
+	sha256_t h;
+	sha256_init(&h);
+	hash_version(&h);
+	sha256_add_string(&h, unit->type == COMPILATION_UNIT_PREPROCESSED_CXX
+	                      ? "c++" : "c");
+	sha256_add_string(&h, extension);
+
+	bool const debug_info = hash_options(&h);
+	hash_preprocessed(&h, preprocessed, debug_info);
+
+	char key[65];
+	sha256_finish(&h, key);
+	char const *const dir = cache_get_dir();
+	size_t      const len = strlen(dir) + strlen(key) + strlen(extension) + 3;
+	char       *const entry = XMALLOCN(char, len);
+	snprintf(entry, len, "%s/%.2s/%s%s", dir, key, key + 2, extension);
+
+	FILE *const cached = fopen(entry, "rb");
+	if (cached == NULL) {
+		update_stats(false);
+		pending_entry = entry;
+		return NULL;
+	}
+	fclose(cached);
+	update_stats(true);
+#ifdef HAVE_DIRENT
+	/* mark as recently used */
+	utime(entry, NULL);
+#endif
+	return entry;
+}
+
+#ifdef HAVE_DIRENT
+typedef struct cache_entry_t {
+	char              *name;
+	time_t             used;
+	unsigned long long size;
+} cache_entry_t;
+
+static int compare_entries(void const *const a, void const *const b)
+{
+	time_t const used_a = ((cache_entry_t const*)a)->used;
+	time_t const used_b = ((cache_entry_t const*)b)->used;
+	return used_a < used_b ? -1 : used_a > used_b;
+}
+
+static unsigned long long collect_entries(cache_entry_t **const entries,
+                                          char const *const dir)
+{
+	unsigned long long total = 0;
+	DIR *const d = opendir(dir);
+	if (d == NULL)
+		return 0;
+	for (struct dirent *e; (e = readdir(d)) != NULL;) {
+		/* entries live in subdirectories named after 2 hex digits */
+		if (strlen(e->d_name) != 2 || e->d_name[0] == '.')
+			continue;
+		char subdir_name[4096];
+		snprintf(subdir_name, sizeof(subdir_name), "%s/%s", dir, e->d_name);
+		DIR *const subdir = opendir(subdir_name);
+		if (subdir == NULL)
+			continue;
+		for (struct dirent *f; (f = readdir(subdir)) != NULL;) {
+			if (f->d_name[0] == '.' || strstr(f->d_name, ".tmp") != NULL)
+				continue;
+			size_t const len  = strlen(subdir_name) + strlen(f->d_name) + 2;
+			char  *const name = XMALLOCN(char, len);
+			snprintf(name, len, "%s/%s", subdir_name, f->d_name);
+			struct stat st;
+			if (stat(name, &st) != 0) {
+				free(name);
+				continue;
+			}
+			cache_entry_t const entry = { name, st.st_mtime, st.st_size };
+			ARR_APP1(cache_entry_t, *entries, entry);
+			total += st.st_size;
+		}
+		closedir(subdir);
+	}
+	closedir(d);
+	return total;
+}
+
+/**
+ * Removes the least recently used entries if the cache is too big.
+ *
+ * @return the size of the remaining entries
+ */
+static unsigned long long evict_entries(void)
+{
+	cache_entry_t     *entries = NEW_ARR_F(cache_entry_t, 0);
+	unsigned long long total   = collect_entries(&entries, cache_get_dir());
+	size_t const       n       = ARR_LEN(entries);
+	if (total > cache_max_size) {
+		qsort(entries, n, sizeof(*entries), compare_entries);
+		/* leave some room to not evict again on the next store */
+		unsigned long long const limit = cache_max_size / 10 * 9;
+		for (size_t i = 0; i < n && total > limit; ++i) {
+			if (unlink(entries[i].name) == 0)
+				total -= entries[i].size;
+		}
+	}
+	for (size_t i = 0; i < n; ++i) {
+		free(entries[i].name);
+	}
+	DEL_ARR_F(entries);
+	return total;
+}
+#endif
+
+void cache_add_size(unsigned long long const size)
+{
+	char const *const dir = cache_get_dir();
+	cache_stats_t stats;
+	read_stats(dir, &stats);
+	stats.size += size;
+#ifdef HAVE_DIRENT
+	/* only scan the cache when the estimate exceeds the limit, entries
+	 * evicted or stored concurrently make the estimate inexact */
+	if (stats.size > cache_max_size)
+		stats.size = evict_entries();
+#endif
+	write_stats(dir, &stats);
+}
+
+void cache_store(char const *const filename)
+{
+	char *const entry = pending_entry;
+	if (entry == NULL)
+		return;
+	pending_entry = NULL;
+
+	/* create the cache directory and the subdirectory of the entry */
+	char *const slash = strrchr(entry, '/');
+	*slash = '\0';
+	mkdir(cache_get_dir(), 0777);
+	mkdir(entry, 0777);
+	*slash = '/';
+
+	size_t const len       = strlen(entry) + 32;
+	char  *const temp_name = XMALLOCN(char, len);
+	snprintf(temp_name, len, "%s.tmp%ld", entry, (long)getpid());
+	FILE *const in  = fopen(filename, "rb");
+	FILE *const out = fopen(temp_name, "wb");
+	long        size = -1;
+	if (in != NULL && out != NULL) {
+		copy_file(out, in);
+		size = ftell(out);
+		/* rename atomically so concurrent lookups never see partial files */
+		if (ferror(in) || fclose(out) != 0 || rename(temp_name, entry) != 0) {
+			unlink(temp_name);
+			size = -1;
+		}
+	} else if (out != NULL) {
+		fclose(out);
+		unlink(temp_name);
+	}
+	if (in != NULL)
+		fclose(in);
+	free(temp_name);
+	free(entry);
+
+	if (size >= 0)
+		cache_add_size(size);
+}
+
+int action_print_cache_stats(const char *argv0)
+{
+	(void)argv0;
+	char const *const dir = cache_get_dir();
+	if (dir == NULL || dir[0] == '\0') {
+		errorf(NULL, "no cache directory set (use --cache-dir or CPARSER_CACHE_DIR)");
+		return EXIT_FAILURE;
+	}
+
+	cache_stats_t stats;
+	read_stats(dir, &stats);
+
+	printf("cache directory: %s\n", dir);
+	printf("cache hits:      %lu\n", stats.hits);
+	printf("cache misses:    %lu\n", stats.misses);
+#ifdef HAVE_DIRENT
+	cache_entry_t           *entries = NEW_ARR_F(cache_entry_t, 0);
+	unsigned long long const total   = collect_entries(&entries, dir);
+	size_t             const n       = ARR_LEN(entries);
+	for (size_t i = 0; i < n; ++i) {
+		free(entries[i].name);
+	}
+	DEL_ARR_F(entries);
+	printf("cached files:    %lu\n", (unsigned long)n);
+	printf("cache size:      %llu of %llu bytes\n", total, cache_max_size);
+#endif
+	return EXIT_SUCCESS;
+}
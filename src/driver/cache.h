@@ -0,0 +1,61 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief content addressed cache of compilation results
+ *
+ * The key of a compilation is a hash over the preprocessed source (the output
+ * of the preprocessor run of the compilation), the options influencing code
+ * generation and the compiler version. Results are stored as files named after the key
+ * and evicted least recently used first when the cache exceeds its size.
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "driver.h"
+
+/** Directory of the cache, falls back to $CPARSER_CACHE_DIR if NULL. */
+extern char const        *cache_dir;
+/** Size limit of the cache in bytes. */
+extern unsigned long long cache_max_size;
+
+/** Remembers the command line the cache keys are computed from. */
+void cache_set_commandline(int argc, char **argv);
+
+/** Returns whether a cache directory is configured. */
+bool cache_enabled(void);
+
+/** Returns the directory of the cache. */
+char const *cache_get_dir(void);
+
+/**
+ * Returns a hash over the compiler version and the options influencing code
+ * generation, or NULL if the output depends on the source positions.
+ */
+char const *cache_get_options_key(void);
+
+/**
+ * Looks up the result of compiling the preprocessed @p unit into a file with
+ * @p extension. @p preprocessed is the contents of the unit.
+ *
+ * @return the name of the cached file on a hit; NULL on a miss, the next
+ *         cache_store() will store the result under the key then
+ */
+char const *cache_lookup(compilation_unit_t const *unit,
+                         char const *extension, FILE *preprocessed);
+
+/** Stores @p filename under the key of the last missed cache_lookup(). */
+void cache_store(char const *filename);
+
+/**
+ * Accounts for @p size bytes stored in the cache and evicts entries if the
+ * cache exceeds its size limit.
+ */
+void cache_add_size(unsigned long long size);
+
+int action_print_cache_stats(const char *argv0);
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "enable_posix.h"
+#include "context.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "adt/xmalloc.h"
+#include "ast/ast.h"
+#include "c_driver.h"
+#include "diagnostic.h"
+#include "driver_t.h"
+#include "firm/ast2firm.h"
+#include "firm/firm_opt.h"
+#include "options.h"
+#include "parser/parser.h"
+#include "parser/preprocessor.h"
+#include "target.h"
+#include "tempfile.h"
+#include "timing.h"
+
+struct cparser_context_t {
+	int    argc;
+	char **argv; /**< copies of the options */
+};
+
+#ifdef HAVE_PTHREAD
+/** protects the global state of the compiler */
+static pthread_mutex_t compile_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+cparser_context_t *cparser_context_create(int const argc,
+                                          char const *const *const argv)
+{
+	cparser_context_t *const context = XMALLOCZ(cparser_context_t);
+	context->argc = argc;
+	context->argv = XMALLOCN(char*, argc + 1);
+	for (int i = 0; i != argc; ++i) {
+		context->argv[i] = xstrdup(argv[i]);
+	}
+	context->argv[argc] = NULL;
+	return context;
+}
+
+void cparser_context_destroy(cparser_context_t *const context)
+{
+	for (int i = 0; i != context->argc; ++i) {
+		free(context->argv[i]);
+	}
+	free(context->argv);
+	free(context);
+}
+
+/** Initializes the global state in the same order as main() does. */
+static void init_compiler(void)
+{
+	init_temp_files();
+	init_driver();
+	init_default_driver();
+	init_preprocessor();
+	init_gen_firm();
+	init_ast();
+	init_parser();
+	disallow_codegen_jobs();
+	/* -Wfatal-errors must not exit the embedding program */
+	exit_on_fatal_errors = false;
+}
+
+static void exit_compiler(void)
+{
+	exit_gen_firm();
+	exit_ast2firm();
+	exit_parser();
+	exit_ast();
+	exit_preprocessor();
+	exit_driver();
+	exit_default_driver();
+	exit_temp_files();
+}
+
+/** Applies the options of @p context like main() does. */
+static bool parse_options(cparser_context_t const *const context)
+{
+	/* option parsing removes some arguments, so work on a copy */
+	int    const argc = context->argc;
+	char **const argv = XMALLOCN(char*, argc + 1);
+	memcpy(argv, context->argv, (argc + 1) * sizeof(*argv));
+
+	options_state_t state;
+	memset(&state, 0, sizeof(state));
+	state.argc = argc;
+	state.argv = argv;
+
+	for (state.i = 0; state.i < argc; ++state.i) {
+		if (options_parse_early_target(&state)
+		 || options_parse_early_sysroot(&state)
+		 || options_parse_early_codegen(&state))
+			state.argv[state.i] = NULL;
+	}
+
+	if (!isysroot)
+		isysroot = lsysroot;
+	if (!target_set_defaults()) {
+		free(argv);
+		return false;
+	}
+
+	for (state.i = 0; state.i < argc; ++state.i) {
+		if (state.argv[state.i] == NULL)
+			continue;
+		if (options_parse_assembler(&state)
+		 || options_parse_c_dialect(&state)
+		 || options_parse_codegen(&state)
+		 || options_parse_diagnostics(&state)
+		 || options_parse_driver(&state)
+		 || options_parse_linker(&state)
+		 || options_parse_preprocessor(&state)) {
+			continue;
+		}
+		errorf(NULL, "unknown argument '%s'", argv[state.i]);
+		state.argument_errors = true;
+	}
+	free(argv);
+
+	if (state.had_inputs) {
+		errorf(NULL, "input files cannot be given as options of a context");
+		state.argument_errors = true;
+	}
+	if (state.action != NULL) {
+		errorf(NULL, "options selecting an action cannot be given as options of a context");
+		state.argument_errors = true;
+	}
+	/* options report some errors without failing, like backend options */
+	return !state.argument_errors && target_setup() && error_count == 0;
+}
+
+static bool generate_code_to_output(compilation_env_t *env,
+                                    compilation_unit_t *unit)
+{
+	warn_experimental_target();
+	generate_code(env->out, unit->original_name);
+	unit->type = COMPILATION_UNIT_PREPROCESSED_ASSEMBLER;
+	return true;
+}
+
+/** Appends the object file @p o_name to @p out. */
+static bool copy_object(char const *const o_name, FILE *const out)
+{
+	FILE *const in = fopen(o_name, "rb");
+	if (in == NULL) {
+		position_t const pos = { o_name, 0, 0, 0 };
+		errorf(&pos, "could not open object file: %s", strerror(errno));
+		return false;
+	}
+	copy_file(out, in);
+	fclose(in);
+	return true;
+}
+
+static bool compile_source(char const *const name, char const *const data,
+                           size_t const size, cparser_output_kind_t const kind,
+                           FILE *const out)
+{
+#ifdef HAVE_FMEMOPEN
+	/* some C libraries refuse to open streams of size 0 */
+	static char const empty[] = "\n";
+	FILE *const input = size != 0 ? fmemopen((void*)data, size, "r")
+	                              : fmemopen((void*)empty, 1, "r");
+	if (input == NULL) {
+		position_t const pos = { name, 0, 0, 0 };
+		errorf(&pos, "could not open source: %s", strerror(errno));
+		return false;
+	}
+
+	/* the source is no file an external preprocessor could read */
+	driver_use_integrated_preprocessor = true;
+	set_default_handlers();
+	if (kind == CPARSER_OUTPUT_ASSEMBLY) {
+		set_unit_handler(COMPILATION_UNIT_INTERMEDIATE_REPRESENTATION,
+		                 generate_code_to_output, true);
+	}
+
+	driver_add_input(name, COMPILATION_UNIT_C);
+	units->input = input;
+
+	compilation_env_t env;
+	memset(&env, 0, sizeof(env));
+	env.out = out;
+	bool res = process_all_units(&env);
+	if (units->input != NULL)
+		close_input(units);
+	if (res && kind == CPARSER_OUTPUT_OBJECT) {
+		/* the default handlers leave the object in a temporary file */
+		if (units->type != COMPILATION_UNIT_OBJECT) {
+			position_t const pos = { name, 0, 0, 0 };
+			errorf(&pos, "no object file was produced");
+			res = false;
+		} else {
+			res = copy_object(units->name, out);
+		}
+	}
+	return res && error_count == 0;
+#else
+	(void)data;
+	(void)size;
+	(void)kind;
+	(void)out;
+	position_t const pos = { name, 0, 0, 0 };
+	errorf(&pos, "compiling from memory is not supported on this platform");
+	return false;
+#endif
+}
+
+static void lock_compiler(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&compile_lock);
+#endif
+	init_compiler();
+}
+
+static void unlock_compiler(void)
+{
+	/* frees the timers registered by the initialization as well */
+	timer_term(do_timing && print_timing ? stderr : NULL);
+	exit_compiler();
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&compile_lock);
+#endif
+}
+
+bool cparser_compile_buffer(cparser_context_t *const context,
+                            char const *const name, char const *const source,
+                            FILE *const out)
+{
+	lock_compiler();
+	bool res = parse_options(context);
+	if (res) {
+		if (do_timing)
+			timer_init();
+		res = compile_source(name, source, strlen(source),
+		                     CPARSER_OUTPUT_ASSEMBLY, out);
+	}
+	unlock_compiler();
+	return res;
+}
+
+void cparser_compile_files(cparser_context_t *const context,
+                           cparser_file_t const *const files,
+                           size_t const n_files,
+                           cparser_output_kind_t const kind,
+                           cparser_result_t *const result)
+{
+	assert(n_files > 0);
+	memset(result, 0, sizeof(*result));
+#ifdef HAVE_OPEN_MEMSTREAM
+	FILE *const diagnostics
+		= open_memstream(&result->diagnostics, &result->diagnostics_size);
+	FILE *const output = open_memstream(&result->output, &result->output_size);
+	if (diagnostics == NULL || output == NULL) {
+		if (diagnostics != NULL)
+			fclose(diagnostics);
+		if (output != NULL)
+			fclose(output);
+		cparser_result_free(result);
+		return;
+	}
+
+	lock_compiler();
+	set_diagnostic_output(diagnostics);
+	diagnostic_enable_color(0);
+	bool res = parse_options(context);
+	if (res) {
+		if (do_timing)
+			timer_init();
+		for (size_t i = 0; i != n_files; ++i) {
+			add_virtual_file(files[i].name, files[i].data, files[i].size);
+		}
+		virtual_files_only = true;
+		res = compile_source(files[0].name, files[0].data, files[0].size, kind,
+		                     output);
+	}
+	unlock_compiler();
+
+	fclose(diagnostics);
+	fclose(output);
+	result->success = res;
+#else
+	(void)context;
+	(void)files;
+	(void)kind;
+	result->diagnostics
+		= xstrdup("compiling from memory is not supported on this platform\n");
+	result->diagnostics_size = strlen(result->diagnostics);
+#endif
+}
+
+void cparser_result_free(cparser_result_t *const result)
+{
+	free(result->diagnostics);
+	free(result->output);
+	memset(result, 0, sizeof(*result));
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief interface for programs embedding cparser
+ *
+ * A context holds the command line options of the compilations started with
+ * it. The compiler keeps its state in global variables (as does libfirm), so
+ * every compilation initializes all of it from the options of its context and
+ * tears it down again afterwards. Compilations are serialized by a lock, so
+ * contexts may be used from several threads, although only one of them
+ * compiles at a time.
+ */
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct cparser_context_t cparser_context_t;
+
+/** A file passed to the compiler in memory. */
+typedef struct cparser_file_t {
+	char const *name; /**< the name used to include the file */
+	char const *data;
+	size_t      size;
+} cparser_file_t;
+
+typedef enum cparser_output_kind_t {
+	CPARSER_OUTPUT_ASSEMBLY,
+	CPARSER_OUTPUT_OBJECT,
+} cparser_output_kind_t;
+
+/** The outcome of cparser_compile_files(). */
+typedef struct cparser_result_t {
+	bool   success;
+	char  *diagnostics;      /**< all diagnostics, NUL terminated */
+	size_t diagnostics_size;
+	char  *output;           /**< the assembly or object file */
+	size_t output_size;
+} cparser_result_t;
+
+/**
+ * Creates a context compiling with the command line options in @p argv
+ * (without the program name). Input files and options selecting what to do
+ * are not allowed, the options are only checked when compiling.
+ */
+cparser_context_t *cparser_context_create(int argc, char const *const *argv);
+
+/**
+ * Compiles the C source @p source, a NUL terminated string, and writes the
+ * assembly to @p out. @p name is the filename shown in diagnostics, which are
+ * printed to stderr. Returns false if compilation failed.
+ */
+bool cparser_compile_buffer(cparser_context_t *context, char const *name,
+                            char const *source, FILE *out);
+
+/**
+ * Compiles @p files[0] with the other files available for inclusion by
+ * their names and stores the output and diagnostics in @p result. Only
+ * system headers are read from the filesystem. Producing an object file runs
+ * the assembler, which uses a temporary file.
+ */
+void cparser_compile_files(cparser_context_t *context,
+                           cparser_file_t const *files, size_t n_files,
+                           cparser_output_kind_t kind,
+                           cparser_result_t *result);
+
+/** Frees the buffers of @p result. */
+void cparser_result_free(cparser_result_t *result);
+
+void cparser_context_destroy(cparser_context_t *context);
+
+#endif
@@ -54,6 +54,31 @@ static unsigned warning_count = 0;
 
 bool     show_column             = true;
 bool     diagnostics_show_option = true;
+bool     exit_on_fatal_errors    = true;
+
+/** Stream receiving the diagnostics, stderr if NULL. */
+static FILE *diagnostic_output;
+
+void init_diagnostics(void)
+{
+	colors                  = no_colors;
+	diagnostic_output       = NULL;
+	error_count             = 0;
+	warning_count           = 0;
+	show_column             = true;
+	diagnostics_show_option = true;
+	exit_on_fatal_errors    = true;
+}
+
+void set_diagnostic_output(FILE *const out)
+{
+	diagnostic_output = out;
+}
+
+FILE *get_diagnostic_output(void)
+{
+	return diagnostic_output != NULL ? diagnostic_output : stderr;
+}
 
 static void fpututf32(utf32 const c, FILE *const out)
 {
@@ -81,7 +106,7 @@ static void diagnosticvf(position_t const *const pos,
                          char const *const kind_color, char const *const kind,
                          char const *fmt, va_list ap)
 {
-	FILE *const out = stderr;
+	FILE *const out = get_diagnostic_output();
 
 	fputs(colors.highlight, out);
 	if (pos) {
@@ -268,8 +293,8 @@ static void errorvf(const position_t *pos,
 {
 	++error_count;
 	diagnosticvf(pos, colors.error, "error", fmt, ap);
-	fputc('\n', stderr);
-	if (is_warn_on(WARN_FATAL_ERRORS))
+	fputc('\n', get_diagnostic_output());
+	if (exit_on_fatal_errors && is_warn_on(WARN_FATAL_ERRORS))
 		exit(EXIT_FAILURE);
 }
 
@@ -286,7 +311,7 @@ void notef(position_t const *const pos, char const *const fmt, ...)
 	va_list ap;
 	va_start(ap, fmt);
 	diagnosticvf(pos, colors.note, "note", fmt, ap);
-	fputc('\n', stderr);
+	fputc('\n', get_diagnostic_output());
 	va_end(ap);
 }
 
@@ -317,9 +342,9 @@ bool warningf(warning_t const warn, position_t const* pos, char const *const fmt
 			va_end(ap);
 			if (diagnostics_show_option) {
 				char const *const err = s->state & WARN_STATE_ERROR ? "error=" : "";
-				fprintf(stderr, " [-W%s%s]", err, s->name);
+				fprintf(get_diagnostic_output(), " [-W%s%s]", err, s->name);
 			}
-			fputc('\n', stderr);
+			fputc('\n', get_diagnostic_output());
 			return true;
 
 		default:
@@ -339,8 +364,9 @@ void diagnostic_enable_color(int n_cols)
 void print_diagnostic_summary(void)
 {
 	if (error_count > 0) {
-		fprintf(stderr, "%u error(s), %u warning(s)\n", error_count, warning_count);
+		fprintf(get_diagnostic_output(), "%u error(s), %u warning(s)\n",
+		        error_count, warning_count);
 	} else if (warning_count > 0) {
-		fprintf(stderr, "%u warning(s)\n", warning_count);
+		fprintf(get_diagnostic_output(), "%u warning(s)\n", warning_count);
 	}
 }
@@ -6,6 +6,7 @@
 #define DIAGNOSTIC_H
 
 #include <stdbool.h>
+#include <stdio.h>
 
 #include "ast/position.h"
 #include "warning.h"
@@ -42,6 +43,14 @@ bool warningf(warning_t, position_t const *pos, char const *fmt, ...);
 extern unsigned error_count;
 extern bool     show_column;             /**< Show column in diagnostic messages */
 extern bool     diagnostics_show_option; /**< Show the switch, which controls a warning. */
+extern bool     exit_on_fatal_errors;    /**< -Wfatal-errors exits the process */
+
+/** Resets the diagnostic counters and settings. */
+void init_diagnostics(void);
+
+/** Prints diagnostics to @p out instead of stderr, NULL restores stderr. */
+void set_diagnostic_output(FILE *out);
+FILE *get_diagnostic_output(void);
 
 /** enable color output, allowed values for n_cols are 0, 8 and 256 */
 void diagnostic_enable_color(int n_cols);
@@ -12,12 +12,17 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "adt/array.h"
 #include "adt/panic.h"
 #include "adt/strutil.h"
 #include "adt/util.h"
 #include "c_driver.h"
 #include "diagnostic.h"
+#include "options.h"
+#include "subprocess.h"
+#include "target.h"
 #include "timing.h"
+#include "warning.h"
 
 const char         *outname;
 bool                produce_statev;
@@ -93,6 +98,48 @@ const char *get_output_name(const char *inputname, const char *newext)
 	return obstack_nul_finish(&file_obst);
 }
 
+static bool is_space(char const c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+char **split_commandline(char const *const commandline)
+{
+	char       **argv = NEW_ARR_F(char*, 0);
+	char const  *c    = commandline;
+	for (;;) {
+		while (is_space(*c))
+			++c;
+		if (*c == '\0')
+			break;
+
+		/* undo the quoting and escaping of driver_add_flag() */
+		assert(obstack_object_size(&file_obst) == 0);
+		char quote = '\0';
+		for (; *c != '\0'; ++c) {
+			if (quote != '\0') {
+				if (*c == quote) {
+					quote = '\0';
+					continue;
+				}
+				if (*c == '\\' && quote == '"' && c[1] != '\0')
+					++c;
+			} else if (*c == '\'' || *c == '"') {
+				quote = *c;
+				continue;
+			} else if (is_space(*c)) {
+				break;
+			} else if (*c == '\\' && c[1] != '\0') {
+				++c;
+			}
+			obstack_1grow(&file_obst, *c);
+		}
+		ARR_APP1(char*, argv, obstack_nul_finish(&file_obst));
+	}
+	ARR_APP1(char*, argv, NULL);
+	return argv;
+}
+
 FILE *open_temp_file(const char *basename, const char *extension,
                      const char **final_name)
 {
@@ -132,7 +179,7 @@ bool close_input(compilation_unit_t *unit)
 	if (unit->input == stdin) {
 		res = true;
 	} else if (unit->input_is_pipe) {
-		res = pclose(unit->input) == EXIT_SUCCESS;
+		res = close_command_pipe(unit->input) == EXIT_SUCCESS;
 	} else {
 		fclose(unit->input);
 		res = true;
@@ -213,6 +260,18 @@ void set_unit_handler(compilation_unit_type_t type,
 	stop_after[type] = stop_after_val;
 }
 
+compilation_unit_handler get_unit_handler(compilation_unit_type_t const type)
+{
+	assert(type <= COMPILATION_UNIT_LAST);
+	return handlers[type];
+}
+
+bool get_unit_stop_after(compilation_unit_type_t const type)
+{
+	assert(type <= COMPILATION_UNIT_LAST);
+	return stop_after[type];
+}
+
 bool process_unit(compilation_env_t *env, compilation_unit_t *unit)
 {
 	bool res;
@@ -338,6 +397,20 @@ static int detect_color_terminal(void)
 void init_driver(void)
 {
 	obstack_init(&file_obst);
+	outname        = NULL;
+	produce_statev = false;
+	filtev         = NULL;
+	do_timing      = false;
+	print_timing   = false;
+	units          = NULL;
+	unit_anchor    = &units;
+	memset(handlers, 0, sizeof(handlers));
+	memset(stop_after, 0, sizeof(stop_after));
+
+	init_diagnostics();
+	init_warnings();
+	init_target();
+	init_options();
 
 	colorterm = detect_color_terminal();
 	diagnostic_enable_color(colorterm);
@@ -37,6 +37,8 @@ typedef bool (*compilation_unit_handler)(compilation_env_t *,
 
 void set_unit_handler(compilation_unit_type_t type,
                       compilation_unit_handler handler, bool stop_after);
+compilation_unit_handler get_unit_handler(compilation_unit_type_t type);
+bool get_unit_stop_after(compilation_unit_type_t type);
 
 bool process_unit(compilation_env_t *env, compilation_unit_t *unit);
 bool process_all_units(compilation_env_t *env);
@@ -55,6 +57,14 @@ extern compilation_unit_t *units;
 void driver_add_input(const char *filename, compilation_unit_type_t type);
 void driver_add_flag(struct obstack *obst, const char *format, ...);
 
+/**
+ * Splits a command line as built with driver_add_flag() into its arguments,
+ * for running it without a shell.
+ *
+ * @return a NULL terminated flexible array, free it with DEL_ARR_F()
+ */
+char **split_commandline(char const *commandline);
+
 FILE *open_temp_file(const char *basename, const char *extension,
                      const char **final_name);
 const char *get_output_name(const char *inputname, const char *newext);
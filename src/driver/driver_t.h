@@ -16,6 +16,7 @@ struct compilation_unit_t {
 	const char             *name;  /**< filename or "-" for stdin */
 	FILE                   *input; /**< input (NULL if not opened yet) */
 	bool                    input_is_pipe;
+	bool                    dependencies_written; /**< by a preprocessor run */
 	const char             *original_name;
 	compilation_unit_type_t type;
 	lang_standard_t         standard;
@@ -43,4 +43,11 @@
 #define HAVE_FILENO
 #define HAVE_ASCTIME_R
 #define HAVE_FSTAT
+#define HAVE_MMAP
+#define HAVE_FORK
+#define HAVE_FMEMOPEN
+#define HAVE_OPEN_MEMSTREAM
+#define HAVE_PTHREAD
+#define HAVE_POSIX_SPAWN
+#define HAVE_DIRENT
 #endif
@@ -100,6 +100,9 @@ static void print_help_basic(const char *argv0)
 	help_simple("-dumpversion",             "Display shortened compiler version");
 	help_simple("-dumpmachine",             "Display target machine triple");
 	help_simple("-pipe",                    "Ignored (gcc compatibility)");
+	help_equals("--cache-dir", "DIR",       "Cache compilation results in DIR (default $CPARSER_CACHE_DIR)");
+	help_equals("--cache-size", "MB",       "Limit the size of the compilation cache (default 1024)");
+	help_simple("--cache-stats",            "Display compilation cache statistics");
 	/* Do not document these: support/check_option.py will see them:
 	 * help_simple("-version", "");
 	 * help_simple("-fno-syntax-only", "");
@@ -129,6 +132,7 @@ static void print_help_preprocessor(void)
 	help_prefix("-idirafter", "DIR",        "Append to header searchpath (after -I dirs)");
 	help_prefix("-iquote", "DIR",           "Append to header searchpath for #include with quoted argument");
 	help_prefix("-isystem", "DIR",          "Append to system header searchpath");
+	help_prefix("-ivfspack", "FILE",        "Read headers found in pack file before the filesystem");
 	help_aprefix("-Wp,", "OPTION",          "Pass option directly to preprocessor");
 	help_spaced("-Xpreprocessor", "OPTION", "Pass option directly to preprocessor");
 	help_equals("-finput-charset", "CHARSET", "Select encoding of input files");
@@ -231,6 +235,8 @@ static void print_help_codegeneration(void)
 	help_simple("-pthread",                       "Use pthread threading library");
 	help_simple("-fexceptions",                   "Enable exception handling");
 	help_f_yesno("-ffast-math",                   "Enable imprecise floatingpoint transformations");
+	help_f_yesno("-flto",                         "Write IR into objects and optimize them together when linking");
+	help_f_yesno("-fwhole-program",               "Assume that only main is referenced from outside the -flto objects");
 	help_f_yesno("-fverbose-asm",                 "Enable verbose assembly output");
 	help_f_yesno("-frounding-math",               "Ignored (gcc compatibility)");
 	help_simple("-fexcess-precision=standard",    "Ignored (gcc compatibility)");
@@ -283,9 +289,12 @@ static void print_help_debug(void)
 	help_simple("--time",                   "Measure time of compiler passes");
 	help_simple("--statev",                 "Produce statev output");
 	help_equals("--filtev", "FILTER",       "Set statev filter regex");
+	help_equals("--opt-profile", "FILE",    "Write per-function optimization pass profile as JSON");
 	help_spaced("--dump-function", "FUNC",  "Preprocess, parse and output vcg graph of func");
 	help_simple("--export-ir",              "Preprocess, parse and output compiler intermediate representation");
+	help_simple("--export-ir-text",         "Like --export-ir but write the textual IR format");
 	help_simple("--jittest",                "Jit compile and exeucte main() function");
+	help_simple("--run",                    "Compile into memory and run main() with the arguments after --");
 }
 
 static void print_help_language_tools(void)
@@ -5,7 +5,11 @@
 #include "options.h"
 
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
 #include <libfirm/be.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "actions.h"
@@ -15,6 +19,7 @@
 #include "ast/ast_t.h"
 #include "ast/dialect.h"
 #include "c_driver.h"
+#include "cache.h"
 #include "diagnostic.h"
 #include "driver.h"
 #include "firm/ast2firm.h"
@@ -23,6 +28,7 @@
 #include "help.h"
 #include "parser/parser.h"
 #include "parser/preprocessor.h"
+#include "parser/vfs_pack.h"
 #include "predefs.h"
 #include "target.h"
 #include "wrappergen/write_jna.h"
@@ -34,6 +40,18 @@ bool               profile_use;
 
 static compilation_unit_type_t forced_unittype = COMPILATION_UNIT_AUTODETECT;
 
+void init_options(void)
+{
+	codegen_options        = NULL;
+	codegen_options_anchor = &codegen_options;
+	profile_generate       = false;
+	profile_use            = false;
+	forced_unittype        = COMPILATION_UNIT_AUTODETECT;
+	predef_optimize        = false;
+	predef_optimize_size   = false;
+	help                   = HELP_NONE;
+}
+
 bool simple_arg(const char *arg, options_state_t *s)
 {
 	assert(s->argv[s->i][0] == '-');
@@ -185,6 +203,11 @@ add_arg_opt:
 		driver_add_flag(&cppflags_obst, "-isystem");
 		driver_add_flag(&cppflags_obst, "%s", arg);
 		append_include_path(&system_searchpath, arg, false);
+	} else if ((arg = prefix_arg("ivfspack", s)) != NULL) {
+		/* external preprocessors cannot read pack files */
+		if (driver_use_integrated_preprocessor == -1)
+			driver_use_integrated_preprocessor = true;
+		vfs_pack_load(arg);
 	} else if ((arg = prefix_arg("iquote", s)) != NULL) {
 		driver_add_flag(&cppflags_obst, "-iquote");
 		driver_add_flag(&cppflags_obst, "%s", arg);
@@ -334,6 +357,24 @@ bool options_parse_driver(options_state_t *s)
 		produce_statev = true;
 	} else if ((arg = equals_arg("-filtev", s)) != NULL) {
 		filtev = arg;
+	} else if ((arg = equals_arg("-opt-profile", s)) != NULL) {
+		set_opt_profile_file(arg);
+	} else if ((arg = equals_arg("-cache-dir", s)) != NULL) {
+		cache_dir = arg;
+	} else if ((arg = equals_arg("-cache-size", s)) != NULL) {
+		/* the size is given in MiB */
+		char *end;
+		errno = 0;
+		unsigned long long const size = strtoull(arg, &end, 10);
+		if (!isdigit((unsigned char)arg[0]) || *end != '\0' || errno != 0
+		 || size > ULLONG_MAX / (1024 * 1024)) {
+			errorf(NULL, "invalid cache size '%s'", arg);
+			s->argument_errors = true;
+		} else {
+			cache_max_size = size * 1024 * 1024;
+		}
+	} else if (simple_arg("-cache-stats", s)) {
+		s->action = action_print_cache_stats;
 	} else if (simple_arg("version", s) || simple_arg("-version", s)) {
 		s->action = action_version;
 	} else if (simple_arg("dumpversion", s)) {
@@ -371,12 +412,14 @@ bool options_parse_linker(options_state_t *s)
 	        || simple_arg("pie", s)
 	        || simple_arg("rdynamic", s)
 	        || simple_arg("s", s)
-	        || simple_arg("shared", s)
 	        || simple_arg("shared-libgcc", s)
 	        || simple_arg("static-libgcc", s)
 	        || simple_arg("symbolic", s)
 	        || accept_prefix(s, "-Wl,", true, &arg)) {
 	    driver_add_flag(&ldflags_obst, full_option);
+	} else if (simple_arg("shared", s)) {
+		driver_link_shared = true;
+		driver_add_flag(&ldflags_obst, full_option);
 	} else if ((arg = spaced_arg("Xlinker", s)) != NULL) {
 		driver_add_flag(&ldflags_obst, "-Xlinker");
 		driver_add_flag(&ldflags_obst, arg);
@@ -490,6 +533,10 @@ bool options_parse_codegen(options_state_t *s)
 			} else if (f_yesno_arg("-frounding-math", s)) {
 				/* ignore for gcc compatibility: we don't have any unsafe
 				 * optimizations in that area */
+			} else if (f_yesno_arg("-flto", s)) {
+				driver_lto = truth_value;
+			} else if (f_yesno_arg("-fwhole-program", s)) {
+				driver_whole_program = truth_value;
 			} else if (f_yesno_arg("-fverbose-asm", s)) {
 				set_be_option(truth_value ? "verboseasm" : "verboseasm=no");
 			} else if (f_yesno_arg("-fPIC", s)) {
@@ -18,6 +18,12 @@ typedef struct options_state_t {
 	action_func action;
 } options_state_t;
 
+/**
+ * Restores the defaults of the settings kept by the option parser itself,
+ * the modules owning the other settings reset them when initialized.
+ */
+void init_options(void);
+
 bool options_parse_early_target(options_state_t *state);
 bool options_parse_early_codegen(options_state_t *state);
 bool options_parse_early_sysroot(options_state_t *state);
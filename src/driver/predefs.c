@@ -233,6 +233,10 @@ void add_predefined_macros(void)
 
 	if (dialect.c99)
 		add_define("__STDC_VERSION__", "199901L", true);
+	/* results of __has_embed */
+	add_define("__STDC_EMBED_NOT_FOUND__", "0", true);
+	add_define("__STDC_EMBED_FOUND__",     "1", true);
+	add_define("__STDC_EMBED_EMPTY__",     "2", true);
 	if (dialect.cpp)
 		add_define("__cplusplus", "1", true);
 	if (!dialect.gnu && !dialect.ms && !dialect.cpp)
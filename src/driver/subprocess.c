@@ -0,0 +1,148 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "enable_posix.h"
+#include "subprocess.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adt/array.h"
+#include "adt/panic.h"
+#include "diagnostic.h"
+#include "driver.h"
+
+#ifdef HAVE_POSIX_SPAWN
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+typedef struct command_pipe_t {
+	FILE *file;
+	pid_t pid;
+} command_pipe_t;
+
+static command_pipe_t *command_pipes;
+
+/**
+ * Executes the command without a shell. If @p child_fd is not negative it
+ * becomes the file descriptor @p redirect of the child while @p parent_fd is
+ * closed in the child.
+ */
+static bool spawn(char const *const commandline, int const child_fd,
+                  int const redirect, int const parent_fd, pid_t *const pid)
+{
+	char **const argv = split_commandline(commandline);
+	if (argv[0] == NULL) {
+		DEL_ARR_F(argv);
+		errorf(NULL, "empty command line");
+		return false;
+	}
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	if (child_fd >= 0) {
+		posix_spawn_file_actions_adddup2(&actions, child_fd, redirect);
+		posix_spawn_file_actions_addclose(&actions, child_fd);
+		posix_spawn_file_actions_addclose(&actions, parent_fd);
+	}
+	int const err = posix_spawnp(pid, argv[0], &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (err != 0)
+		errorf(NULL, "could not execute '%s': %s", argv[0], strerror(err));
+	/* the arguments are the last thing allocated on file_obst */
+	obstack_free(&file_obst, argv[0]);
+	DEL_ARR_F(argv);
+	return err == 0;
+}
+
+static int wait_for(pid_t const pid)
+{
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return EXIT_FAILURE;
+	}
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status); /* like the shell reports it */
+	return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+
+int run_command(char const *const commandline)
+{
+	pid_t pid;
+	if (!spawn(commandline, -1, -1, -1, &pid))
+		return EXIT_FAILURE;
+	return wait_for(pid);
+}
+
+FILE *open_command_pipe(char const *const commandline, bool const to_stdin)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return NULL;
+	int const child_fd  = to_stdin ? fds[0] : fds[1];
+	int const parent_fd = to_stdin ? fds[1] : fds[0];
+	/* later children must not keep our end of the pipe open */
+	fcntl(parent_fd, F_SETFD, FD_CLOEXEC);
+
+	int const  redirect = to_stdin ? STDIN_FILENO : STDOUT_FILENO;
+	pid_t      pid;
+	bool const spawned  = spawn(commandline, child_fd, redirect, parent_fd, &pid);
+	close(child_fd);
+	if (!spawned) {
+		close(parent_fd);
+		return NULL;
+	}
+
+	FILE *const file = fdopen(parent_fd, to_stdin ? "w" : "r");
+	if (file == NULL) {
+		close(parent_fd);
+		wait_for(pid);
+		return NULL;
+	}
+
+	if (command_pipes == NULL)
+		command_pipes = NEW_ARR_F(command_pipe_t, 0);
+	command_pipe_t const entry = { file, pid };
+	ARR_APP1(command_pipe_t, command_pipes, entry);
+	return file;
+}
+
+int close_command_pipe(FILE *const pipe)
+{
+	size_t const n = command_pipes != NULL ? ARR_LEN(command_pipes) : 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (command_pipes[i].file != pipe)
+			continue;
+		pid_t const pid = command_pipes[i].pid;
+		command_pipes[i] = command_pipes[n - 1];
+		ARR_SHRINKLEN(command_pipes, n - 1);
+		fclose(pipe);
+		return wait_for(pid);
+	}
+	panic("not a command pipe");
+}
+
+#else
+
+int run_command(char const *const commandline)
+{
+	return system(commandline);
+}
+
+FILE *open_command_pipe(char const *const commandline, bool const to_stdin)
+{
+	return popen(commandline, to_stdin ? "w" : "r");
+}
+
+int close_command_pipe(FILE *const pipe)
+{
+	return pclose(pipe);
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#ifndef SUBPROCESS_H
+#define SUBPROCESS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Runs a command line built with driver_add_flag() and waits for it.
+ * Where posix_spawn() is available the command is executed directly without
+ * going through /bin/sh.
+ *
+ * @return EXIT_SUCCESS if the command ran and exited successfully
+ */
+int run_command(char const *commandline);
+
+/**
+ * Starts a command line built with driver_add_flag() connected to a pipe:
+ * writing to the returned file feeds the stdin of the command if @p to_stdin
+ * is set, otherwise the stdout of the command can be read from it.
+ * Finish it with close_command_pipe().
+ */
+FILE *open_command_pipe(char const *commandline, bool to_stdin);
+
+/**
+ * Closes a pipe returned by open_command_pipe() and waits for the command.
+ *
+ * @return the exit status of the command, EXIT_SUCCESS if it exited
+ *         successfully
+ */
+int close_command_pipe(FILE *pipe);
+
+#endif
@@ -19,15 +19,25 @@
 #include "target.h"
 #include "warning.h"
 
-target_t target = {
+static target_t const default_target = {
 	.biggest_alignment = 16,
 	.pic_mode          = -1,
 	.user_label_prefix = "",
 };
+
+target_t target;
 const char *multilib_directory_target_triple;
 unsigned target_size_override;
 static const char *experimental_backend;
 
+void init_target(void)
+{
+	target                           = default_target;
+	multilib_directory_target_triple = NULL;
+	target_size_override             = 0;
+	experimental_backend             = NULL;
+}
+
 void target_adjust_types_and_dialect(void)
 {
 	init_types(dialect.int_size, dialect.long_size, dialect.pointer_size);
@@ -160,7 +170,7 @@ static bool is_amd64_cpu(char const *const cpu)
 	return streq(cpu, "x86_64") || streq(cpu, "amd64");
 }
 
-static void set_options_for_machine(machine_triple_t const *const machine)
+static bool set_options_for_machine(machine_triple_t const *const machine)
 {
 	/* Note: Code here should only check the target triple! Querying other
 	 * target features is not allowed as subsequent commandline options may
@@ -228,6 +238,7 @@ static void set_options_for_machine(machine_triple_t const *const machine)
 		 * below) */
 		dialect.long_long_and_double_struct_align = 4;
 		dialect.long_double_x87_80bit_float       = true;
+		dialect.total_store_order                 = true;
 	} else if (streq(cpu, "sparc")) {
 		ppdefc("sparc",     "1", cond_not_strict);
 		ppdef( "__sparc",   "1");
@@ -245,6 +256,8 @@ static void set_options_for_machine(machine_triple_t const *const machine)
 		long_double_size   = 16;
 		float_int_overflow = ir_overflow_min_max;
 		target.byte_order_big_endian = true;
+		/* the usual memory model of sparc */
+		dialect.total_store_order    = true;
 	} else if (streq(cpu, "arm")) {
 		/* TODO: test, what about
 		 * ARM_FEATURE_UNALIGNED, ARMEL, ARM_ARCH_7A, ARM_FEATURE_DSP, ... */
@@ -267,9 +280,10 @@ static void set_options_for_machine(machine_triple_t const *const machine)
 		long_double_size   = 16;
 		float_int_overflow = ir_overflow_indefinite;
 		dialect.long_double_x87_80bit_float = true;
+		dialect.total_store_order           = true;
 	} else {
 		errorf(NULL, "unknown cpu '%s' in target-triple", cpu);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 
 	target.firm_isa            = firm_isa;
@@ -371,8 +385,9 @@ static void set_options_for_machine(machine_triple_t const *const machine)
 		}
 	} else {
 		errorf(NULL, "unknown operating system '%s' in target-triple", os);
-		exit(EXIT_FAILURE);
+		return false;
 	}
+	return true;
 }
 
 void warn_experimental_target(void)
@@ -419,13 +434,12 @@ static bool pass_options_to_firm_be(void)
 	case OBJECT_FORMAT_PE_COFF: set_be_option("objectformat=coff");   break;
 	}
 
-	if (profile_generate) {
+	/* only the middle-end counts blocks, into <input>.irprof: the profile
+	 * changes its decisions, so the graphs reaching the backend differ
+	 * between the instrumented and the optimized build */
+	if (profile_generate)
 		driver_add_flag(&ldflags_obst, "-lfirmprof");
-		set_be_option("profilegenerate");
-	}
-	if (profile_use) {
-		set_be_option("profileuse");
-	}
+	set_profile_feedback(profile_generate, profile_use);
 	bool res = true;
 	const char *pic_option;
 	if (target.pic_mode > 0) {
@@ -547,10 +561,10 @@ static void determine_target_machine(void)
 	}
 }
 
-void target_set_defaults(void)
+bool target_set_defaults(void)
 {
 	determine_target_machine();
-	set_options_for_machine(target.machine);
+	return set_options_for_machine(target.machine);
 }
 
 bool target_setup(void)
@@ -59,7 +59,11 @@ typedef struct target_t {
 
 extern target_t target;
 
-void target_set_defaults(void);
+/** Restores the settings before any option was parsed. */
+void init_target(void);
+/** Applies the defaults of the target triple, returns false if the triple is
+ * not supported. */
+bool target_set_defaults(void);
 bool target_setup(void);
 void warn_experimental_target(void);
 
@@ -2,6 +2,9 @@
  * This file is part of cparser.
  * Copyright (C) 2013 Matthias Braun <matze@braunis.de>
  */
+#ifdef __linux__
+#define _GNU_SOURCE /* Required for memfd_create(). */
+#endif
 #include "enable_posix.h"
 #include "tempfile.h"
 
@@ -9,6 +12,13 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#ifdef MFD_CLOEXEC
+#define HAVE_MEMFD_CREATE
+#endif
+#endif
 
 #include "adt/array.h"
 #include "adt/panic.h"
@@ -16,6 +26,9 @@
 #include "diagnostic.h"
 
 static char         **temp_files;
+#ifdef HAVE_MEMFD_CREATE
+static int           *temp_fds;
+#endif
 static struct obstack file_obst;
 static const char    *tempsubdir;
 
@@ -86,8 +99,51 @@ static const char *make_tempsubdir(const char *tempdir)
 	return dir;
 }
 
+#ifdef HAVE_MEMFD_CREATE
+/**
+ * Creates an anonymous in-memory file instead of a file in the temporary
+ * directory. The descriptor stays open until exit, so the tools we run can
+ * open the file as /proc/PID/fd/N. It is not inherited, so children do not
+ * keep the files of each other alive.
+ */
+static FILE *make_memfd_temp_file(const char *name_orig,
+                                  const char **name_result)
+{
+	static int have_proc_fds = -1;
+	if (have_proc_fds < 0)
+		have_proc_fds = access("/proc/self/fd", R_OK | X_OK) == 0;
+	if (!have_proc_fds)
+		return NULL;
+
+	int const fd = memfd_create(name_orig, MFD_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	/* the caller closes the returned file, so hand out a duplicate */
+	int   const dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	FILE *const out    = dup_fd >= 0 ? fdopen(dup_fd, "w") : NULL;
+	if (out == NULL) {
+		if (dup_fd >= 0)
+			close(dup_fd);
+		close(fd);
+		return NULL;
+	}
+
+	assert(obstack_object_size(&file_obst) == 0);
+	obstack_printf(&file_obst, "/proc/%ld/fd/%d", (long)getpid(), fd);
+	ARR_APP1(int, temp_fds, fd);
+	*name_result = obstack_nul_finish(&file_obst);
+	return out;
+}
+#endif
+
 FILE *make_temp_file(const char *name_orig, const char **name_result)
 {
+#ifdef HAVE_MEMFD_CREATE
+	FILE *const memfd_out = make_memfd_temp_file(name_orig, name_result);
+	if (memfd_out != NULL)
+		return memfd_out;
+#endif
+
 	if (tempsubdir == NULL)
 		tempsubdir = make_tempsubdir(get_tempdir());
 
@@ -113,7 +169,14 @@ void init_temp_files(void)
 
 	tempsubdir = NULL;
 	temp_files = NEW_ARR_F(char*, 0);
-	atexit(exit_temp_files);
+#ifdef HAVE_MEMFD_CREATE
+	temp_fds   = NEW_ARR_F(int, 0);
+#endif
+	static bool registered;
+	if (!registered) {
+		atexit(exit_temp_files);
+		registered = true;
+	}
 }
 
 void exit_temp_files(void)
@@ -130,6 +193,14 @@ void exit_temp_files(void)
 	DEL_ARR_F(temp_files);
 	temp_files = NULL;
 
+#ifdef HAVE_MEMFD_CREATE
+	for (size_t i = 0, n = ARR_LEN(temp_fds); i < n; ++i) {
+		close(temp_fds[i]);
+	}
+	DEL_ARR_F(temp_fds);
+	temp_fds = NULL;
+#endif
+
 	if (tempsubdir != NULL) {
 		remove(tempsubdir);
 		tempsubdir = NULL;
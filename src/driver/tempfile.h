@@ -5,7 +5,8 @@
 
 /**
  * Creates temporary files named $name_orig inside a temporary
- * directory created with mkdtemp().
+ * directory created with mkdtemp(). Where memfd_create() and /proc are
+ * available an in-memory file named /proc/PID/fd/N is created instead.
  */
 FILE *make_temp_file(const char *name_orig, const char **name_result);
 
@@ -13,7 +13,7 @@
 #include "diagnostic.h"
 #include "help.h"
 
-static warning_switch_t warning[] = {
+static warning_switch_t const default_warning[] = {
 #define ERR WARN_STATE_ON | WARN_STATE_ERROR
 #define ON  WARN_STATE_ON
 #define OFF WARN_STATE_NONE
@@ -24,6 +24,13 @@ static warning_switch_t warning[] = {
 #undef ON
 };
 
+static warning_switch_t warning[ARRAY_SIZE(default_warning)];
+
+void init_warnings(void)
+{
+	memcpy(warning, default_warning, sizeof(warning));
+}
+
 warning_switch_t const *get_warn_switch(warning_t const w)
 {
 	assert((size_t)w < ARRAY_SIZE(warning));
@@ -7,6 +7,9 @@
 
 #include <stdbool.h>
 
+/** Restores the default state of all warnings. */
+void init_warnings(void);
+
 void set_warning_opt(const char *opt);
 
 void disable_all_warnings(void);
@@ -13,6 +13,7 @@
 #include <unistd.h>
 
 #include "adt/array.h"
+#include "adt/bitfiddle.h"
 #include "adt/panic.h"
 #include "adt/strutil.h"
 #include "adt/unicode.h"
@@ -33,6 +34,7 @@
 #include "driver/diagnostic.h"
 #include "driver/warning.h"
 #include "firm/firm_opt.h"
+#include "firm/function_cache.h"
 #include "jump_target.h"
 #include "mangle.h"
 #include "parser/parser.h"
@@ -797,6 +799,48 @@ static ir_node *conv_to_storage_type(dbg_info *const dbgi, ir_node *const val, t
 	return create_conv(dbgi, val, mode);
 }
 
+/** Shared initializers of the 256 byte values in one character mode. */
+typedef struct char_initializers_t {
+	ir_mode          *mode;
+	ir_initializer_t *values[256];
+} char_initializers_t;
+
+/** one cache each for char, wchar_t, char16_t and char32_t strings */
+static char_initializers_t char_initializers[4];
+
+/**
+ * Returns an initializer for a character of a string. The initializers of
+ * the 256 byte values are created once per mode and shared by all strings,
+ * so a string only costs its compound initializer.
+ */
+static ir_initializer_t *get_char_initializer(ir_mode *const mode,
+                                              long const value)
+{
+	unsigned char const slot   = (unsigned char)value;
+	long          const cached = mode_is_signed(mode) ? (signed char)slot : slot;
+	char_initializers_t *cache = NULL;
+	if (cached == value) {
+		for (size_t i = 0; i != ARRAY_SIZE(char_initializers); ++i) {
+			char_initializers_t *const c = &char_initializers[i];
+			if (c->mode == NULL)
+				c->mode = mode;
+			if (c->mode == mode) {
+				cache = c;
+				break;
+			}
+		}
+	}
+	if (cache == NULL)
+		return create_initializer_tarval(new_tarval_from_long(value, mode));
+
+	ir_initializer_t *init = cache->values[slot];
+	if (init == NULL) {
+		init = create_initializer_tarval(new_tarval_from_long(value, mode));
+		cache->values[slot] = init;
+	}
+	return init;
+}
+
 /**
  * Creates a node representing a string constant.
  *
@@ -823,8 +867,7 @@ static ir_node *string_to_firm(position_t const *const src_pos,
 		ir_mode *const mode = get_type_mode(elem_type);
 		char const    *p    = value->begin;
 		for (size_t i = 0; i < slen; ++i) {
-			ir_tarval        *tv  = new_tarval_from_long(*p++, mode);
-			ir_initializer_t *val = create_initializer_tarval(tv);
+			ir_initializer_t *val = get_char_initializer(mode, *p++);
 			set_initializer_compound_value(initializer, i, val);
 		}
 		goto finish;
@@ -842,8 +885,7 @@ init_wide:
 		for (size_t i = 0; i < slen; ++i) {
 			assert(p <= value->begin + value->size);
 			utf32             v   = read_utf8_char(&p);
-			ir_tarval        *tv  = new_tarval_from_long(v, mode);
-			ir_initializer_t *val = create_initializer_tarval(tv);
+			ir_initializer_t *val = get_char_initializer(mode, v);
 			set_initializer_compound_value(initializer, i, val);
 		}
 		goto finish;
@@ -876,6 +918,24 @@ static ir_node *string_literal_to_firm(string_literal_expression_t const *const
 	return string_to_firm(&expr->base.pos, expr->value);
 }
 
+/**
+ * Check that the target supports atomic accesses to objects of @p type: The
+ * backends split accesses larger than a pointer. Ordered (not relaxed)
+ * accesses are plain loads and stores or compare-and-swap operations without
+ * further barriers, which is only correct with total store order.
+ */
+static void check_atomic_access(dbg_info *const dbgi, type_t *const type,
+                                bool const ordered)
+{
+	position_t const *const pos  = (position_t const*)dbgi;
+	unsigned          const size = get_ctype_size(type);
+	if (size > dialect.pointer_size || !is_po2(size)) {
+		errorf(pos, "atomic access to '%T' not supported by the target", type);
+	} else if (ordered && !dialect.total_store_order) {
+		errorf(pos, "atomic access with memory order other than relaxed not supported by the target");
+	}
+}
+
 /**
  * Dereference an address.
  *
@@ -896,8 +956,10 @@ static ir_node *deref_address(dbg_info *const dbgi, type_t *const type,
 		return addr;
 	}
 
-	ir_cons_flags  flags    = skipped->base.qualifiers & TYPE_QUALIFIER_VOLATILE
+	ir_cons_flags  flags    = skipped->base.qualifiers & (TYPE_QUALIFIER_VOLATILE | TYPE_QUALIFIER_ATOMIC)
 	                          ? cons_volatile : cons_none;
+	if (skipped->base.qualifiers & TYPE_QUALIFIER_ATOMIC)
+		check_atomic_access(dbgi, skipped, true);
 	ir_type *const irtype   = get_ir_type(skipped);
 	ir_mode *const mode     = get_type_mode(irtype);
 	ir_node *const memory   = get_store();
@@ -919,6 +981,140 @@ static void keep_loop(void)
 	get_store(); /* force creation of PhiM in loops */
 }
 
+/**
+ * Load a value, which may be modified concurrently, from an address.
+ */
+static ir_node *atomic_load(dbg_info *const dbgi, ir_node *const addr,
+                            type_t *const type)
+{
+	ir_type *const irtype   = get_ir_type(type);
+	ir_mode *const mode     = get_type_mode(irtype);
+	ir_node *const memory   = get_store();
+	ir_node *const load     = new_d_Load(dbgi, memory, addr, mode, irtype, cons_volatile);
+	ir_node *const load_mem = new_d_Proj(dbgi, load, mode_M, pn_Load_M);
+	ir_node *const load_res = new_d_Proj(dbgi, load, mode,   pn_Load_res);
+
+	set_store(load_mem);
+	return load_res;
+}
+
+/**
+ * Atomically replace the value at addr by new_value, if it equals old.
+ * This is the only atomic read-modify-write operation in firm, so it is also
+ * used as full memory barrier.
+ *
+ * @return the value found at addr
+ */
+static ir_node *compare_swap(dbg_info *const dbgi, ir_node *const addr,
+                             ir_node *const old, ir_node *const new_value,
+                             type_t *const type)
+{
+	ir_type *const irtype      = get_ir_type(type);
+	ir_type *const method_type = new_type_method(3, 1);
+	set_method_param_type(method_type, 0, get_ir_type(type_void_ptr));
+	set_method_param_type(method_type, 1, irtype);
+	set_method_param_type(method_type, 2, irtype);
+	set_method_res_type(method_type, 0, irtype);
+
+	ir_node *const in[]    = { addr, old, new_value };
+	ir_node *const memory  = get_store();
+	ir_node *const builtin = new_d_Builtin(dbgi, memory, ARRAY_SIZE(in), in, ir_bk_compare_swap, method_type);
+	set_store(new_d_Proj(dbgi, builtin, mode_M, pn_Builtin_M));
+	return new_d_Proj(dbgi, builtin, get_type_mode(irtype), pn_Builtin_max+1);
+}
+
+/**
+ * Return the type compare-and-swap operates on for objects of @p type.
+ * Floating point values are swapped as integers, because comparing them does
+ * not compare their bits.
+ */
+static type_t *get_atomic_bits_type(type_t *const type)
+{
+	if (!is_type_float(type))
+		return type;
+	return get_ctype_size(type) == get_ctype_size(type_unsigned_int)
+	     ? type_unsigned_int : type_unsigned_long_long;
+}
+
+/**
+ * Reinterpret the bits of @p value of type @p from as type @p to of the same
+ * size. Conversions between float and integer modes are numeric, so the value
+ * goes through a frame slot.
+ */
+static ir_node *reinterpret_bits(dbg_info *const dbgi, ir_node *const value,
+                                 type_t *const from, type_t *const to)
+{
+	if (!is_type_float(from) && !is_type_float(to))
+		return value;
+
+	ir_graph  *const irg       = current_ir_graph;
+	ir_type   *const from_type = get_ir_type(from);
+	ident     *const id        = id_unique("bits.%u");
+	ir_entity *const slot      = new_entity(get_irg_frame_type(irg), id, from_type);
+	ir_node   *const addr      = new_d_Member(dbgi, get_irg_frame(irg), slot);
+	set_entity_visibility(slot, ir_visibility_private);
+
+	ir_node *const store = new_d_Store(dbgi, get_store(), addr, value, from_type, cons_none);
+	set_store(new_d_Proj(dbgi, store, mode_M, pn_Store_M));
+
+	ir_type *const to_type = get_ir_type(to);
+	ir_mode *const mode    = get_type_mode(to_type);
+	ir_node *const load    = new_d_Load(dbgi, get_store(), addr, mode, to_type, cons_none);
+	set_store(new_d_Proj(dbgi, load, mode_M, pn_Load_M));
+	return new_d_Proj(dbgi, load, mode, pn_Load_res);
+}
+
+/**
+ * Start a compare-and-swap loop: The code up to finish_cas_loop() is repeated
+ * until the swap succeeds.
+ */
+static void begin_cas_loop(jump_target *const retry_target)
+{
+	init_jump_target(retry_target, NULL);
+	jump_to_target(retry_target);
+	enter_immature_jump_target(retry_target);
+	keep_loop();
+}
+
+/**
+ * Load the value of an object of @p type at @p addr inside a
+ * compare-and-swap loop. @p old_bits receives the value to pass to
+ * finish_cas_loop().
+ */
+static ir_node *load_in_cas_loop(dbg_info *const dbgi, ir_node *const addr,
+                                 type_t *const type, ir_node **const old_bits)
+{
+	type_t  *const bits_type = get_atomic_bits_type(type);
+	ir_node *const bits      = atomic_load(dbgi, addr, bits_type);
+	*old_bits = bits;
+	return reinterpret_bits(dbgi, bits, bits_type, type);
+}
+
+/**
+ * Finish a compare-and-swap loop by trying to replace old_bits, which were
+ * loaded from addr inside the loop, by new_value.
+ */
+static void finish_cas_loop(dbg_info *const dbgi,
+                            jump_target *const retry_target, ir_node *const addr,
+                            ir_node *const old_bits, ir_node *const new_value,
+                            type_t *const type)
+{
+	type_t  *const bits_type  = get_atomic_bits_type(type);
+	ir_node *const new_bits   = reinterpret_bits(dbgi, new_value, type, bits_type);
+	ir_node *const found      = compare_swap(dbgi, addr, old_bits, new_bits, bits_type);
+	ir_node *const cmp        = new_d_Cmp(dbgi, found, old_bits, ir_relation_equal);
+	ir_node *const cond       = new_d_Cond(dbgi, cmp);
+	ir_node *const true_proj  = new_d_Proj(dbgi, cond, mode_X, pn_Cond_true);
+	ir_node *const false_proj = new_d_Proj(dbgi, cond, mode_X, pn_Cond_false);
+
+	jump_target done_target;
+	init_jump_target(&done_target, NULL);
+	add_pred_to_jump_target(&done_target, true_proj);
+	add_pred_to_jump_target(retry_target, false_proj);
+	enter_jump_target(retry_target);
+	enter_jump_target(&done_target);
+}
+
 static ir_node *reference_addr(const reference_expression_t *ref)
 {
 	dbg_info *dbgi   = get_dbg_info(&ref->base.pos);
@@ -1002,6 +1198,247 @@ static ir_node *reference_expression_to_firm(const reference_expression_t *ref)
 	}
 }
 
+/** Memory orders of the __atomic builtins, numbered like in C11. */
+typedef enum memory_order_t {
+	MEMORY_ORDER_RELAXED,
+	MEMORY_ORDER_CONSUME,
+	MEMORY_ORDER_ACQUIRE,
+	MEMORY_ORDER_RELEASE,
+	MEMORY_ORDER_ACQ_REL,
+	MEMORY_ORDER_SEQ_CST,
+} memory_order_t;
+
+/**
+ * Evaluate the memory order argument of an atomic builtin.  A missing or
+ * non-constant order is treated as the strongest one.
+ */
+static memory_order_t get_memory_order(call_argument_t const *const argument)
+{
+	if (argument == NULL)
+		return MEMORY_ORDER_SEQ_CST;
+
+	expression_t *const order = argument->expression;
+	if (is_constant_expression(order) == EXPR_CLASS_VARIABLE) {
+		expression_to_value(order);
+		return MEMORY_ORDER_SEQ_CST;
+	}
+	long const val = fold_expression_to_int(order);
+	return 0 <= val && val < MEMORY_ORDER_SEQ_CST ? (memory_order_t)val
+	                                              : MEMORY_ORDER_SEQ_CST;
+}
+
+/** Return the type of the object accessed by an atomic builtin. */
+static type_t *get_atomic_builtin_type(call_expression_t const *const call)
+{
+	type_t *const ptr_type = skip_typeref(call->arguments->expression->base.type);
+	assert(is_type_pointer(ptr_type));
+	return skip_typeref(ptr_type->pointer.points_to);
+}
+
+static ir_node *atomic_op_to_firm(dbg_info *const dbgi, atomic_op_t const op,
+                                  ir_node *const left, ir_node *const right,
+                                  ir_mode *const mode)
+{
+	switch (op) {
+	case ATOMIC_OP_ADD:  return new_d_Add(dbgi, left, right, mode);
+	case ATOMIC_OP_SUB:  return new_d_Sub(dbgi, left, right, mode);
+	case ATOMIC_OP_AND:  return new_d_And(dbgi, left, right, mode);
+	case ATOMIC_OP_OR:   return new_d_Or( dbgi, left, right, mode);
+	case ATOMIC_OP_XOR:  return new_d_Eor(dbgi, left, right, mode);
+	case ATOMIC_OP_NAND: return new_d_Not(dbgi, new_d_And(dbgi, left, right, mode), mode);
+	}
+	panic("invalid atomic operation");
+}
+
+/**
+ * Branch on whether a compare-and-swap found the expected value.
+ */
+static void compare_swap_to_control_flow(dbg_info *const dbgi,
+                                         ir_node *const found,
+                                         ir_node *const expected,
+                                         jump_target *const true_target,
+                                         jump_target *const false_target)
+{
+	ir_node *const cmp        = new_d_Cmp(dbgi, found, expected, ir_relation_equal);
+	ir_node *const cond       = new_d_Cond(dbgi, cmp);
+	ir_node *const true_proj  = new_d_Proj(dbgi, cond, mode_X, pn_Cond_true);
+	ir_node *const false_proj = new_d_Proj(dbgi, cond, mode_X, pn_Cond_false);
+	add_pred_to_jump_target(true_target,  true_proj);
+	add_pred_to_jump_target(false_target, false_proj);
+	set_unreachable_now();
+}
+
+static void assign_value(dbg_info *dbgi, ir_node *addr, type_t *type,
+                         ir_node *value);
+
+static ir_node *control_flow_to_1_0(expression_t const *expr,
+                                    jump_target *true_target,
+                                    jump_target *false_target);
+
+/**
+ * Transform calls to the __atomic and __sync builtins.
+ */
+static ir_node *process_atomic_builtin_call(call_expression_t const *const call,
+                                            builtin_kind_t const kind)
+{
+	dbg_info *const dbgi = get_dbg_info(&call->base.pos);
+
+	if (kind == BUILTIN_ATOMIC_FENCE) {
+		if (get_memory_order(call->arguments) == MEMORY_ORDER_RELAXED)
+			return NULL;
+		check_atomic_access(dbgi, type_int, true);
+		/* Firm has no fence operation, so swap a frame slot.  This is
+		 * stronger than needed for acquire/release and signal fences, but
+		 * ordered by the backend like any other atomic operation. */
+		ir_graph  *const irg    = current_ir_graph;
+		ir_type   *const frame  = get_irg_frame_type(irg);
+		ident     *const id     = id_unique("fence.%u");
+		ir_entity *const slot   = new_entity(frame, id, get_ir_type(type_int));
+		ir_node   *const addr   = new_d_Member(dbgi, get_irg_frame(irg), slot);
+		ir_mode   *const mode   = get_ir_mode_storage(type_int);
+		ir_node   *const zero   = new_Const(get_mode_null(mode));
+		set_entity_visibility(slot, ir_visibility_private);
+		compare_swap(dbgi, addr, zero, zero, type_int);
+		return NULL;
+	}
+
+	call_argument_t const *const ptr  = call->arguments;
+	type_t                *const type = get_atomic_builtin_type(call);
+	ir_node               *const addr = expression_to_value(ptr->expression);
+
+	switch (kind) {
+	case BUILTIN_ATOMIC_LOAD: {
+		/* With total store order loads need no barrier, as sequentially
+		 * consistent stores are read-modify-write operations. */
+		memory_order_t const order = get_memory_order(ptr->next);
+		check_atomic_access(dbgi, type, order != MEMORY_ORDER_RELAXED);
+		return atomic_load(dbgi, addr, type);
+	}
+
+	case BUILTIN_ATOMIC_STORE: {
+		call_argument_t const *const value_arg = ptr->next;
+		ir_node                     *value;
+		memory_order_t               order;
+		if (value_arg != NULL) {
+			value = expression_to_value(value_arg->expression);
+			value = conv_to_storage_type(dbgi, value, type);
+			order = get_memory_order(value_arg->next);
+		} else {
+			/* __sync_lock_release() */
+			value = new_Const(get_mode_null(get_ir_mode_storage(type)));
+			order = MEMORY_ORDER_RELEASE;
+		}
+		check_atomic_access(dbgi, type, order != MEMORY_ORDER_RELAXED);
+
+		if (order == MEMORY_ORDER_SEQ_CST) {
+			/* must not be reordered with later loads, so swap it in */
+			jump_target retry_target;
+			begin_cas_loop(&retry_target);
+			ir_node *old_bits;
+			load_in_cas_loop(dbgi, addr, type, &old_bits);
+			finish_cas_loop(dbgi, &retry_target, addr, old_bits, value, type);
+		} else {
+			ir_type *const irtype    = get_ir_type(type);
+			ir_node *const memory    = get_store();
+			ir_node *const store     = new_d_Store(dbgi, memory, addr, value, irtype, cons_volatile);
+			ir_node *const store_mem = new_d_Proj(dbgi, store, mode_M, pn_Store_M);
+			set_store(store_mem);
+		}
+		return NULL;
+	}
+
+	case BUILTIN_ATOMIC_EXCHANGE: {
+		call_argument_t const *const value_arg = ptr->next;
+		ir_node               *const value     = conv_to_storage_type(dbgi,
+			expression_to_value(value_arg->expression), type);
+		memory_order_t         const order     = get_memory_order(value_arg->next);
+		check_atomic_access(dbgi, type, order != MEMORY_ORDER_RELAXED);
+
+		jump_target retry_target;
+		begin_cas_loop(&retry_target);
+		ir_node       *old_bits;
+		ir_node *const old = load_in_cas_loop(dbgi, addr, type, &old_bits);
+		finish_cas_loop(dbgi, &retry_target, addr, old_bits, value, type);
+		return old;
+	}
+
+	case BUILTIN_ATOMIC_FETCH_OP:
+	case BUILTIN_ATOMIC_OP_FETCH: {
+		reference_expression_t const *const ref = &call->function->reference;
+		atomic_op_t            const        op  = ref->entity->function.b.atomic_op;
+
+		call_argument_t const *const value_arg = ptr->next;
+		ir_mode               *const mode      = get_ir_mode_arithmetic(type);
+		ir_node               *const operand   = create_conv(dbgi,
+			expression_to_value(value_arg->expression), mode);
+		memory_order_t         const order     = get_memory_order(value_arg->next);
+		check_atomic_access(dbgi, type, order != MEMORY_ORDER_RELAXED);
+
+		jump_target retry_target;
+		begin_cas_loop(&retry_target);
+		ir_node       *old_bits;
+		ir_node *const old       = load_in_cas_loop(dbgi, addr, type, &old_bits);
+		ir_node *const old_arith = create_conv(dbgi, old, mode);
+		ir_node *const result    = atomic_op_to_firm(dbgi, op, old_arith, operand, mode);
+		ir_node *const new_value = conv_to_storage_type(dbgi, result, type);
+		finish_cas_loop(dbgi, &retry_target, addr, old_bits, new_value, type);
+		return kind == BUILTIN_ATOMIC_FETCH_OP ? old : new_value;
+	}
+
+	case BUILTIN_ATOMIC_COMPARE_EXCHANGE: {
+		call_argument_t const *const expected_arg = ptr->next;
+		call_argument_t const *const desired_arg  = expected_arg->next;
+		call_argument_t const *const weak_arg     = desired_arg->next;
+		ir_node               *const expected_addr
+			= expression_to_value(expected_arg->expression);
+		ir_node               *const desired      = conv_to_storage_type(dbgi,
+			expression_to_value(desired_arg->expression), type);
+		/* a strong compare-and-swap is a valid weak one */
+		expression_to_value(weak_arg->expression);
+		memory_order_t const order = get_memory_order(weak_arg->next);
+		get_memory_order(weak_arg->next->next);
+		check_atomic_access(dbgi, type, order != MEMORY_ORDER_RELAXED);
+
+		ir_node *const expected = deref_address(dbgi, type, expected_addr);
+		ir_node *const found    = compare_swap(dbgi, addr, expected, desired, type);
+
+		jump_target true_target;
+		jump_target false_target;
+		jump_target fail_target;
+		init_jump_target(&true_target,  NULL);
+		init_jump_target(&false_target, NULL);
+		init_jump_target(&fail_target,  NULL);
+		compare_swap_to_control_flow(dbgi, found, expected, &true_target, &fail_target);
+		if (enter_jump_target(&fail_target)) {
+			assign_value(dbgi, expected_addr, type, found);
+			jump_to_target(&false_target);
+		}
+		return control_flow_to_1_0((expression_t const*)call, &true_target, &false_target);
+	}
+
+	case BUILTIN_SYNC_BOOL_COMPARE_SWAP: {
+		call_argument_t const *const old_arg   = ptr->next;
+		ir_node               *const old       = conv_to_storage_type(dbgi,
+			expression_to_value(old_arg->expression), type);
+		ir_node               *const new_value = conv_to_storage_type(dbgi,
+			expression_to_value(old_arg->next->expression), type);
+		check_atomic_access(dbgi, type, true);
+		ir_node               *const found     = compare_swap(dbgi, addr, old, new_value, type);
+
+		jump_target true_target;
+		jump_target false_target;
+		init_jump_target(&true_target,  NULL);
+		init_jump_target(&false_target, NULL);
+		compare_swap_to_control_flow(dbgi, found, old, &true_target, &false_target);
+		return control_flow_to_1_0((expression_t const*)call, &true_target, &false_target);
+	}
+
+	default:
+		break;
+	}
+	panic("invalid atomic builtin");
+}
+
 /**
  * Transform calls to builtin functions.
  */
@@ -1044,6 +1481,21 @@ static ir_node *process_builtin_call(const call_expression_t *call)
 		expression_t *argument = call->arguments->expression;
 		return expression_to_value(argument);
 	}
+	case BUILTIN_ASSUME_ALIGNED: {
+		/* Firm assumes memory accesses to be aligned anyway, so only evaluate
+		 * the optional offset for its side effects. */
+		call_argument_t const *const argument = call->arguments;
+		ir_node               *const ptr      = expression_to_value(argument->expression);
+		for (call_argument_t const *offset = argument->next->next; offset != NULL; offset = offset->next) {
+			expression_to_value(offset->expression);
+		}
+		return ptr;
+	}
+	case BUILTIN_UNREACHABLE:
+		/* A dead end, which is not kept alive: the control flow leading here
+		 * gets removed. */
+		set_soft_unreachable();
+		return NULL;
 	case BUILTIN_VA_END:
 		/* evaluate the argument of va_end for its side effects */
 		expression_to_value(call->arguments->expression);
@@ -1083,6 +1535,15 @@ static ir_node *process_builtin_call(const call_expression_t *call)
 		complex_value val = expression_to_complex(call->arguments->expression);
 		return val.real;
 	}
+	case BUILTIN_ATOMIC_COMPARE_EXCHANGE:
+	case BUILTIN_ATOMIC_EXCHANGE:
+	case BUILTIN_ATOMIC_FENCE:
+	case BUILTIN_ATOMIC_FETCH_OP:
+	case BUILTIN_ATOMIC_LOAD:
+	case BUILTIN_ATOMIC_OP_FETCH:
+	case BUILTIN_ATOMIC_STORE:
+	case BUILTIN_SYNC_BOOL_COMPARE_SWAP:
+		return process_atomic_builtin_call(call, builtin->entity->function.btk);
 	case BUILTIN_FIRM:
 		break;
 	case BUILTIN_LIBC:
@@ -1282,7 +1743,7 @@ static void assign_value(dbg_info *dbgi, ir_node *addr, type_t *type,
 	value = conv_to_storage_type(dbgi, value, type);
 
 	ir_node *memory = get_store();
-	ir_cons_flags flags = type->base.qualifiers & TYPE_QUALIFIER_VOLATILE
+	ir_cons_flags flags = type->base.qualifiers & (TYPE_QUALIFIER_VOLATILE | TYPE_QUALIFIER_ATOMIC)
 		? cons_volatile : cons_none;
 
 	ir_type *irtype = get_ir_type(type);
@@ -1512,6 +1973,35 @@ static ir_node *get_value_from_lvalue(const expression_t *expression,
 	return value;
 }
 
+/**
+ * Check whether a modification of an lvalue has to be an atomic
+ * read-modify-write operation, i.e. it is an _Atomic object in memory.
+ * Reports an error if the target cannot perform it, which includes all
+ * _Atomic structs and unions: They are copied with CopyB, which is never
+ * atomic, and there is no libatomic fallback.
+ */
+static bool is_atomic_lvalue(expression_t const *const expression,
+                             ir_node const *const addr)
+{
+	if (addr == NULL)
+		return false;
+	type_t *const type = skip_typeref(expression->base.type);
+	if (!(type->base.qualifiers & TYPE_QUALIFIER_ATOMIC))
+		return false;
+	if (expression->kind == EXPR_SELECT &&
+	    expression->select.compound_entry->compound_member.bitfield)
+		return false;
+	if (is_type_compound(type)) {
+		errorf(&expression->base.pos, "atomic access to '%T' not supported", type);
+		return false;
+	}
+	if (!is_type_integer(type) && !is_type_pointer(type)
+	 && !is_type_float(type))
+		return false;
+	check_atomic_access(get_dbg_info(&expression->base.pos), type, true);
+	return true;
+}
+
 static ir_node *incdec_to_firm(unary_expression_t const *const expr, bool const inc, bool const pre)
 {
 	type_t  *const type = skip_typeref(expr->base.type);
@@ -1530,13 +2020,28 @@ static ir_node *incdec_to_firm(unary_expression_t const *const expr, bool const
 	dbg_info           *const dbgi        = get_dbg_info(&expr->base.pos);
 	expression_t const *const value_expr  = expr->value;
 	ir_node            *const addr        = expression_to_addr(value_expr);
-	ir_node            *const value       = get_value_from_lvalue(value_expr, addr);
+	bool                const atomic      = is_atomic_lvalue(value_expr, addr);
+	jump_target               retry_target;
+	ir_node                  *old_bits    = NULL;
+	ir_node                  *value;
+	if (atomic) {
+		begin_cas_loop(&retry_target);
+		value = load_in_cas_loop(dbgi, addr, type, &old_bits);
+	} else {
+		value = get_value_from_lvalue(value_expr, addr);
+	}
 	ir_node            *const value_arith = create_conv(dbgi, value, mode);
 	ir_node            *const new_value   = inc
 		? new_d_Add(dbgi, value_arith, offset, mode)
 		: new_d_Sub(dbgi, value_arith, offset, mode);
 
-	ir_node *const store_value = set_value_for_expression_addr(value_expr, new_value, addr);
+	ir_node *store_value;
+	if (atomic) {
+		store_value = conv_to_storage_type(dbgi, new_value, type);
+		finish_cas_loop(dbgi, &retry_target, addr, old_bits, store_value, type);
+	} else {
+		store_value = set_value_for_expression_addr(value_expr, new_value, addr);
+	}
 	return pre ? store_value : value;
 }
 
@@ -1872,6 +2377,9 @@ static ir_node *binop_to_firm(binary_expression_t const *const expr)
 	return create_op(expr, left, right);
 }
 
+/** Conditional jumps to this target are predicted not to be taken. */
+static jump_target const *unlikely_target;
+
 /**
  * Check if a given expression is a GNU __builtin_expect() call.
  */
@@ -1914,6 +2422,12 @@ static void compare_to_control_flow(expression_t const *const expr, ir_node *con
 				cond_jmp_predicate const pred = cnst ? COND_JMP_PRED_TRUE : COND_JMP_PRED_FALSE;
 				set_Cond_jmp_pred(cond, pred);
 			}
+		} else if (unlikely_target != NULL && is_Cond(cond)) {
+			if (unlikely_target == true_target) {
+				set_Cond_jmp_pred(cond, COND_JMP_PRED_FALSE);
+			} else if (unlikely_target == false_target) {
+				set_Cond_jmp_pred(cond, COND_JMP_PRED_TRUE);
+			}
 		}
 
 		add_pred_to_jump_target(true_target,  true_proj);
@@ -1927,7 +2441,18 @@ static ir_node *binop_assign_to_firm(binary_expression_t const *const expr)
 	ir_node            *const right     = expression_to_value(expr->right);
 	expression_t const *const left_expr = expr->left;
 	ir_node            *const addr      = expression_to_addr(left_expr);
-	ir_node            *const left      = get_value_from_lvalue(left_expr, addr);
+	bool                const atomic    = is_atomic_lvalue(left_expr, addr);
+	jump_target               retry_target;
+	ir_node                  *old_bits  = NULL;
+	ir_node                  *left;
+	if (atomic) {
+		dbg_info *const dbgi      = get_dbg_info(&expr->base.pos);
+		type_t   *const left_type = skip_typeref(left_expr->base.type);
+		begin_cas_loop(&retry_target);
+		left = load_in_cas_loop(dbgi, addr, left_type, &old_bits);
+	} else {
+		left = get_value_from_lvalue(left_expr, addr);
+	}
 	ir_node                  *result    = create_op(expr, left, right);
 
 	type_t *const type = skip_typeref(expr->base.type);
@@ -1942,14 +2467,34 @@ static ir_node *binop_assign_to_firm(binary_expression_t const *const expr)
 		result = control_flow_to_1_0((expression_t const*)expr, &true_target, &false_target);
 	}
 
+	if (atomic) {
+		dbg_info *const dbgi      = get_dbg_info(&expr->base.pos);
+		type_t   *const left_type = skip_typeref(left_expr->base.type);
+		result = conv_to_storage_type(dbgi, result, left_type);
+		finish_cas_loop(dbgi, &retry_target, addr, old_bits, result, left_type);
+		return result;
+	}
 	return set_value_for_expression_addr(left_expr, result, addr);
 }
 
 static ir_node *assign_expression_to_firm(binary_expression_t const *const expr)
 {
-	ir_node *const addr  = expression_to_addr(expr->left);
-	ir_node *const right = expression_to_value(expr->right);
-	return set_value_for_expression_addr(expr->left, right, addr);
+	expression_t const *const left_expr = expr->left;
+	ir_node            *const addr      = expression_to_addr(left_expr);
+	ir_node            *const right     = expression_to_value(expr->right);
+	if (is_atomic_lvalue(left_expr, addr)) {
+		/* a sequentially consistent store, so swap the value in */
+		dbg_info *const dbgi      = get_dbg_info(&expr->base.pos);
+		type_t   *const left_type = skip_typeref(left_expr->base.type);
+		ir_node  *const value     = conv_to_storage_type(dbgi, right, left_type);
+		jump_target retry_target;
+		begin_cas_loop(&retry_target);
+		ir_node  *old_bits;
+		load_in_cas_loop(dbgi, addr, left_type, &old_bits);
+		finish_cas_loop(dbgi, &retry_target, addr, old_bits, value, left_type);
+		return value;
+	}
+	return set_value_for_expression_addr(left_expr, right, addr);
 }
 
 /** evaluate an expression and discard the result, but still produce the
@@ -2078,7 +2623,8 @@ static ir_node *compound_literal_to_firm(
 			return string_to_firm(&expr->base.pos,
 			                      get_init_string(initializer)->value);
 		case INITIALIZER_LIST:
-		case INITIALIZER_DESIGNATOR: {
+		case INITIALIZER_DESIGNATOR:
+		case INITIALIZER_DATA: {
 			/* shouldn't really happen in valid programs, return 0 for
 			 * invalid ones... */
 			ir_mode *mode = get_ir_mode_arithmetic(type);
@@ -3296,7 +3842,7 @@ static void create_variable_entity(entity_t *variable,
 
 	handle_decl_modifiers(irentity, variable);
 
-	if (type->base.qualifiers & TYPE_QUALIFIER_VOLATILE)
+	if (type->base.qualifiers & (TYPE_QUALIFIER_VOLATILE | TYPE_QUALIFIER_ATOMIC))
 		set_entity_volatility(irentity, volatility_is_volatile);
 
 entity_created:
@@ -3618,6 +4164,48 @@ static bool is_string_type(type_t *type)
 	return is_type_integer(inner);
 }
 
+/**
+ * Sets the initializers of the consecutive array elements covered by a data
+ * initializer. Elements with equal values share their ir_initializer_t.
+ */
+static void create_ir_initializer_data(type_path_t *path,
+                                       const initializer_data_t *data)
+{
+	type_t *const element_type = skip_typeref(data->type);
+	/* we might have to descend into types until the types match */
+	while (!types_compatible(skip_typeref(path->top_type), element_type)) {
+		descend_into_subtype(path, &data->base.pos);
+	}
+
+	ir_mode           *const mode = get_ir_mode_storage(element_type);
+	ir_initializer_t  *cache[256];
+	unsigned long long cache_value[ARRAY_SIZE(cache)];
+	memset(cache, 0, sizeof(cache));
+	/* embedded bytes may exceed the range of signed elements */
+	unsigned const bits = data->element_size * 8;
+	bool     const wrap = mode_is_signed(mode) && bits < 64;
+	for (size_t i = 0; i < data->len; ++i) {
+		unsigned long long const value = get_init_data_value(data, i);
+		size_t             const slot  = value % ARRAY_SIZE(cache);
+		ir_initializer_t        *init  = cache[slot];
+		if (init == NULL || cache_value[slot] != value) {
+			long long svalue = (long long)value;
+			if (wrap && value >> (bits - 1) != 0)
+				svalue = (long long)(value - (1ULL << bits));
+			ir_tarval *const tv = new_tarval_from_long((long)svalue, mode);
+			init              = create_initializer_tarval(tv);
+			cache[slot]       = init;
+			cache_value[slot] = value;
+		}
+
+		type_path_entry_t *entry        = get_type_path_top(path);
+		ir_initializer_t  *tinitializer = entry->initializer;
+		set_initializer_compound_value(tinitializer, entry->index, init);
+
+		advance_current_object(path);
+	}
+}
+
 static ir_initializer_t *create_ir_initializer_list(
 		const initializer_list_t *initializer, type_t *type)
 {
@@ -3636,6 +4224,11 @@ static ir_initializer_t *create_ir_initializer_list(
 			continue;
 		}
 
+		if (sub_initializer->kind == INITIALIZER_DATA) {
+			create_ir_initializer_data(&path, &sub_initializer->data);
+			continue;
+		}
+
 		if (sub_initializer->kind == INITIALIZER_VALUE) {
 			const expression_t *expr      = sub_initializer->value.value;
 			const type_t       *expr_type = skip_typeref(expr->base.type);
@@ -3698,8 +4291,7 @@ static ir_initializer_t *create_ir_initializer_string(initializer_t const *const
 	case STRING_ENCODING_UTF8:
 		for (size_t i = 0; i != arr_len; ++i) {
 			char              const c      = i < str_len ? *p++ : 0;
-			ir_tarval        *const tv     = new_tarval_from_long(c, mode);
-			ir_initializer_t *const tvinit = create_initializer_tarval(tv);
+			ir_initializer_t *const tvinit = get_char_initializer(mode, c);
 			set_initializer_compound_value(irinit, i, tvinit);
 		}
 		break;
@@ -3709,8 +4301,7 @@ static ir_initializer_t *create_ir_initializer_string(initializer_t const *const
 	case STRING_ENCODING_WIDE:
 		for (size_t i = 0; i != arr_len; ++i) {
 			utf32             const c      = i < str_len ? read_utf8_char(&p) : 0;
-			ir_tarval        *const tv     = new_tarval_from_long(c, mode);
-			ir_initializer_t *const tvinit = create_initializer_tarval(tv);
+			ir_initializer_t *const tvinit = get_char_initializer(mode, c);
 			set_initializer_compound_value(irinit, i, tvinit);
 		}
 		break;
@@ -3734,6 +4325,9 @@ static ir_initializer_t *create_ir_initializer(
 
 	case INITIALIZER_DESIGNATOR:
 		panic("unexpected designator initializer");
+
+	case INITIALIZER_DATA:
+		panic("unexpected data initializer");
 	}
 	panic("unknown initializer");
 }
@@ -4108,7 +4702,7 @@ static void create_local_static_variable(entity_t *entity)
 	                                              IR_LINKAGE_DEFAULT);
 	set_entity_dbg_info(irentity, dbgi);
 
-	if (type->base.qualifiers & TYPE_QUALIFIER_VOLATILE) {
+	if (type->base.qualifiers & (TYPE_QUALIFIER_VOLATILE | TYPE_QUALIFIER_ATOMIC)) {
 		set_entity_volatility(irentity, volatility_is_volatile);
 	}
 
@@ -4347,6 +4941,50 @@ static ir_node *declaration_statement_to_firm(declaration_statement_t *statement
 	return NULL;
 }
 
+/**
+ * Estimates how often a statement is executed from the calls at its top
+ * level: Calls of cold or noreturn functions make it rare, calls of hot
+ * functions frequent.
+ *
+ * @return -1 if the statement is cold, 1 if it is hot and 0 otherwise
+ */
+static int get_statement_hotness(statement_t const *const statement)
+{
+	if (statement == NULL)
+		return 0;
+
+	switch (statement->kind) {
+	case STATEMENT_COMPOUND:
+		for (statement_t const *s = statement->compound.statements; s != NULL; s = s->base.next) {
+			int const hotness = get_statement_hotness(s);
+			if (hotness != 0)
+				return hotness;
+		}
+		return 0;
+
+	case STATEMENT_EXPRESSION: {
+		expression_t const *const expression = statement->expression.expression;
+		if (expression->kind != EXPR_CALL)
+			return 0;
+		expression_t const *const function = expression->call.function;
+		if (function->kind != EXPR_REFERENCE)
+			return 0;
+		entity_t const *const entity = function->reference.entity;
+		if (entity->kind != ENTITY_FUNCTION)
+			return 0;
+		type_t const *const type = skip_typeref(entity->declaration.type);
+		if (entity->function.is_cold || (type->function.modifiers & DM_NORETURN))
+			return -1;
+		if (entity->function.is_hot)
+			return 1;
+		return 0;
+	}
+
+	default:
+		return 0;
+	}
+}
+
 static ir_node *if_statement_to_firm(if_statement_t *statement)
 {
 	create_local_declarations(statement->scope.first_entity);
@@ -4356,8 +4994,17 @@ static ir_node *if_statement_to_firm(if_statement_t *statement)
 	jump_target false_target;
 	init_jump_target(&true_target,  NULL);
 	init_jump_target(&false_target, NULL);
-	if (currently_reachable())
+	if (currently_reachable()) {
+		/* predict branches to cold code as not taken */
+		int const bias = get_statement_hotness(statement->true_statement)
+		               - get_statement_hotness(statement->false_statement);
+		jump_target const *const old_unlikely_target = unlikely_target;
+		unlikely_target = bias < 0 ? &true_target
+		                : bias > 0 ? &false_target
+		                :            NULL;
 		expression_to_control_flow(statement->condition, &true_target, &false_target);
+		unlikely_target = old_unlikely_target;
+	}
 
 	jump_target exit_target;
 	init_jump_target(&exit_target, NULL);
@@ -4942,6 +5589,41 @@ static void add_function_pointer(ir_type *segment, ir_entity *method,
 	set_atomic_ent_value(ptr, val);
 }
 
+/**
+ * Checks whether all pointer parameters of a function are restrict
+ * qualified. Then the objects accessed through them are neither accessed
+ * through another parameter nor through a global.
+ */
+static bool has_restrict_parameters(function_t const *const function)
+{
+	type_t const *const type         = skip_typeref(function->base.type);
+	bool                has_restrict = false;
+	for (function_parameter_t const *parameter = type->function.parameters;
+	     parameter != NULL; parameter = parameter->next) {
+		type_t const *const param_type = skip_typeref(parameter->type);
+		if (!is_type_pointer(param_type))
+			continue;
+		if (!(param_type->base.qualifiers & TYPE_QUALIFIER_RESTRICT))
+			return false;
+		has_restrict = true;
+	}
+	return has_restrict;
+}
+
+/** Passes the printed AST of @p function to the function cache. */
+static void record_function_source(ir_graph *const irg,
+                                   function_t const *const function)
+{
+	struct obstack obst;
+	obstack_init(&obst);
+	print_to_obstack(&obst);
+	print_entity((entity_t const*)function);
+	size_t      const len    = obstack_object_size(&obst);
+	char const *const source = (char const*)obstack_finish(&obst);
+	function_cache_record_source(irg, source, len);
+	obstack_free(&obst, NULL);
+}
+
 /**
  * Create firm graph for a function.
  */
@@ -4973,6 +5655,12 @@ static void create_function(function_t *const function)
 	unsigned  n_local_vars = get_function_n_local_vars(function);
 	ir_graph *irg          = new_ir_graph(function_entity, n_local_vars);
 	current_ir_graph = irg;
+	if (function->optimize != 0)
+		set_irg_optimization_level(irg, function->optimize - 1);
+	if (has_restrict_parameters(function))
+		set_irg_noalias_parameters(irg);
+	if (function_cache_active())
+		record_function_source(irg, function);
 
 	ir_graph *old_current_function = current_function;
 	current_function = irg;
@@ -5163,6 +5851,7 @@ void exit_ast2firm(void)
 		return;
 	exit_mangle();
 	obstack_free(&asm_obst, NULL);
+	ast2firm_initialized = false;
 }
 
 static void global_asm_to_firm(statement_t *s)
@@ -5211,6 +5900,7 @@ void translation_unit_to_firm(translation_unit_t *unit)
 	init_jump_target(&continue_target, NULL);
 	current_switch           = NULL;
 	current_translation_unit = unit;
+	memset(char_initializers, 0, sizeof(char_initializers));
 
 	scope_to_firm(&unit->scope);
 	global_asm_to_firm(unit->global_asm);
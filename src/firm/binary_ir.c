@@ -0,0 +1,1956 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "binary_ir.h"
+
+#include <libfirm/firm.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adt/array.h"
+#include "adt/obst.h"
+#include "adt/sha256.h"
+#include "adt/strutil.h"
+#include "adt/util.h"
+#include "adt/xmalloc.h"
+#include "driver/diagnostic.h"
+
+#define MAGIC       "\177FIRMIR\n"
+#define MAGIC_SIZE  (sizeof(MAGIC) - 1)
+#define VERSION     2
+/**
+ * The magic is followed by the version, the libfirm version and opcode count
+ * the file was written with, and the offset of the tables. Nodes are stored
+ * with the opcode numbers and attributes of one libfirm, so files of other
+ * versions are rejected.
+ */
+#define FIRM_OFFSET   (MAGIC_SIZE + 4)
+#define TABLES_OFFSET (FIRM_OFFSET + 2 + 2 + 4)
+#define HEADER_SIZE   (TABLES_OFFSET + 8)
+
+#define NO_INDEX    ((size_t)-1)
+#define IN_PROGRESS ((size_t)-2)
+
+/** References to nodes below N_ANCHORS denote the anchors of the graph. */
+typedef enum anchor_t {
+	ANCHOR_END_BLOCK,
+	ANCHOR_START_BLOCK,
+	ANCHOR_END,
+	ANCHOR_START,
+	ANCHOR_FRAME,
+	ANCHOR_INITIAL_MEM,
+	ANCHOR_ARGS,
+	ANCHOR_NO_MEM,
+	N_ANCHORS
+} anchor_t;
+
+typedef enum record_kind_t {
+	RECORD_PRIMITIVE,
+	RECORD_POINTER,
+	RECORD_ARRAY,
+	RECORD_METHOD,
+	RECORD_STRUCT,
+	RECORD_UNION,
+	RECORD_SEGMENT,
+	RECORD_CODE_TYPE,
+	RECORD_UNKNOWN_TYPE,
+	RECORD_LAYOUT,         /**< layout of a compound type after its members */
+	RECORD_ENTITY,
+	RECORD_UNKNOWN_ENTITY,
+} record_kind_t;
+
+typedef enum definition_kind_t {
+	DEFINITION_INITIALIZER,
+	DEFINITION_ALIAS,
+} definition_kind_t;
+
+typedef struct index_entry_t {
+	void const *key;
+	size_t      index;
+} index_entry_t;
+
+typedef struct index_map_t index_map_t;
+#define HashSet          index_map_t
+#define HashSetEntry     index_map_entry_t
+#define ValueType        index_entry_t*
+#define ADDITIONAL_DATA  struct obstack obst;
+#define ADDITIONAL_INIT  obstack_init(&self->obst);
+#define ADDITIONAL_TERM  obstack_free(&self->obst, NULL);
+#include "adt/hashset.h"
+
+#define NullValue                 NULL
+#define DeletedValue              ((index_entry_t*)-1)
+#define KeyType                   void const*
+#define ConstKeyType              void const*
+#define GetKey(value)             (value)->key
+#define InitData(self,value,k)    ((void)((value) = OALLOC(&(self)->obst, index_entry_t), (value)->key = (k), (value)->index = NO_INDEX))
+#define Hash(self,key)            ((unsigned)((uintptr_t)(key) >> 3))
+#define KeysEqual(self,key1,key2) ((key1) == (key2))
+#define SetRangeEmpty(ptr,size)   memset(ptr, 0, (size) * sizeof(index_map_entry_t))
+#define SCALAR_RETURN
+
+static void index_map_init(index_map_t *map);
+#define hashset_init    index_map_init
+static void index_map_destroy(index_map_t *map);
+#define hashset_destroy index_map_destroy
+static index_entry_t *index_map_insert(index_map_t *map, void const *key);
+#define hashset_insert  index_map_insert
+
+#include "adt/hashset.c.h"
+
+static ir_node *get_anchor(ir_graph *const irg, anchor_t const anchor)
+{
+	switch (anchor) {
+	case ANCHOR_END_BLOCK:   return get_irg_end_block(irg);
+	case ANCHOR_START_BLOCK: return get_irg_start_block(irg);
+	case ANCHOR_END:         return get_irg_end(irg);
+	case ANCHOR_START:       return get_irg_start(irg);
+	case ANCHOR_FRAME:       return get_irg_frame(irg);
+	case ANCHOR_INITIAL_MEM: return get_irg_initial_mem(irg);
+	case ANCHOR_ARGS:        return get_irg_args(irg);
+	case ANCHOR_NO_MEM:      return get_irg_no_mem(irg);
+	case N_ANCHORS:          break;
+	}
+	return NULL;
+}
+
+typedef struct writer_t {
+	index_map_t    indices;     /**< of idents, modes, types and entities */
+	struct obstack strings;
+	size_t         n_strings;
+	struct obstack modes;
+	size_t         n_modes;
+	struct obstack records;     /**< declarations of types and entities */
+	size_t         n_records;
+	size_t         n_types;
+	size_t         n_entities;
+	ir_entity    **pending;     /**< entities with a definition to write */
+	struct obstack definitions;
+	struct obstack functions;   /**< index of the function bodies */
+	size_t         n_functions;
+	struct obstack bodies;
+	ir_graph      *irg;         /**< graph of the body being written */
+	size_t         n_locals;
+	bool           ok;
+} writer_t;
+
+static void put_unsigned(struct obstack *const obst, uint64_t value)
+{
+	for (; value >= 0x80; value >>= 7) {
+		obstack_1grow(obst, (char)((value & 0x7F) | 0x80));
+	}
+	obstack_1grow(obst, (char)value);
+}
+
+/** Signed values are zigzag encoded, so small magnitudes stay short. */
+static void put_signed(struct obstack *const obst, int64_t const value)
+{
+	put_unsigned(obst, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void put_bool(struct obstack *const obst, bool const value)
+{
+	obstack_1grow(obst, value);
+}
+
+static void put_fixed(struct obstack *const obst, uint64_t const value,
+                      unsigned const size)
+{
+	for (unsigned i = 0; i != size; ++i) {
+		obstack_1grow(obst, (char)(value >> (8 * i)));
+	}
+}
+
+static void put_ident(writer_t *const w, struct obstack *const obst,
+                      ident *const id)
+{
+	if (id == NULL) {
+		put_unsigned(obst, 0);
+		return;
+	}
+	index_entry_t *const entry = index_map_insert(&w->indices, id);
+	if (entry->index == NO_INDEX) {
+		entry->index = w->n_strings++;
+		char const *const string = get_id_str(id);
+		size_t      const len    = strlen(string);
+		put_unsigned(&w->strings, len);
+		obstack_grow(&w->strings, string, len);
+	}
+	put_unsigned(obst, entry->index + 1);
+}
+
+static void put_mode(writer_t *const w, struct obstack *const obst,
+                     ir_mode *const mode)
+{
+	index_entry_t *const entry = index_map_insert(&w->indices, mode);
+	if (entry->index == NO_INDEX) {
+		entry->index = w->n_modes++;
+		struct obstack *const modes = &w->modes;
+		put_ident(w, modes, new_id_from_str(get_mode_name(mode)));
+		put_unsigned(modes, get_mode_sort(mode));
+		put_unsigned(modes, get_mode_size_bits(mode));
+		put_bool(modes, mode_is_signed(mode));
+		put_unsigned(modes, get_mode_arithmetic(mode));
+		put_unsigned(modes, get_mode_modulo_shift(mode));
+		if (mode_is_float(mode)) {
+			put_unsigned(modes, get_mode_exponent_size(mode));
+			put_unsigned(modes, get_mode_mantissa_size(mode));
+			put_unsigned(modes, get_mode_float_int_overflow(mode));
+		}
+	}
+	put_unsigned(obst, entry->index);
+}
+
+static void put_tarval(writer_t *const w, struct obstack *const obst,
+                       ir_tarval *const tv)
+{
+	ir_mode *const mode = get_tarval_mode(tv);
+	put_mode(w, obst, mode);
+	if (mode == mode_b) {
+		put_bool(obst, tv == get_tarval_b_true());
+		return;
+	}
+	for (unsigned i = 0, n = (get_mode_size_bits(mode) + 7) / 8; i != n; ++i) {
+		obstack_1grow(obst, get_tarval_sub_bits(tv, i));
+	}
+}
+
+static void put_layout(struct obstack *const obst, ir_type *const type)
+{
+	put_unsigned(obst, get_type_size(type));
+	put_unsigned(obst, get_type_alignment(type));
+	put_unsigned(obst, get_type_state(type));
+}
+
+static ir_segment_t get_segment(ir_type const *const type)
+{
+	ir_segment_t s = IR_SEGMENT_FIRST;
+	while (s != IR_SEGMENT_LAST && get_segment_type(s) != type) {
+		++s;
+	}
+	return s;
+}
+
+static size_t declare_entity(writer_t *w, ir_entity *entity);
+
+/**
+ * Writes the declaration of @p type after the ones of the types it refers
+ * to, unless it is declared already, and returns its index.
+ */
+static size_t declare_type(writer_t *const w, ir_type *const type)
+{
+	index_entry_t *const entry = index_map_insert(&w->indices, type);
+	if (entry->index == IN_PROGRESS || is_frame_type(type)) {
+		/* only cycles through compound types can be constructed */
+		w->ok = false;
+		return 0;
+	} else if (entry->index != NO_INDEX) {
+		return entry->index;
+	}
+
+	entry->index = IN_PROGRESS;
+	if (is_Pointer_type(type)) {
+		declare_type(w, get_pointer_points_to_type(type));
+	} else if (is_Array_type(type)) {
+		declare_type(w, get_array_element_type(type));
+	} else if (is_Method_type(type)) {
+		for (size_t i = 0, n = get_method_n_params(type); i != n; ++i) {
+			declare_type(w, get_method_param_type(type, i));
+		}
+		for (size_t i = 0, n = get_method_n_ress(type); i != n; ++i) {
+			declare_type(w, get_method_res_type(type, i));
+		}
+	}
+
+	struct obstack *const records = &w->records;
+	entry->index = w->n_types++;
+	++w->n_records;
+	if (is_Primitive_type(type)) {
+		put_unsigned(records, RECORD_PRIMITIVE);
+		put_mode(w, records, get_type_mode(type));
+		put_layout(records, type);
+	} else if (is_Pointer_type(type)) {
+		put_unsigned(records, RECORD_POINTER);
+		put_unsigned(records, declare_type(w, get_pointer_points_to_type(type)));
+		put_layout(records, type);
+	} else if (is_Array_type(type)) {
+		put_unsigned(records, RECORD_ARRAY);
+		put_unsigned(records, declare_type(w, get_array_element_type(type)));
+		put_layout(records, type);
+	} else if (is_Method_type(type)) {
+		size_t const n_params = get_method_n_params(type);
+		size_t const n_ress   = get_method_n_ress(type);
+		put_unsigned(records, RECORD_METHOD);
+		put_unsigned(records, n_params);
+		put_unsigned(records, n_ress);
+		for (size_t i = 0; i != n_params; ++i) {
+			put_unsigned(records, declare_type(w, get_method_param_type(type, i)));
+		}
+		for (size_t i = 0; i != n_ress; ++i) {
+			put_unsigned(records, declare_type(w, get_method_res_type(type, i)));
+		}
+		put_bool(records, is_method_variadic(type));
+		put_unsigned(records, get_method_calling_convention(type));
+		put_unsigned(records, get_method_additional_properties(type));
+	} else if (is_Struct_type(type) || is_Union_type(type)) {
+		put_unsigned(records, is_Struct_type(type) ? RECORD_STRUCT : RECORD_UNION);
+		put_ident(w, records, get_compound_ident(type));
+		/* the members may refer to the type, so they follow it */
+		for (size_t i = 0, n = get_compound_n_members(type); i != n; ++i) {
+			declare_entity(w, get_compound_member(type, i));
+		}
+		put_unsigned(records, RECORD_LAYOUT);
+		put_unsigned(records, entry->index);
+		put_layout(records, type);
+		++w->n_records;
+	} else if (is_segment_type(type)) {
+		put_unsigned(records, RECORD_SEGMENT);
+		put_unsigned(records, get_segment(type));
+	} else if (is_code_type(type)) {
+		put_unsigned(records, RECORD_CODE_TYPE);
+	} else if (is_unknown_type(type)) {
+		put_unsigned(records, RECORD_UNKNOWN_TYPE);
+	} else {
+		w->ok = false;
+	}
+	return entry->index;
+}
+
+static void put_type(writer_t *const w, struct obstack *const obst,
+                     ir_type *const type)
+{
+	put_unsigned(obst, declare_type(w, type));
+}
+
+static void put_entity_fields(writer_t *const w, struct obstack *const obst,
+                              ir_entity *const entity)
+{
+	ir_entity_kind const kind = get_entity_kind(entity);
+	put_unsigned(obst, kind);
+	put_ident(w, obst, get_entity_ident(entity));
+	put_ident(w, obst, get_entity_ld_ident(entity));
+	put_type(w, obst, get_entity_type(entity));
+	put_unsigned(obst, get_entity_visibility(entity));
+	put_unsigned(obst, get_entity_linkage(entity));
+	put_unsigned(obst, get_entity_volatility(entity));
+	put_unsigned(obst, get_entity_alignment(entity));
+	switch (kind) {
+	case IR_ENTITY_COMPOUND_MEMBER:
+		put_signed(obst, get_entity_offset(entity));
+		put_unsigned(obst, get_entity_bitfield_offset(entity));
+		put_unsigned(obst, get_entity_bitfield_size(entity));
+		break;
+	case IR_ENTITY_PARAMETER:
+		put_unsigned(obst, get_entity_parameter_number(entity));
+		break;
+	case IR_ENTITY_METHOD:
+		put_unsigned(obst, get_entity_additional_properties(entity));
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Writes the declaration of @p entity after the ones of its owner and type,
+ * unless it is declared already, and returns its index.
+ */
+static size_t declare_entity(writer_t *const w, ir_entity *const entity)
+{
+	/* frame entities and labels are written with their function */
+	ir_entity_kind const kind  = get_entity_kind(entity);
+	ir_type       *const owner = get_entity_owner(entity);
+	if (kind == IR_ENTITY_LABEL || is_frame_type(owner)) {
+		w->ok = false;
+		return 0;
+	}
+
+	index_entry_t *const entry = index_map_insert(&w->indices, entity);
+	if (entry->index != NO_INDEX)
+		return entry->index;
+
+	struct obstack *const records = &w->records;
+	if (kind == IR_ENTITY_UNKNOWN) {
+		put_unsigned(records, RECORD_UNKNOWN_ENTITY);
+	} else {
+		declare_type(w, owner);
+		declare_type(w, get_entity_type(entity));
+		/* declaring a compound type declares its members */
+		if (entry->index != NO_INDEX)
+			return entry->index;
+
+		put_unsigned(records, RECORD_ENTITY);
+		put_type(w, records, owner);
+		put_entity_fields(w, records, entity);
+		if (kind == IR_ENTITY_ALIAS ? get_entity_alias(entity) != NULL
+		    : kind == IR_ENTITY_NORMAL && get_entity_initializer(entity) != NULL)
+			ARR_APP1(ir_entity*, w->pending, entity);
+	}
+	++w->n_records;
+	entry->index = w->n_entities++;
+	return entry->index;
+}
+
+/** Writes a reference to a global entity or to one of the current body. */
+static void put_entity(writer_t *const w, struct obstack *const obst,
+                       ir_entity *const entity)
+{
+	if (w->irg != NULL && (get_entity_kind(entity) == IR_ENTITY_LABEL
+	 || get_entity_owner(entity) == get_irg_frame_type(w->irg))) {
+		index_entry_t const *const entry
+			= index_map_insert(&w->indices, entity);
+		if (entry->index == NO_INDEX)
+			w->ok = false;
+		put_unsigned(obst, (uint64_t)entry->index << 1 | 1);
+	} else {
+		put_unsigned(obst, (uint64_t)declare_entity(w, entity) << 1);
+	}
+}
+
+static void put_node_ref(struct obstack *const obst, ir_node const *const node)
+{
+	put_unsigned(obst, (uintptr_t)get_irn_link(node));
+}
+
+static void put_constraints(writer_t *const w, struct obstack *const obst,
+                            ir_asm_constraint const *const constraints,
+                            size_t const n)
+{
+	for (size_t i = 0; i != n; ++i) {
+		put_unsigned(obst, constraints[i].pos);
+		put_ident(w, obst, constraints[i].constraint);
+		put_mode(w, obst, constraints[i].mode);
+	}
+}
+
+/** Returns the construction flags reproducing the attributes of @p node. */
+static unsigned get_cons_flags(ir_node const *const node,
+                               ir_volatility const volatility,
+                               ir_align const alignment)
+{
+	unsigned flags = cons_none;
+	if (volatility == volatility_is_volatile)
+		flags |= cons_volatile;
+	if (alignment == align_non_aligned)
+		flags |= cons_unaligned;
+	if (get_irn_pinned(node) == op_pin_state_floats)
+		flags |= cons_floats;
+	if (is_fragile_op(node) && ir_throws_exception(node))
+		flags |= cons_throws_exception;
+	return flags;
+}
+
+static void put_node(writer_t *const w, struct obstack *const obst,
+                     ir_node *const node)
+{
+	if (is_Block(node)) {
+		int const n_preds = get_Block_n_cfgpreds(node);
+		put_unsigned(obst, n_preds);
+		for (int i = 0; i != n_preds; ++i) {
+			put_node_ref(obst, get_Block_cfgpred(node, i));
+		}
+		/* the label is a local entity following the ones of the frame */
+		ir_entity *const label
+			= has_Block_entity(node) ? get_Block_entity(node) : NULL;
+		put_bool(obst, label != NULL);
+		if (label != NULL) {
+			if (w->irg == NULL)
+				w->ok = false;
+			index_map_insert(&w->indices, label)->index = w->n_locals++;
+		}
+		return;
+	}
+
+	put_node_ref(obst, get_nodes_block(node));
+	int const arity = get_irn_arity(node);
+	put_unsigned(obst, arity);
+	for (int i = 0; i != arity; ++i) {
+		put_node_ref(obst, get_irn_n(node, i));
+	}
+
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+	case iro_And:
+	case iro_Bad:
+	case iro_Conv:
+	case iro_Eor:
+	case iro_IJmp:
+	case iro_Jmp:
+	case iro_Minus:
+	case iro_Mul:
+	case iro_NoMem:
+	case iro_Not:
+	case iro_Or:
+	case iro_Pin:
+	case iro_Return:
+	case iro_Shl:
+	case iro_Shr:
+	case iro_Shrs:
+	case iro_Sub:
+	case iro_Sync:
+	case iro_Unknown:
+		return;
+
+	case iro_Address:
+		put_entity(w, obst, get_Address_entity(node));
+		return;
+	case iro_Alloc:
+		put_unsigned(obst, get_Alloc_alignment(node));
+		return;
+	case iro_ASM:
+		put_ident(w, obst, get_ASM_text(node));
+		put_constraints(w, obst, get_ASM_input_constraints(node), arity - 1);
+		put_unsigned(obst, get_ASM_n_output_constraints(node));
+		put_constraints(w, obst, get_ASM_output_constraints(node),
+		                get_ASM_n_output_constraints(node));
+		put_unsigned(obst, get_ASM_n_clobbers(node));
+		for (size_t i = 0, n = get_ASM_n_clobbers(node); i != n; ++i) {
+			put_ident(w, obst, get_ASM_clobbers(node)[i]);
+		}
+		put_bool(obst, get_irn_pinned(node) != op_pin_state_floats);
+		return;
+	case iro_Builtin:
+		put_unsigned(obst, get_Builtin_kind(node));
+		put_type(w, obst, get_Builtin_type(node));
+		return;
+	case iro_Call:
+		put_type(w, obst, get_Call_type(node));
+		put_bool(obst, ir_throws_exception(node));
+		put_bool(obst, get_irn_pinned(node) != op_pin_state_floats);
+		return;
+	case iro_Cmp:
+		put_unsigned(obst, get_Cmp_relation(node));
+		return;
+	case iro_Cond:
+		put_unsigned(obst, get_Cond_jmp_pred(node));
+		return;
+	case iro_Confirm:
+		put_unsigned(obst, get_Confirm_relation(node));
+		return;
+	case iro_Const:
+		put_tarval(w, obst, get_Const_tarval(node));
+		return;
+	case iro_CopyB:
+		put_type(w, obst, get_CopyB_type(node));
+		put_unsigned(obst, get_cons_flags(node, get_CopyB_volatility(node),
+		                                  align_is_aligned));
+		return;
+	case iro_Div:
+		put_mode(w, obst, get_Div_resmode(node));
+		put_bool(obst, get_Div_no_remainder(node));
+		put_bool(obst, get_irn_pinned(node) != op_pin_state_floats);
+		put_bool(obst, ir_throws_exception(node));
+		return;
+	case iro_Load:
+		put_mode(w, obst, get_Load_mode(node));
+		put_type(w, obst, get_Load_type(node));
+		put_unsigned(obst, get_cons_flags(node, get_Load_volatility(node),
+		                                  get_Load_unaligned(node)));
+		return;
+	case iro_Member:
+		put_entity(w, obst, get_Member_entity(node));
+		return;
+	case iro_Mod:
+		put_mode(w, obst, get_Mod_resmode(node));
+		put_bool(obst, get_irn_pinned(node) != op_pin_state_floats);
+		put_bool(obst, ir_throws_exception(node));
+		return;
+	case iro_Phi:
+		put_bool(obst, get_Phi_loop(node));
+		return;
+	case iro_Proj:
+		put_unsigned(obst, get_Proj_num(node));
+		return;
+	case iro_Sel:
+		put_type(w, obst, get_Sel_type(node));
+		return;
+	case iro_Store:
+		put_type(w, obst, get_Store_type(node));
+		put_unsigned(obst, get_cons_flags(node, get_Store_volatility(node),
+		                                  get_Store_unaligned(node)));
+		return;
+	case iro_Switch: {
+		ir_switch_table *const table     = get_Switch_table(node);
+		size_t           const n_entries = ir_switch_table_get_n_entries(table);
+		put_unsigned(obst, get_Switch_n_outs(node));
+		put_unsigned(obst, n_entries);
+		for (size_t i = 0; i != n_entries; ++i) {
+			put_tarval(w, obst, ir_switch_table_get_min(table, i));
+			put_tarval(w, obst, ir_switch_table_get_max(table, i));
+			put_unsigned(obst, ir_switch_table_get_pn(table, i));
+		}
+		return;
+	}
+	}
+	/* the front end does not construct other nodes */
+	w->ok = false;
+}
+
+static bool is_graph_anchor(ir_node const *const node)
+{
+	ir_graph *const irg = get_irn_irg(node);
+	for (anchor_t a = ANCHOR_END_BLOCK; a != N_ANCHORS; ++a) {
+		if (get_anchor(irg, a) == node)
+			return true;
+	}
+	return false;
+}
+
+static void collect_node(ir_node *const node, void *const env)
+{
+	ir_node ***const nodes = (ir_node***)env;
+	if (!is_Anchor(node) && !is_graph_anchor(node))
+		ARR_APP1(ir_node*, *nodes, node);
+}
+
+/**
+ * Writes the nodes of @p irg reachable from @p root, or all of them if
+ * @p root is NULL. The links of the nodes become their references.
+ */
+static void put_nodes(writer_t *const w, struct obstack *const obst,
+                      ir_graph *const irg, ir_node *const root)
+{
+	ir_node **nodes = NEW_ARR_F(ir_node*, 0);
+	if (root != NULL) {
+		irg_walk(root, NULL, collect_node, &nodes);
+	} else {
+		irg_walk_graph(irg, NULL, collect_node, &nodes);
+	}
+
+	/* the blocks come first, so the other nodes are constructed in existing
+	 * blocks and only the predecessors of blocks and phis are forward
+	 * references */
+	size_t    const n_nodes = ARR_LEN(nodes);
+	ir_node **const sorted  = NEW_ARR_F(ir_node*, n_nodes);
+	size_t          n       = 0;
+	for (size_t i = 0; i != n_nodes; ++i) {
+		if (is_Block(nodes[i]))
+			sorted[n++] = nodes[i];
+	}
+	for (size_t i = 0; i != n_nodes; ++i) {
+		if (!is_Block(nodes[i]))
+			sorted[n++] = nodes[i];
+	}
+	DEL_ARR_F(nodes);
+
+	for (anchor_t a = ANCHOR_END_BLOCK; a != N_ANCHORS; ++a) {
+		ir_node *const anchor = get_anchor(irg, a);
+		if (anchor != NULL)
+			set_irn_link(anchor, (void*)(uintptr_t)a);
+	}
+	for (size_t i = 0; i != n_nodes; ++i) {
+		set_irn_link(sorted[i], (void*)(uintptr_t)(N_ANCHORS + i));
+	}
+
+	put_unsigned(obst, n_nodes);
+	for (size_t i = 0; i != n_nodes; ++i) {
+		put_unsigned(obst, get_irn_opcode(sorted[i]));
+		put_mode(w, obst, get_irn_mode(sorted[i]));
+	}
+	for (size_t i = 0; i != n_nodes; ++i) {
+		put_node(w, obst, sorted[i]);
+	}
+	DEL_ARR_F(sorted);
+}
+
+static void put_function(writer_t *const w, ir_graph *const irg)
+{
+	struct obstack *const obst   = &w->bodies;
+	size_t          const offset = obstack_object_size(obst);
+	w->irg      = irg;
+	w->n_locals = 0;
+
+	ir_type *const frame     = get_irg_frame_type(irg);
+	size_t   const n_members = get_compound_n_members(frame);
+	put_unsigned(obst, n_members);
+	for (size_t i = 0; i != n_members; ++i) {
+		ir_entity *const member = get_compound_member(frame, i);
+		put_entity_fields(w, obst, member);
+		index_map_insert(&w->indices, member)->index = w->n_locals++;
+	}
+	put_layout(obst, frame);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	put_nodes(w, obst, irg, NULL);
+	ir_node *const end_block = get_irg_end_block(irg);
+	int      const n_preds   = get_Block_n_cfgpreds(end_block);
+	put_unsigned(obst, n_preds);
+	for (int i = 0; i != n_preds; ++i) {
+		put_node_ref(obst, get_Block_cfgpred(end_block, i));
+	}
+	ir_node *const end          = get_irg_end(irg);
+	int      const n_keepalives = get_End_n_keepalives(end);
+	put_unsigned(obst, n_keepalives);
+	for (int i = 0; i != n_keepalives; ++i) {
+		put_node_ref(obst, get_End_keepalive(end, i));
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	w->irg = NULL;
+
+	struct obstack *const functions = &w->functions;
+	put_entity(w, functions, get_irg_entity(irg));
+	put_unsigned(functions, offset);
+	put_unsigned(functions, obstack_object_size(obst) - offset);
+	++w->n_functions;
+}
+
+static void put_initializer(writer_t *const w, struct obstack *const obst,
+                            ir_initializer_t *const initializer)
+{
+	ir_initializer_kind_t const kind = get_initializer_kind(initializer);
+	put_unsigned(obst, kind);
+	switch (kind) {
+	case IR_INITIALIZER_CONST: {
+		ir_node *const value = get_initializer_const_value(initializer);
+		put_nodes(w, obst, get_irn_irg(value), value);
+		put_node_ref(obst, value);
+		return;
+	}
+	case IR_INITIALIZER_TARVAL:
+		put_tarval(w, obst, get_initializer_tarval_value(initializer));
+		return;
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_COMPOUND: {
+		size_t const n = get_initializer_compound_n_entries(initializer);
+		put_unsigned(obst, n);
+		for (size_t i = 0; i != n; ++i) {
+			put_initializer(w, obst,
+			                get_initializer_compound_value(initializer, i));
+		}
+		return;
+	}
+	}
+	w->ok = false;
+}
+
+static void put_definitions(writer_t *const w)
+{
+	struct obstack *const obst = &w->definitions;
+	ir_graph       *const irg  = get_const_code_irg();
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	/* writing a definition may declare further entities */
+	for (size_t i = 0; i != ARR_LEN(w->pending); ++i) {
+		ir_entity *const entity = w->pending[i];
+		put_entity(w, obst, entity);
+		if (get_entity_kind(entity) == IR_ENTITY_ALIAS) {
+			put_unsigned(obst, DEFINITION_ALIAS);
+			put_entity(w, obst, get_entity_alias(entity));
+		} else {
+			put_unsigned(obst, DEFINITION_INITIALIZER);
+			put_initializer(w, obst, get_entity_initializer(entity));
+		}
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+}
+
+static void put_section(struct obstack *const file, size_t const n,
+                        struct obstack *const section)
+{
+	put_unsigned(file, n);
+	obstack_grow(file, obstack_base(section), obstack_object_size(section));
+}
+
+/** Assembles the sections into @p file, leaving it as a finished object. */
+static unsigned char *assemble_file(writer_t *const w,
+                                    struct obstack *const file,
+                                    size_t *const size)
+{
+	obstack_grow(file, MAGIC, MAGIC_SIZE);
+	put_fixed(file, VERSION, 4);
+	put_fixed(file, ir_get_version_major(), 2);
+	put_fixed(file, ir_get_version_minor(), 2);
+	put_fixed(file, iro_last + 1, 4);
+	put_fixed(file, 0, 8);
+	put_section(file, w->n_records, &w->records);
+	put_section(file, ARR_LEN(w->pending), &w->definitions);
+	size_t const n_asms = get_irp_n_asms();
+	put_unsigned(file, n_asms);
+	for (size_t i = 0; i != n_asms; ++i) {
+		put_ident(w, file, get_irp_asm(i));
+	}
+	put_section(file, w->n_functions, &w->functions);
+	put_section(file, obstack_object_size(&w->bodies), &w->bodies);
+
+	size_t const tables = obstack_object_size(file);
+	put_section(file, w->n_strings, &w->strings);
+	put_section(file, w->n_modes, &w->modes);
+
+	*size = obstack_object_size(file);
+	unsigned char *const data = (unsigned char*)obstack_finish(file);
+	for (unsigned i = 0; i != 8; ++i) {
+		data[TABLES_OFFSET + i] = (unsigned char)((uint64_t)tables >> (8 * i));
+	}
+	return data;
+}
+
+/**
+ * Serializes the program into @p file. Returns NULL if the program contains
+ * constructs the format cannot express.
+ */
+static unsigned char *build_file(struct obstack *const file,
+                                 size_t *const size)
+{
+	writer_t w;
+	memset(&w, 0, sizeof(w));
+	index_map_init(&w.indices);
+	obstack_init(&w.strings);
+	obstack_init(&w.modes);
+	obstack_init(&w.records);
+	obstack_init(&w.definitions);
+	obstack_init(&w.functions);
+	obstack_init(&w.bodies);
+	w.pending = NEW_ARR_F(ir_entity*, 0);
+	w.ok      = true;
+
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			declare_entity(&w, get_compound_member(segment, i));
+		}
+	}
+	for (size_t i = 0, n = get_irp_n_irgs(); i != n && w.ok; ++i) {
+		put_function(&w, get_irp_irg(i));
+	}
+	put_definitions(&w);
+
+	unsigned char *data = NULL;
+	if (w.ok)
+		data = assemble_file(&w, file, size);
+
+	DEL_ARR_F(w.pending);
+	obstack_free(&w.bodies, NULL);
+	obstack_free(&w.functions, NULL);
+	obstack_free(&w.definitions, NULL);
+	obstack_free(&w.records, NULL);
+	obstack_free(&w.modes, NULL);
+	obstack_free(&w.strings, NULL);
+	index_map_destroy(&w.indices);
+	return data;
+}
+
+bool binary_ir_write(FILE *const out)
+{
+	struct obstack file;
+	obstack_init(&file);
+	size_t               size;
+	unsigned char *const data = build_file(&file, &size);
+	if (data != NULL)
+		fwrite(data, 1, size, out);
+	obstack_free(&file, NULL);
+	return data != NULL;
+}
+
+bool binary_ir_hash(char hash[65])
+{
+	struct obstack file;
+	obstack_init(&file);
+	size_t               size;
+	unsigned char *const data = build_file(&file, &size);
+	if (data != NULL) {
+		sha256_t h;
+		sha256_init(&h);
+		sha256_add(&h, data, size);
+		sha256_finish(&h, hash);
+	}
+	obstack_free(&file, NULL);
+	return data != NULL;
+}
+
+typedef struct function_t {
+	ir_entity *entity;
+	size_t     offset;
+	size_t     size;
+	ir_graph  *irg;
+} function_t;
+
+struct binary_ir_t {
+	char const          *filename;
+	unsigned char       *data;
+	size_t               size;
+	unsigned char const *bodies;
+	size_t               bodies_size;
+	ident              **idents;
+	ir_mode            **modes;
+	ir_type            **types;
+	ir_entity          **entities;
+	function_t          *functions;
+};
+
+typedef struct reader_t {
+	binary_ir_t         *file;
+	unsigned char const *pos;
+	unsigned char const *end;
+	bool                 error;
+	ir_graph            *irg;     /**< graph the nodes are constructed in */
+	ir_entity          **locals;  /**< entities of the frame and labels */
+	size_t               n_nodes;
+	ir_node            **nodes;
+	unsigned            *opcodes;
+	ir_mode            **node_modes;
+	ir_node            **in;      /**< operands of the node being read */
+	bool                 forward; /**< a node was referenced before it was
+	                                   constructed */
+} reader_t;
+
+static void init_reader(reader_t *const r, binary_ir_t *const file,
+                        unsigned char const *const begin, size_t const size)
+{
+	memset(r, 0, sizeof(*r));
+	r->file = file;
+	r->pos  = begin;
+	r->end  = begin + size;
+	r->in   = NEW_ARR_F(ir_node*, 0);
+}
+
+static uint64_t get_unsigned(reader_t *const r)
+{
+	uint64_t value = 0;
+	for (unsigned shift = 0; r->pos != r->end && shift < 64; shift += 7) {
+		unsigned char const byte = *r->pos++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return value;
+	}
+	r->error = true;
+	return 0;
+}
+
+static int64_t get_signed(reader_t *const r)
+{
+	uint64_t const value = get_unsigned(r);
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static bool get_bool(reader_t *const r)
+{
+	return get_unsigned(r) != 0;
+}
+
+/** Reads the number of the following items, which take a byte at least. */
+static size_t get_count(reader_t *const r)
+{
+	uint64_t const count = get_unsigned(r);
+	if (count > (uint64_t)(r->end - r->pos)) {
+		r->error = true;
+		return 0;
+	}
+	return count;
+}
+
+static ident *get_ident(reader_t *const r)
+{
+	uint64_t const index = get_unsigned(r);
+	if (index == 0)
+		return NULL;
+	if (index > ARR_LEN(r->file->idents)) {
+		r->error = true;
+		return NULL;
+	}
+	return r->file->idents[index - 1];
+}
+
+static ir_mode *get_mode_ref(reader_t *const r)
+{
+	uint64_t const index = get_unsigned(r);
+	if (index >= ARR_LEN(r->file->modes)) {
+		r->error = true;
+		return NULL;
+	}
+	return r->file->modes[index];
+}
+
+static ir_type *get_type_ref(reader_t *const r)
+{
+	uint64_t const index = get_unsigned(r);
+	if (index >= ARR_LEN(r->file->types)) {
+		r->error = true;
+		return NULL;
+	}
+	return r->file->types[index];
+}
+
+static ir_entity *get_entity_ref(reader_t *const r)
+{
+	uint64_t    const ref      = get_unsigned(r);
+	uint64_t    const index    = ref >> 1;
+	ir_entity **const entities = ref & 1 ? r->locals : r->file->entities;
+	if (entities == NULL || index >= ARR_LEN(entities)) {
+		r->error = true;
+		return NULL;
+	}
+	return entities[index];
+}
+
+static ir_tarval *get_tarval(reader_t *const r)
+{
+	ir_mode *const mode = get_mode_ref(r);
+	if (mode == NULL)
+		return NULL;
+	if (mode == mode_b)
+		return get_bool(r) ? get_tarval_b_true() : get_tarval_b_false();
+
+	size_t const size = (get_mode_size_bits(mode) + 7) / 8;
+	if (size > (size_t)(r->end - r->pos)) {
+		r->error = true;
+		return NULL;
+	}
+	ir_tarval *const tv = new_tarval_from_bytes(r->pos, mode);
+	r->pos += size;
+	return tv;
+}
+
+typedef struct layout_t {
+	unsigned      size;
+	unsigned      alignment;
+	ir_type_state state;
+} layout_t;
+
+static layout_t get_layout(reader_t *const r)
+{
+	layout_t layout;
+	layout.size      = get_unsigned(r);
+	layout.alignment = get_unsigned(r);
+	layout.state     = (ir_type_state)get_unsigned(r);
+	return layout;
+}
+
+static void set_layout(ir_type *const type, layout_t const *const layout)
+{
+	set_type_size(type, layout->size);
+	set_type_alignment(type, layout->alignment);
+	if (layout->state == layout_fixed)
+		set_type_state(type, layout_fixed);
+}
+
+static void report_malformed(binary_ir_t const *const file)
+{
+	position_t const pos = { file->filename, 0, 0, 0 };
+	errorf(&pos, "malformed IR file");
+}
+
+static bool read_strings(reader_t *const r)
+{
+	for (size_t i = 0, n = get_count(r); i != n; ++i) {
+		size_t const len = get_count(r);
+		if (r->error)
+			return false;
+		ident *const id = new_id_from_chars((char const*)r->pos, len);
+		ARR_APP1(ident*, r->file->idents, id);
+		r->pos += len;
+	}
+	return !r->error;
+}
+
+static ir_mode *find_mode(char const *const name)
+{
+	for (size_t i = 0, n = ir_get_n_modes(); i != n; ++i) {
+		ir_mode *const mode = ir_get_mode(i);
+		if (streq(get_mode_name(mode), name))
+			return mode;
+	}
+	return NULL;
+}
+
+static bool read_modes(reader_t *const r)
+{
+	for (size_t i = 0, n = get_count(r); i != n; ++i) {
+		ident             *const name         = get_ident(r);
+		ir_mode_sort       const sort         = (ir_mode_sort)get_unsigned(r);
+		unsigned           const bits         = get_unsigned(r);
+		bool               const sign         = get_bool(r);
+		ir_mode_arithmetic const arithmetic   = (ir_mode_arithmetic)get_unsigned(r);
+		unsigned           const modulo_shift = get_unsigned(r);
+		unsigned                 exponent     = 0;
+		unsigned                 mantissa     = 0;
+		float_int_conversion_overflow_style_t overflow = ir_overflow_indefinite;
+		if (sort == irms_float_number) {
+			exponent = get_unsigned(r);
+			mantissa = get_unsigned(r);
+			overflow = (float_int_conversion_overflow_style_t)get_unsigned(r);
+		}
+		if (r->error || name == NULL)
+			return false;
+
+		char const *const mode_name = get_id_str(name);
+		ir_mode          *mode      = find_mode(mode_name);
+		if (mode == NULL) {
+			switch (sort) {
+			case irms_int_number:
+				mode = new_int_mode(mode_name, bits, sign, modulo_shift);
+				break;
+			case irms_reference:
+				mode = new_reference_mode(mode_name, bits, modulo_shift);
+				break;
+			case irms_float_number:
+				mode = new_float_mode(mode_name, arithmetic, exponent, mantissa,
+				                      overflow);
+				break;
+			default:
+				return false;
+			}
+		}
+		ARR_APP1(ir_mode*, r->file->modes, mode);
+	}
+	return true;
+}
+
+static ir_type *read_type(reader_t *const r, record_kind_t const kind)
+{
+	switch (kind) {
+	case RECORD_PRIMITIVE: {
+		ir_mode *const mode   = get_mode_ref(r);
+		layout_t const layout = get_layout(r);
+		if (r->error)
+			return NULL;
+		ir_type *const type = new_type_primitive(mode);
+		set_layout(type, &layout);
+		return type;
+	}
+	case RECORD_POINTER: {
+		ir_type *const points_to = get_type_ref(r);
+		layout_t const layout    = get_layout(r);
+		if (r->error)
+			return NULL;
+		ir_type *const type = new_type_pointer(points_to);
+		set_layout(type, &layout);
+		return type;
+	}
+	case RECORD_ARRAY: {
+		ir_type *const element = get_type_ref(r);
+		layout_t const layout  = get_layout(r);
+		if (r->error)
+			return NULL;
+		ir_type *const type = new_type_array(element);
+		set_layout(type, &layout);
+		return type;
+	}
+	case RECORD_METHOD: {
+		size_t const n_params = get_count(r);
+		size_t const n_ress   = get_count(r);
+		if (r->error)
+			return NULL;
+		ir_type *const type = new_type_method(n_params, n_ress);
+		for (size_t i = 0; i != n_params; ++i) {
+			ir_type *const param = get_type_ref(r);
+			if (param == NULL)
+				return NULL;
+			set_method_param_type(type, i, param);
+		}
+		for (size_t i = 0; i != n_ress; ++i) {
+			ir_type *const res = get_type_ref(r);
+			if (res == NULL)
+				return NULL;
+			set_method_res_type(type, i, res);
+		}
+		bool                      const variadic   = get_bool(r);
+		unsigned                  const cc         = get_unsigned(r);
+		mtp_additional_properties const properties
+			= (mtp_additional_properties)get_unsigned(r);
+		if (r->error)
+			return NULL;
+		set_method_variadic(type, variadic);
+		set_method_calling_convention(type, cc);
+		set_method_additional_properties(type, properties);
+		return type;
+	}
+	case RECORD_STRUCT:
+	case RECORD_UNION: {
+		ident *const name = get_ident(r);
+		if (r->error)
+			return NULL;
+		return kind == RECORD_STRUCT ? new_type_struct(name)
+		                             : new_type_union(name);
+	}
+	case RECORD_SEGMENT: {
+		uint64_t const segment = get_unsigned(r);
+		if (r->error || segment > IR_SEGMENT_LAST)
+			break;
+		return get_segment_type((ir_segment_t)segment);
+	}
+	case RECORD_CODE_TYPE:
+		return get_code_type();
+	case RECORD_UNKNOWN_TYPE:
+		return get_unknown_type();
+	default:
+		break;
+	}
+	r->error = true;
+	return NULL;
+}
+
+static ir_entity *read_entity(reader_t *const r, ir_type *const owner)
+{
+	ir_entity_kind const kind       = (ir_entity_kind)get_unsigned(r);
+	ident         *const name       = get_ident(r);
+	ident         *const ld_name    = get_ident(r);
+	ir_type       *const type       = get_type_ref(r);
+	ir_visibility  const visibility = (ir_visibility)get_unsigned(r);
+	ir_linkage     const linkage    = (ir_linkage)get_unsigned(r);
+	ir_volatility  const volatility = (ir_volatility)get_unsigned(r);
+	unsigned       const alignment  = get_unsigned(r);
+	int                       offset          = 0;
+	unsigned                  bitfield_offset = 0;
+	unsigned                  bitfield_size   = 0;
+	size_t                    parameter       = 0;
+	mtp_additional_properties properties      = mtp_no_property;
+	switch (kind) {
+	case IR_ENTITY_COMPOUND_MEMBER:
+		offset          = get_signed(r);
+		bitfield_offset = get_unsigned(r);
+		bitfield_size   = get_unsigned(r);
+		break;
+	case IR_ENTITY_PARAMETER:
+		parameter = get_unsigned(r);
+		break;
+	case IR_ENTITY_METHOD:
+		properties = (mtp_additional_properties)get_unsigned(r);
+		break;
+	default:
+		break;
+	}
+	if (r->error || (ld_name == NULL && kind != IR_ENTITY_PARAMETER))
+		goto malformed;
+
+	ir_entity *entity;
+	switch (kind) {
+	case IR_ENTITY_PARAMETER:
+		entity = new_parameter_entity(owner, parameter, type);
+		break;
+	case IR_ENTITY_ALIAS:
+		entity = new_alias_entity(owner, ld_name, NULL, type, visibility);
+		break;
+	case IR_ENTITY_NORMAL:
+	case IR_ENTITY_METHOD:
+	case IR_ENTITY_COMPOUND_MEMBER:
+		entity = is_segment_type(owner)
+			? new_global_entity(owner, ld_name, type, visibility, linkage)
+			: new_entity(owner, ld_name, type);
+		break;
+	default:
+		goto malformed;
+	}
+	if (name != NULL)
+		set_entity_ident(entity, name);
+	if (ld_name != NULL)
+		set_entity_ld_ident(entity, ld_name);
+	set_entity_visibility(entity, visibility);
+	set_entity_linkage(entity, linkage);
+	set_entity_volatility(entity, volatility);
+	set_entity_alignment(entity, alignment);
+	if (kind == IR_ENTITY_COMPOUND_MEMBER) {
+		set_entity_offset(entity, offset);
+		set_entity_bitfield_offset(entity, bitfield_offset);
+		set_entity_bitfield_size(entity, bitfield_size);
+	} else if (kind == IR_ENTITY_METHOD) {
+		set_entity_additional_properties(entity, properties);
+	}
+	return entity;
+
+malformed:
+	r->error = true;
+	return NULL;
+}
+
+static bool read_records(reader_t *const r)
+{
+	binary_ir_t *const file = r->file;
+	for (size_t i = 0, n = get_count(r); i != n; ++i) {
+		record_kind_t const kind = (record_kind_t)get_unsigned(r);
+		if (kind == RECORD_ENTITY) {
+			ir_type   *const owner  = get_type_ref(r);
+			ir_entity *const entity = read_entity(r, owner);
+			if (entity == NULL)
+				return false;
+			ARR_APP1(ir_entity*, file->entities, entity);
+		} else if (kind == RECORD_UNKNOWN_ENTITY) {
+			ARR_APP1(ir_entity*, file->entities, get_unknown_entity());
+		} else if (kind == RECORD_LAYOUT) {
+			ir_type *const type   = get_type_ref(r);
+			layout_t const layout = get_layout(r);
+			if (r->error)
+				return false;
+			set_layout(type, &layout);
+		} else {
+			ir_type *const type = read_type(r, kind);
+			if (type == NULL)
+				return false;
+			ARR_APP1(ir_type*, file->types, type);
+		}
+	}
+	return !r->error;
+}
+
+/** Reads a reference to a node, which may be constructed later. */
+static ir_node *get_node_ref(reader_t *const r)
+{
+	uint64_t const ref = get_unsigned(r);
+	if (ref < N_ANCHORS) {
+		ir_node *const anchor = get_anchor(r->irg, (anchor_t)ref);
+		if (anchor == NULL)
+			r->error = true;
+		return anchor;
+	}
+
+	uint64_t const index = ref - N_ANCHORS;
+	if (index >= r->n_nodes) {
+		r->error = true;
+		return NULL;
+	}
+	ir_node *node = r->nodes[index];
+	if (node == NULL) {
+		/* replaced when the node is constructed */
+		node = new_r_Dummy(r->irg, r->node_modes[index]);
+		r->nodes[index] = node;
+		r->forward      = true;
+	}
+	return node;
+}
+
+static ir_node **get_ins(reader_t *const r, size_t const arity)
+{
+	ARR_RESIZE(ir_node*, r->in, arity);
+	for (size_t i = 0; i != arity; ++i) {
+		r->in[i] = get_node_ref(r);
+	}
+	return r->in;
+}
+
+static ir_asm_constraint *read_constraints(reader_t *const r, size_t const n)
+{
+	ir_asm_constraint *const constraints = NEW_ARR_F(ir_asm_constraint, n);
+	for (size_t i = 0; i != n; ++i) {
+		constraints[i].pos        = get_unsigned(r);
+		constraints[i].constraint = get_ident(r);
+		constraints[i].mode       = get_mode_ref(r);
+	}
+	return constraints;
+}
+
+static ir_node *read_asm(reader_t *const r, ir_node *const block,
+                         size_t const arity, ir_node **const in)
+{
+	ident             *const text      = get_ident(r);
+	size_t             const n_inputs  = arity != 0 ? arity - 1 : 0;
+	ir_asm_constraint *const inputs    = read_constraints(r, n_inputs);
+	size_t             const n_outputs = get_count(r);
+	ir_asm_constraint *const outputs   = read_constraints(r, n_outputs);
+	size_t             const n_clobbers = get_count(r);
+	ident            **const clobbers  = NEW_ARR_F(ident*, n_clobbers);
+	for (size_t i = 0; i != n_clobbers; ++i) {
+		clobbers[i] = get_ident(r);
+	}
+	bool const pinned = get_bool(r);
+
+	ir_node *node = NULL;
+	if (arity != 0 && !r->error) {
+		node = new_r_ASM(block, in[0], n_inputs, in + 1, inputs, n_outputs,
+		                 outputs, n_clobbers, clobbers, text);
+		set_irn_pinned(node, pinned ? op_pin_state_pinned : op_pin_state_floats);
+	}
+	DEL_ARR_F(clobbers);
+	DEL_ARR_F(outputs);
+	DEL_ARR_F(inputs);
+	return node;
+}
+
+static ir_node *read_switch(reader_t *const r, ir_node *const block,
+                            size_t const arity, ir_node **const in)
+{
+	unsigned const n_outs    = get_unsigned(r);
+	size_t   const n_entries = get_count(r);
+	if (r->error)
+		return NULL;
+	ir_switch_table *const table = ir_new_switch_table(r->irg, n_entries);
+	for (size_t i = 0; i != n_entries; ++i) {
+		ir_tarval *const min = get_tarval(r);
+		ir_tarval *const max = get_tarval(r);
+		unsigned   const pn  = get_unsigned(r);
+		if (r->error)
+			return NULL;
+		ir_switch_table_set(table, i, min, max, pn);
+	}
+	if (arity != 1)
+		return NULL;
+	return new_r_Switch(block, in[0], n_outs, table);
+}
+
+#define BINOP(name) \
+	case iro_##name: \
+		if (arity != 2) \
+			break; \
+		return new_r_##name(block, in[0], in[1], mode);
+
+#define UNOP(name) \
+	case iro_##name: \
+		if (arity != 1) \
+			break; \
+		return new_r_##name(block, in[0], mode);
+
+/** Constructs the next node, returns NULL if it is malformed. */
+static ir_node *read_node(reader_t *const r, unsigned const opcode,
+                          ir_mode *const mode)
+{
+	ir_graph *const irg = r->irg;
+	if (opcode == iro_Block) {
+		size_t    const n_preds   = get_count(r);
+		ir_node **const in        = get_ins(r, n_preds);
+		bool      const has_label = get_bool(r);
+		if (r->error || (has_label && r->locals == NULL))
+			return NULL;
+		ir_node *const block = new_r_Block(irg, n_preds, in);
+		if (has_label)
+			ARR_APP1(ir_entity*, r->locals, create_Block_entity(block));
+		return block;
+	}
+
+	ir_node  *const block = get_node_ref(r);
+	size_t    const arity = get_count(r);
+	ir_node **const in    = get_ins(r, arity);
+	if (r->error)
+		return NULL;
+
+	switch (opcode) {
+	BINOP(Add)
+	BINOP(And)
+	BINOP(Eor)
+	BINOP(Mul)
+	BINOP(Or)
+	BINOP(Shl)
+	BINOP(Shr)
+	BINOP(Shrs)
+	BINOP(Sub)
+	UNOP(Conv)
+	UNOP(Minus)
+	UNOP(Not)
+
+	case iro_Address: {
+		ir_entity *const entity = get_entity_ref(r);
+		if (arity != 0 || r->error)
+			break;
+		return new_r_Address(irg, entity);
+	}
+	case iro_Alloc: {
+		unsigned const alignment = get_unsigned(r);
+		if (arity != 2 || r->error)
+			break;
+		return new_r_Alloc(block, in[0], in[1], alignment);
+	}
+	case iro_ASM:
+		return read_asm(r, block, arity, in);
+	case iro_Bad:
+		if (arity != 0)
+			break;
+		return new_r_Bad(irg, mode);
+	case iro_Builtin: {
+		ir_builtin_kind const kind = (ir_builtin_kind)get_unsigned(r);
+		ir_type        *const type = get_type_ref(r);
+		if (arity == 0 || r->error)
+			break;
+		return new_r_Builtin(block, in[0], arity - 1, in + 1, kind, type);
+	}
+	case iro_Call: {
+		ir_type *const type   = get_type_ref(r);
+		bool     const throws = get_bool(r);
+		bool     const pinned = get_bool(r);
+		if (arity < 2 || r->error)
+			break;
+		ir_node *const call
+			= new_r_Call(block, in[0], in[1], arity - 2, in + 2, type);
+		ir_set_throws_exception(call, throws);
+		set_irn_pinned(call, pinned ? op_pin_state_pinned : op_pin_state_floats);
+		return call;
+	}
+	case iro_Cmp: {
+		ir_relation const relation = (ir_relation)get_unsigned(r);
+		if (arity != 2 || r->error)
+			break;
+		return new_r_Cmp(block, in[0], in[1], relation);
+	}
+	case iro_Cond: {
+		cond_jmp_predicate const pred = (cond_jmp_predicate)get_unsigned(r);
+		if (arity != 1 || r->error)
+			break;
+		ir_node *const cond = new_r_Cond(block, in[0]);
+		set_Cond_jmp_pred(cond, pred);
+		return cond;
+	}
+	case iro_Confirm: {
+		ir_relation const relation = (ir_relation)get_unsigned(r);
+		if (arity != 2 || r->error)
+			break;
+		return new_r_Confirm(block, in[0], in[1], relation);
+	}
+	case iro_Const: {
+		ir_tarval *const tv = get_tarval(r);
+		if (arity != 0 || r->error)
+			break;
+		return new_r_Const(irg, tv);
+	}
+	case iro_CopyB: {
+		ir_type      *const type  = get_type_ref(r);
+		ir_cons_flags const flags = (ir_cons_flags)get_unsigned(r);
+		if (arity != 3 || r->error)
+			break;
+		return new_r_CopyB(block, in[0], in[1], in[2], type, flags);
+	}
+	case iro_Div: {
+		ir_mode *const resmode      = get_mode_ref(r);
+		bool     const no_remainder = get_bool(r);
+		bool     const pinned       = get_bool(r);
+		bool     const throws       = get_bool(r);
+		if (arity != 3 || r->error)
+			break;
+		ir_node *const div = no_remainder
+			? new_r_DivRL(block, in[0], in[1], in[2], resmode, pinned)
+			: new_r_Div(block, in[0], in[1], in[2], resmode, pinned);
+		ir_set_throws_exception(div, throws);
+		return div;
+	}
+	case iro_IJmp:
+		if (arity != 1)
+			break;
+		return new_r_IJmp(block, in[0]);
+	case iro_Jmp:
+		if (arity != 0)
+			break;
+		return new_r_Jmp(block);
+	case iro_Load: {
+		ir_mode      *const load_mode = get_mode_ref(r);
+		ir_type      *const type      = get_type_ref(r);
+		ir_cons_flags const flags     = (ir_cons_flags)get_unsigned(r);
+		if (arity != 2 || r->error)
+			break;
+		return new_r_Load(block, in[0], in[1], load_mode, type, flags);
+	}
+	case iro_Member: {
+		ir_entity *const entity = get_entity_ref(r);
+		if (arity != 1 || r->error)
+			break;
+		return new_r_Member(block, in[0], entity);
+	}
+	case iro_Mod: {
+		ir_mode *const resmode = get_mode_ref(r);
+		bool     const pinned  = get_bool(r);
+		bool     const throws  = get_bool(r);
+		if (arity != 3 || r->error)
+			break;
+		ir_node *const mod
+			= new_r_Mod(block, in[0], in[1], in[2], resmode, pinned);
+		ir_set_throws_exception(mod, throws);
+		return mod;
+	}
+	case iro_NoMem:
+		if (arity != 0)
+			break;
+		return new_r_NoMem(irg);
+	case iro_Phi: {
+		bool const loop = get_bool(r);
+		if (r->error)
+			break;
+		ir_node *const phi = new_r_Phi(block, arity, in, mode);
+		set_Phi_loop(phi, loop);
+		return phi;
+	}
+	case iro_Pin:
+		if (arity != 1)
+			break;
+		return new_r_Pin(block, in[0]);
+	case iro_Proj: {
+		unsigned const num = get_unsigned(r);
+		if (arity != 1 || r->error)
+			break;
+		return new_r_Proj(in[0], mode, num);
+	}
+	case iro_Return:
+		if (arity == 0)
+			break;
+		return new_r_Return(block, in[0], arity - 1, in + 1);
+	case iro_Sel: {
+		ir_type *const type = get_type_ref(r);
+		if (arity != 2 || r->error)
+			break;
+		return new_r_Sel(block, in[0], in[1], type);
+	}
+	case iro_Store: {
+		ir_type      *const type  = get_type_ref(r);
+		ir_cons_flags const flags = (ir_cons_flags)get_unsigned(r);
+		if (arity != 3 || r->error)
+			break;
+		return new_r_Store(block, in[0], in[1], in[2], type, flags);
+	}
+	case iro_Switch:
+		return read_switch(r, block, arity, in);
+	case iro_Sync:
+		return new_r_Sync(block, arity, in);
+	case iro_Unknown:
+		if (arity != 0)
+			break;
+		return new_r_Unknown(irg, mode);
+	}
+	return NULL;
+}
+
+#undef UNOP
+#undef BINOP
+
+/** Reads a node array into r->irg, the nodes stay referable until
+ * free_nodes() is called. */
+static bool read_nodes(reader_t *const r)
+{
+	size_t const n_nodes = get_count(r);
+	r->n_nodes    = n_nodes;
+	r->nodes      = XMALLOCNZ(ir_node*, n_nodes);
+	r->opcodes    = XMALLOCN(unsigned, n_nodes);
+	r->node_modes = XMALLOCN(ir_mode*, n_nodes);
+	r->forward    = false;
+	for (size_t i = 0; i != n_nodes; ++i) {
+		r->opcodes[i]    = get_unsigned(r);
+		r->node_modes[i] = get_mode_ref(r);
+	}
+	if (r->error)
+		return false;
+
+	for (size_t i = 0; i != n_nodes; ++i) {
+		ir_node *const node = read_node(r, r->opcodes[i], r->node_modes[i]);
+		if (node == NULL) {
+			r->error = true;
+			return false;
+		}
+		if (r->nodes[i] != NULL)
+			exchange(r->nodes[i], node);
+		r->nodes[i] = node;
+	}
+
+	if (r->forward) {
+		/* a Proj constructed before its predecessor was placed in the block
+		 * of the placeholder */
+		for (size_t i = 0; i != n_nodes; ++i) {
+			ir_node *const node = r->nodes[i];
+			if (!is_Proj(node))
+				continue;
+			ir_node *pred = node;
+			do {
+				pred = get_Proj_pred(pred);
+			} while (is_Proj(pred));
+			set_nodes_block(node, get_nodes_block(pred));
+		}
+	}
+	return true;
+}
+
+static void free_nodes(reader_t *const r)
+{
+	free(r->node_modes);
+	free(r->opcodes);
+	free(r->nodes);
+	r->n_nodes    = 0;
+	r->nodes      = NULL;
+	r->opcodes    = NULL;
+	r->node_modes = NULL;
+}
+
+/** Reads a constant expression into the const code graph. */
+static ir_node *read_expression(reader_t *const r)
+{
+	r->irg = get_const_code_irg();
+	ir_node *value = NULL;
+	if (read_nodes(r))
+		value = get_node_ref(r);
+	free_nodes(r);
+	r->irg = NULL;
+	return r->error ? NULL : value;
+}
+
+static ir_initializer_t *read_initializer(reader_t *const r)
+{
+	switch ((ir_initializer_kind_t)get_unsigned(r)) {
+	case IR_INITIALIZER_CONST: {
+		ir_node *const value = read_expression(r);
+		if (value == NULL)
+			return NULL;
+		return create_initializer_const(value);
+	}
+	case IR_INITIALIZER_TARVAL: {
+		ir_tarval *const tv = get_tarval(r);
+		if (r->error)
+			return NULL;
+		return create_initializer_tarval(tv);
+	}
+	case IR_INITIALIZER_NULL:
+		return get_initializer_null();
+	case IR_INITIALIZER_COMPOUND: {
+		size_t const n = get_count(r);
+		if (r->error)
+			return NULL;
+		ir_initializer_t *const initializer = create_initializer_compound(n);
+		for (size_t i = 0; i != n; ++i) {
+			ir_initializer_t *const value = read_initializer(r);
+			if (value == NULL)
+				return NULL;
+			set_initializer_compound_value(initializer, i, value);
+		}
+		return initializer;
+	}
+	}
+	r->error = true;
+	return NULL;
+}
+
+static bool read_definitions(reader_t *const r)
+{
+	for (size_t i = 0, n = get_count(r); i != n; ++i) {
+		ir_entity        *const entity = get_entity_ref(r);
+		definition_kind_t const kind   = (definition_kind_t)get_unsigned(r);
+		if (r->error)
+			return false;
+		if (kind == DEFINITION_ALIAS) {
+			ir_entity *const alias = get_entity_ref(r);
+			if (r->error)
+				return false;
+			set_entity_alias(entity, alias);
+		} else if (kind == DEFINITION_INITIALIZER) {
+			ir_initializer_t *const initializer = read_initializer(r);
+			if (initializer == NULL)
+				return false;
+			set_entity_initializer(entity, initializer);
+		} else {
+			return false;
+		}
+	}
+	return !r->error;
+}
+
+static bool read_functions(reader_t *const r)
+{
+	binary_ir_t *const file = r->file;
+	for (size_t i = 0, n = get_count(r); i != n; ++i) {
+		function_t function;
+		function.entity = get_entity_ref(r);
+		function.offset = get_unsigned(r);
+		function.size   = get_unsigned(r);
+		function.irg    = NULL;
+		if (r->error || !is_method_entity(function.entity))
+			return false;
+		ARR_APP1(function_t, file->functions, function);
+	}
+	size_t const bodies_size = get_count(r);
+	if (r->error)
+		return false;
+	file->bodies      = r->pos;
+	file->bodies_size = bodies_size;
+	for (size_t i = 0, n = ARR_LEN(file->functions); i != n; ++i) {
+		function_t const *const function = &file->functions[i];
+		if (function->offset > bodies_size
+		 || function->size > bodies_size - function->offset)
+			return false;
+	}
+	return true;
+}
+
+/** Reads the rest of the file after the magic consumed by
+ * binary_ir_detect(), which is put in front again. */
+static bool read_data(binary_ir_t *const file, FILE *const in)
+{
+	size_t         size     = MAGIC_SIZE;
+	size_t         capacity = 1 << 16;
+	unsigned char *data     = XMALLOCN(unsigned char, capacity);
+	memcpy(data, MAGIC, MAGIC_SIZE);
+	for (;;) {
+		size += fread(data + size, 1, capacity - size, in);
+		if (size < capacity)
+			break;
+		capacity *= 2;
+		data = XREALLOC(data, unsigned char, capacity);
+	}
+	file->data = data;
+	file->size = size;
+	return ferror(in) == 0;
+}
+
+static uint64_t get_fixed(unsigned char const *const data, unsigned const size)
+{
+	uint64_t value = 0;
+	for (unsigned i = 0; i != size; ++i) {
+		value |= (uint64_t)data[i] << (8 * i);
+	}
+	return value;
+}
+
+bool binary_ir_detect(FILE *const in)
+{
+	int const c = getc(in);
+	if (c == EOF)
+		return false;
+	if (c != MAGIC[0]) {
+		ungetc(c, in);
+		return false;
+	}
+	/* no other format starts with this byte, so it is fine to consume the
+	 * rest of a mismatching magic */
+	char magic[MAGIC_SIZE - 1];
+	return fread(magic, 1, sizeof(magic), in) == sizeof(magic)
+	    && memcmp(magic, MAGIC + 1, sizeof(magic)) == 0;
+}
+
+binary_ir_t *binary_ir_open(FILE *const in, char const *const filename)
+{
+	binary_ir_t *const file = XMALLOCZ(binary_ir_t);
+	file->filename  = filename;
+	file->idents    = NEW_ARR_F(ident*, 0);
+	file->modes     = NEW_ARR_F(ir_mode*, 0);
+	file->types     = NEW_ARR_F(ir_type*, 0);
+	file->entities  = NEW_ARR_F(ir_entity*, 0);
+	file->functions = NEW_ARR_F(function_t, 0);
+	position_t const pos = { filename, 0, 0, 0 };
+	if (!read_data(file, in)) {
+		errorf(&pos, "reading IR file failed");
+		goto error;
+	}
+
+	unsigned char const *const data = file->data;
+	if (file->size < HEADER_SIZE)
+		goto malformed;
+	uint64_t const version = get_fixed(data + MAGIC_SIZE, 4);
+	if (version != VERSION) {
+		errorf(&pos, "IR file has unsupported version %u", (unsigned)version);
+		goto error;
+	}
+	unsigned const major     = (unsigned)get_fixed(data + FIRM_OFFSET, 2);
+	unsigned const minor     = (unsigned)get_fixed(data + FIRM_OFFSET + 2, 2);
+	unsigned const n_opcodes = (unsigned)get_fixed(data + FIRM_OFFSET + 4, 4);
+	if (major != ir_get_version_major() || minor != ir_get_version_minor()
+	 || n_opcodes != (unsigned)iro_last + 1) {
+		errorf(&pos, "IR file was written by libfirm %u.%u with %u opcodes, not by libfirm %u.%u with %u opcodes",
+		       major, minor, n_opcodes, ir_get_version_major(),
+		       ir_get_version_minor(), (unsigned)iro_last + 1);
+		goto error;
+	}
+	uint64_t const tables = get_fixed(data + TABLES_OFFSET, 8);
+	if (tables < HEADER_SIZE || tables > file->size)
+		goto malformed;
+
+	reader_t r;
+	init_reader(&r, file, data + tables, file->size - tables);
+	bool ok = read_strings(&r) && read_modes(&r);
+	if (ok) {
+		r.pos = data + HEADER_SIZE;
+		r.end = data + tables;
+		int const old_optimize = get_optimize();
+		set_optimize(0);
+		ok = read_records(&r) && read_definitions(&r);
+		set_optimize(old_optimize);
+		for (size_t i = 0, n = ok ? get_count(&r) : 0; i != n; ++i) {
+			ident *const text = get_ident(&r);
+			if (text == NULL) {
+				r.error = true;
+				break;
+			}
+			add_irp_asm(text);
+		}
+		ok = ok && !r.error && read_functions(&r);
+	}
+	DEL_ARR_F(r.in);
+	if (ok)
+		return file;
+
+malformed:
+	report_malformed(file);
+error:
+	binary_ir_close(file);
+	return NULL;
+}
+
+size_t binary_ir_n_functions(binary_ir_t const *const file)
+{
+	return ARR_LEN(file->functions);
+}
+
+ir_entity *binary_ir_get_function(binary_ir_t const *const file,
+                                  size_t const i)
+{
+	return file->functions[i].entity;
+}
+
+ir_graph *binary_ir_load_function(binary_ir_t *const file, size_t const i)
+{
+	function_t *const function = &file->functions[i];
+	if (function->irg != NULL)
+		return function->irg;
+
+	reader_t r;
+	init_reader(&r, file, file->bodies + function->offset, function->size);
+	ir_graph *const irg = new_ir_graph(function->entity, 0);
+	r.irg    = irg;
+	r.locals = NEW_ARR_F(ir_entity*, 0);
+
+	ir_type *const frame = get_irg_frame_type(irg);
+	for (size_t i = 0, n = get_count(&r); i != n; ++i) {
+		ir_entity *const local = read_entity(&r, frame);
+		if (local == NULL)
+			break;
+		ARR_APP1(ir_entity*, r.locals, local);
+	}
+	layout_t const layout = get_layout(&r);
+	if (!r.error)
+		set_layout(frame, &layout);
+
+	int const old_optimize = get_optimize();
+	set_optimize(0);
+	if (!r.error && read_nodes(&r)) {
+		ir_node *const end_block = get_irg_end_block(irg);
+		for (size_t i = 0, n = get_count(&r); i != n; ++i) {
+			ir_node *const pred = get_node_ref(&r);
+			if (r.error)
+				break;
+			add_immBlock_pred(end_block, pred);
+		}
+		ir_node *const end = get_irg_end(irg);
+		for (size_t i = 0, n = get_count(&r); i != n; ++i) {
+			ir_node *const keepalive = get_node_ref(&r);
+			if (r.error)
+				break;
+			add_End_keepalive(end, keepalive);
+		}
+	}
+	free_nodes(&r);
+	set_optimize(old_optimize);
+	irg_finalize_cons(irg);
+	DEL_ARR_F(r.locals);
+	DEL_ARR_F(r.in);
+
+	if (r.error) {
+		position_t const pos = { file->filename, 0, 0, 0 };
+		errorf(&pos, "malformed body of function %u ('%s') in IR file",
+		       (unsigned)i, get_entity_ld_name(function->entity));
+		return NULL;
+	}
+	function->irg = irg;
+	return irg;
+}
+
+void binary_ir_close(binary_ir_t *const file)
+{
+	DEL_ARR_F(file->functions);
+	DEL_ARR_F(file->entities);
+	DEL_ARR_F(file->types);
+	DEL_ARR_F(file->modes);
+	DEL_ARR_F(file->idents);
+	free(file->data);
+	free(file);
+}
+
+bool binary_ir_read(FILE *const in, char const *const filename)
+{
+	binary_ir_t *const file = binary_ir_open(in, filename);
+	if (file == NULL)
+		return false;
+	bool ok = true;
+	for (size_t i = 0, n = binary_ir_n_functions(file); i != n && ok; ++i) {
+		ok = binary_ir_load_function(file, i) != NULL;
+	}
+	binary_ir_close(file);
+	return ok;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief binary format of IR files
+ *
+ * A file starts with a magic, the libfirm version and opcode count it was
+ * written with and the offset of its identifier and mode tables, which
+ * everything else refers to by index. The declarations of the types and
+ * entities follow in an order that allows constructing them in one pass,
+ * then the initializers and an index of the function bodies. A body holds
+ * the entities of the frame and the node array of the graph, so a function
+ * is only constructed when it is loaded. Debug information is not stored.
+ */
+#ifndef BINARY_IR_H
+#define BINARY_IR_H
+
+#include <libfirm/firm_types.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct binary_ir_t binary_ir_t;
+
+/**
+ * Writes the program to @p out. Returns false without writing anything if
+ * the program contains constructs the format cannot express.
+ */
+bool binary_ir_write(FILE *out);
+
+/**
+ * Writes the SHA-256 of the binary form of the program as hex digits to
+ * @p hash. Returns false if the program cannot be written in binary form.
+ */
+bool binary_ir_hash(char hash[65]);
+
+/**
+ * Returns whether @p in continues with a binary IR file. The magic is
+ * consumed if the first byte matches, binary_ir_open() expects the stream
+ * right after it.
+ */
+bool binary_ir_detect(FILE *in);
+
+/**
+ * Adds the types and entities of the binary IR file @p in to the program.
+ * Function bodies are constructed by binary_ir_load_function(). Reports an
+ * error and returns NULL if the file is malformed.
+ */
+binary_ir_t *binary_ir_open(FILE *in, char const *filename);
+
+/** Returns the number of function bodies in @p file. */
+size_t binary_ir_n_functions(binary_ir_t const *file);
+
+/** Returns the entity of the @p i-th function body in @p file. */
+ir_entity *binary_ir_get_function(binary_ir_t const *file, size_t i);
+
+/**
+ * Constructs the graph of the @p i-th function body in @p file, unless it
+ * is loaded already. Reports an error naming the file and the function and
+ * returns NULL if the body is malformed.
+ */
+ir_graph *binary_ir_load_function(binary_ir_t *file, size_t i);
+
+void binary_ir_close(binary_ir_t *file);
+
+/** Reads the binary IR file @p in including all function bodies. */
+bool binary_ir_read(FILE *in, char const *filename);
+
+#endif
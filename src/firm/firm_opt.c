@@ -8,17 +8,31 @@
  * @author Michael Beck, Matthias Braun
  * @brief Firm-generating back end optimizations.
  */
+#include "driver/enable_posix.h"
+
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
 #include <libfirm/firm.h>
+#include <libfirm/irhooks.h>
+#include <libfirm/statev.h>
+#ifdef HAVE_FORK
+#include <sys/wait.h>
+#endif
 
 #include "firm_opt.h"
+#include "function_cache.h"
+#include "adt/array.h"
 #include "adt/panic.h"
+#include "adt/pset_new.h"
 #include "adt/strutil.h"
 #include "adt/util.h"
+#include "adt/xmalloc.h"
+#include "driver/diagnostic.h"
 #include "driver/timing.h"
 
 /* optimization settings */
@@ -36,6 +50,12 @@ struct a_firm_opt {
 	int      clone_threshold; /**< The threshold value for procedure cloning. */
 	unsigned inline_maxsize;  /**< Maximum function size for inlining. */
 	unsigned inline_threshold;/**< Inlining benefice threshold. */
+	unsigned codegen_jobs;    /**< Number of processes running the backend,
+	                               0 for the default. */
+	unsigned expensive_max_nodes; /**< Node limit for expensive passes. */
+	unsigned expensive_max_msec;  /**< Time limit for expensive passes. */
+	bool     profile_generate; /**< instrument to count block executions */
+	bool     profile_use;      /**< optimize using counted block executions */
 };
 
 /* dumping options */
@@ -45,6 +65,7 @@ struct a_firm_dump {
 	bool ir_graph;      /**< dump all graphs */
 	bool all_phases;    /**< dump the IR graph after all phases */
 	bool statistic;     /**< Firm statistic setting */
+	bool passes;        /**< print the optimization pipeline */
 };
 
 struct a_firm_be_opt {
@@ -52,8 +73,8 @@ struct a_firm_be_opt {
 	bool node_stat;
 };
 
-/* optimization settings */
-static struct a_firm_opt firm_opt = {
+/* default optimization settings */
+static struct a_firm_opt const default_firm_opt = {
 	.const_folding    =  true,
 	.cse              =  true,
 	.confirm          =  true,
@@ -71,8 +92,14 @@ static struct a_firm_opt firm_opt = {
 	.clone_threshold  =  DEFAULT_CLONE_THRESHOLD,
 	.inline_maxsize   =  750,
 	.inline_threshold =  0,
+	.codegen_jobs     =  0,
+	.expensive_max_nodes = 200000,
+	.expensive_max_msec  = 10000,
 };
 
+/* optimization settings */
+static struct a_firm_opt firm_opt;
+
 /* dumping options */
 static struct a_firm_dump firm_dump = {
 	.debug_print  = false,
@@ -112,6 +139,9 @@ static const struct params {
   { X("strict-aliasing"),        &firm_opt.strict_alias,     1, "strict alias rules" },
   { X("no-strict-aliasing"),     &firm_opt.strict_alias,     0, "strict alias rules" },
   { X("clone-threshold=<value>"),NULL,                       0, "set clone threshold to <value>" },
+  { X("codegen-jobs=<n>"),       NULL,                       0, "run the code generator in <n> processes" },
+  { X("expensive-max-nodes=<n>"),NULL,                       0, "skip expensive optimizations on graphs with more than <n> nodes" },
+  { X("expensive-max-time=<ms>"),NULL,                       0, "skip expensive optimizations on a graph after spending <ms> in them" },
 
   /* other firm regarding options */
   { X("verify-off"),             &firm_opt.verify,           0, "disable node verification" },
@@ -122,6 +152,10 @@ static const struct params {
   { X("dump-all-types"),         &firm_dump.all_types,       1, "dump graph of all types" },
   { X("dump-all-phases"),        &firm_dump.all_phases,      1, "dump graphs for all optimization phases" },
   { X("dump-filter=<string>"),   NULL,                       0, "set dumper filter" },
+  { X("dump-passes"),            &firm_dump.passes,          1, "print the optimization pipeline" },
+
+  /* pass pipeline */
+  { X("passes=<pipeline>"),      NULL,                       0, "set the optimization pipeline, see -fdump-passes" },
 };
 
 #undef X
@@ -275,6 +309,14 @@ typedef enum opt_flags {
 	                                     -foptions for this transformation */
 	OPT_FLAG_ESSENTIAL    = 1 << 4, /**< output won't work without this pass
 	                                     so we need it even with -O0 */
+	OPT_FLAG_IDEMPOTENT   = 1 << 5, /**< running the pass again on an
+	                                     unchanged graph has no effect */
+	OPT_FLAG_ANALYSIS     = 1 << 6, /**< the pass only computes information
+	                                     for later passes, which counts as a
+	                                     change of the graph */
+	OPT_FLAG_EXPENSIVE    = 1 << 7, /**< the pass is super-linear, it is
+	                                     skipped on graphs exceeding the
+	                                     compile-time budget */
 } opt_flags_t;
 
 typedef void (*transform_irg_func)(ir_graph *irg);
@@ -290,10 +332,12 @@ typedef struct {
 	const char   *description;
 	opt_flags_t   flags;
 	ir_timer_t   *timer;
+	int           level;  /**< lowest -O level enabling the pass */
 } opt_config_t;
 
 static opt_config_t *get_opt(const char *name);
 static void after_transform(ir_graph *irg, const char *name);
+static bool is_over_budget(ir_graph *irg, unsigned long expensive_msec);
 
 static void do_stred(ir_graph *irg)
 {
@@ -345,34 +389,34 @@ static opt_config_t opts[] = {
 #define IRG(a, b, c, d) { OPT_TARGET_IRG, a, .u.transform_irg = b, c, d }
 #define IRP(a, b, c, d) { OPT_TARGET_IRP, a, .u.transform_irp = b, c, d }
 	IRG("bool",              opt_bool,                 "bool simplification",                                   OPT_FLAG_NONE),
-	IRG("combo",             combo,                    "combined CCE, UCE and GVN",                             OPT_FLAG_NONE),
+	IRG("combo",             combo,                    "combined CCE, UCE and GVN",                             OPT_FLAG_IDEMPOTENT | OPT_FLAG_EXPENSIVE),
 	IRG("confirm",           construct_confirms,       "confirm optimization",                                  OPT_FLAG_HIDE_OPTIONS),
-	IRG("control-flow",      optimize_cf,              "optimization of control-flow",                          OPT_FLAG_HIDE_OPTIONS),
-	IRG("dead",              dead_node_elimination,    "dead node elimination",                                 OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_NO_DUMP | OPT_FLAG_NO_VERIFY),
+	IRG("control-flow",      optimize_cf,              "optimization of control-flow",                          OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_IDEMPOTENT),
+	IRG("dead",              dead_node_elimination,    "dead node elimination",                                 OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_NO_DUMP | OPT_FLAG_NO_VERIFY | OPT_FLAG_IDEMPOTENT),
 	IRG("deconv",            conv_opt,                 "conv node elimination",                                 OPT_FLAG_NONE),
 	IRG("occults",           occult_consts,            "occult constant folding",                               OPT_FLAG_NONE),
 	IRG("frame",             opt_frame_irg,            "remove unused frame entities",                          OPT_FLAG_NONE),
-	IRG("gvn-pre",           do_gvn_pre,               "global value numbering partial redundancy elimination", OPT_FLAG_NONE),
+	IRG("gvn-pre",           do_gvn_pre,               "global value numbering partial redundancy elimination", OPT_FLAG_EXPENSIVE),
 	IRG("if-conversion",     opt_if_conv,              "if-conversion",                                         OPT_FLAG_NONE),
 	IRG("invert-loops",      do_loop_inversion,        "loop inversion",                                        OPT_FLAG_NONE),
 	IRG("ivopts",            do_stred,                 "induction variable strength reduction",                 OPT_FLAG_NONE),
-	IRG("local",             optimize_graph_df,        "local graph optimizations",                             OPT_FLAG_HIDE_OPTIONS),
+	IRG("local",             optimize_graph_df,        "local graph optimizations",                             OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_IDEMPOTENT),
 	IRG("lower",             lower_highlevel_graph,    "lowering",                                              OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_ESSENTIAL),
 	IRG("lower-mux",         do_lower_mux,             "mux lowering",                                          OPT_FLAG_NONE),
 	IRG("opt-load-store",    optimize_load_store,      "load store optimization",                               OPT_FLAG_NONE),
 	IRG("memcombine",        combine_memops,           "combine adjacent memory operations",                    OPT_FLAG_NONE),
 	IRG("opt-tail-rec",      opt_tail_rec_irg,         "tail-recursion elimination",                            OPT_FLAG_NONE),
 	IRG("parallelize-mem",   opt_parallelize_mem,      "parallelize memory",                                    OPT_FLAG_NONE),
-	IRG("gcse",              do_gcse,                  "global common subexpression elimination",               OPT_FLAG_NONE),
-	IRG("place",             place_code,               "code placement",                                        OPT_FLAG_NONE),
+	IRG("gcse",              do_gcse,                  "global common subexpression elimination",               OPT_FLAG_IDEMPOTENT),
+	IRG("place",             place_code,               "code placement",                                        OPT_FLAG_IDEMPOTENT),
 	IRG("reassociation",     optimize_reassociation,   "reassociation",                                         OPT_FLAG_NONE),
 	IRG("remove-confirms",   remove_confirms,          "confirm removal",                                       OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_NO_DUMP | OPT_FLAG_NO_VERIFY),
 	IRG("remove-phi-cycles", remove_phi_cycles,        "removal of phi cycles",                                 OPT_FLAG_HIDE_OPTIONS),
 	IRG("scalar-replace",    scalar_replacement_opt,   "scalar replacement",                                    OPT_FLAG_NONE),
 	IRG("shape-blocks",      shape_blocks,             "block shaping",                                         OPT_FLAG_NONE),
 	IRG("thread-jumps",      opt_jumpthreading,        "path-sensitive jumpthreading",                          OPT_FLAG_NONE),
-	IRG("unroll-loops",      do_loop_unrolling,        "loop unrolling",                                        OPT_FLAG_NONE),
-	IRG("vrp",               set_vrp_data,             "value range propagation",                               OPT_FLAG_NONE),
+	IRG("unroll-loops",      do_loop_unrolling,        "loop unrolling",                                        OPT_FLAG_EXPENSIVE),
+	IRG("vrp",               set_vrp_data,             "value range propagation",                               OPT_FLAG_ANALYSIS | OPT_FLAG_EXPENSIVE),
 	IRG("rts",               rts_map,                  "optimization of known library functions",               OPT_FLAG_NONE),
 	IRP("inline",            do_inline,                "inlining",                                              OPT_FLAG_NONE),
 	IRP("lower-const",       lower_const_code,         "lowering of constant code",                             OPT_FLAG_HIDE_OPTIONS | OPT_FLAG_NO_DUMP | OPT_FLAG_NO_VERIFY | OPT_FLAG_ESSENTIAL),
@@ -424,39 +468,250 @@ static void after_transform(ir_graph *irg, const char *name)
 	}
 }
 
+/** Counts the modifications of graphs, see register_modification_hooks(). */
+static unsigned long irg_modifications;
+
+static void count_new_node(void *const context, ir_node *const node)
+{
+	(void)context;
+	(void)node;
+	++irg_modifications;
+}
+
+static void count_set_irn_n(void *const context, ir_node *const src,
+                            int const pos, ir_node *const tgt,
+                            ir_node *const old_tgt)
+{
+	(void)context;
+	(void)src;
+	(void)pos;
+	if (tgt != old_tgt)
+		++irg_modifications;
+}
+
+static void count_replace(void *const context, ir_node *const old_node,
+                          ir_node *const new_node)
+{
+	(void)context;
+	(void)old_node;
+	(void)new_node;
+	++irg_modifications;
+}
+
+static void count_turn_into_id(void *const context, ir_node *const node)
+{
+	(void)context;
+	(void)node;
+	++irg_modifications;
+}
+
+/**
+ * Registers hooks counting node creation and changes of node inputs, so
+ * do_irg_opt() can tell whether a pass changed the graph.
+ */
+static void register_modification_hooks(void)
+{
+	static hook_entry_t new_node;
+	static hook_entry_t set_irn_n;
+	static hook_entry_t replace;
+	static hook_entry_t turn_into_id;
+	new_node.hook._hook_new_node         = count_new_node;
+	set_irn_n.hook._hook_set_irn_n       = count_set_irn_n;
+	replace.hook._hook_replace           = count_replace;
+	turn_into_id.hook._hook_turn_into_id = count_turn_into_id;
+	register_hook(hook_new_node,     &new_node);
+	register_hook(hook_set_irn_n,    &set_irn_n);
+	register_hook(hook_replace,      &replace);
+	register_hook(hook_turn_into_id, &turn_into_id);
+}
+
+static char const *opt_profile_file; /**< see set_opt_profile_file() */
+static FILE       *opt_profile;
+static bool        opt_profile_empty;
+static ir_timer_t **t_profile;     /**< timer per nesting level of passes */
+static size_t       profile_depth;
+
+void set_opt_profile_file(char const *const filename)
+{
+	opt_profile_file = filename;
+}
+
+/**
+ * Starts timing a pass. Passes run from within other passes (like the
+ * cleanup after inlining) use their own timer, so the time of the enclosing
+ * pass keeps running.
+ */
+static ir_timer_t *enter_profile_timer(void)
+{
+	if (profile_depth == ARR_LEN(t_profile))
+		ARR_APP1(ir_timer_t*, t_profile, ir_timer_new());
+	ir_timer_t *const timer = t_profile[profile_depth++];
+	ir_timer_reset_and_start(timer);
+	return timer;
+}
+
+/** Stops timing a pass and returns its time in microseconds. */
+static unsigned long leave_profile_timer(ir_timer_t *const timer)
+{
+	ir_timer_stop(timer);
+	--profile_depth;
+	return ir_timer_elapsed_usec(timer);
+}
+
+static void count_node(ir_node *const node, void *const env)
+{
+	(void)node;
+	++*(unsigned*)env;
+}
+
+/** Counts the reachable nodes of a graph or of all graphs if irg is NULL. */
+static unsigned count_reachable_nodes(ir_graph *const irg)
+{
+	unsigned n_nodes = 0;
+	if (irg != NULL) {
+		irg_walk_graph(irg, count_node, NULL, &n_nodes);
+	} else {
+		for (size_t i = 0, n = get_irp_n_irgs(); i != n; ++i) {
+			irg_walk_graph(get_irp_irg(i), count_node, NULL, &n_nodes);
+		}
+	}
+	return n_nodes;
+}
+
+static bool open_opt_profile(void)
+{
+	if (opt_profile == NULL) {
+		opt_profile = fopen(opt_profile_file, "w");
+		if (opt_profile == NULL) {
+			position_t const pos = { opt_profile_file, 0, 0, 0 };
+			errorf(&pos, "could not open for writing: %s", strerror(errno));
+			opt_profile_file = NULL;
+			return false;
+		}
+		fputc('[', opt_profile);
+		opt_profile_empty = true;
+	}
+	return true;
+}
+
+/**
+ * Appends a pass invocation to the optimization profile, a JSON array with
+ * one object per invocation. Passes on the whole program have a null function
+ * and count the nodes of all graphs.
+ */
+static void profile_pass(opt_config_t const *const config,
+                         ir_graph *const irg, unsigned long const usec,
+                         unsigned const nodes_before,
+                         unsigned const nodes_after, bool const changed)
+{
+	if (!open_opt_profile())
+		return;
+
+	FILE *const out = opt_profile;
+	fputs(opt_profile_empty ? "\n  {\"function\": " : ",\n  {\"function\": ", out);
+	opt_profile_empty = false;
+	if (irg != NULL) {
+		fputc('"', out);
+		for (char const *c = get_entity_ld_name(get_irg_entity(irg)); *c != '\0'; ++c) {
+			if (*c == '"' || *c == '\\')
+				fputc('\\', out);
+			fputc(*c, out);
+		}
+		fputc('"', out);
+	} else {
+		fputs("null", out);
+	}
+	fprintf(out, ", \"pass\": \"%s\", \"usec\": %lu, \"nodes_before\": %u, \"nodes_after\": %u, \"changed\": %s}",
+	        config->name, usec, nodes_before, nodes_after,
+	        changed ? "true" : "false");
+}
+
+static void close_opt_profile(void)
+{
+	if (opt_profile_file != NULL && open_opt_profile()) {
+		fputs("\n]\n", opt_profile);
+		fclose(opt_profile);
+		opt_profile = NULL;
+	}
+}
+
 /**
  * perform an optimization on a single graph
  *
+ * A pass changed the graph, if it created or rewired nodes or dropped graph
+ * properties. Replacing the complete input array of a node is not reported
+ * by libfirm, such changes are only noticed through the properties.
+ *
  * @return  true if something changed, false otherwise
  */
-static bool do_irg_opt(ir_graph *irg, const char *name)
+static bool run_irg_opt(opt_config_t *const config, ir_graph *const irg)
 {
-	opt_config_t *const config = get_opt(name);
-	assert(config != NULL);
-	assert(config->target == OPT_TARGET_IRG);
-	if (! (config->flags & OPT_FLAG_ENABLED))
-		return false;
+	unsigned long        const modifications = irg_modifications;
+	ir_graph_properties_t const properties    = get_irg_properties(irg);
+	unsigned              const nodes_before
+		= opt_profile_file != NULL ? count_reachable_nodes(irg) : 0;
 
 	timer_start(config->timer);
+	ir_timer_t *const timer = enter_profile_timer();
 	config->u.transform_irg(irg);
+	unsigned long const usec = leave_profile_timer(timer);
 	timer_stop(config->timer);
 
-	after_transform(irg, name);
+	bool const changed = irg_modifications != modifications
+	    || (properties & ~get_irg_properties(irg)) != 0
+	    || (config->flags & OPT_FLAG_ANALYSIS);
+	if (opt_profile_file != NULL) {
+		profile_pass(config, irg, usec, nodes_before,
+		             count_reachable_nodes(irg), changed);
+	}
 
-	return true;
+	after_transform(irg, config->name);
+
+	return changed;
 }
 
-static void do_irp_opt(const char *name)
+static bool do_irg_opt(ir_graph *irg, const char *name)
+{
+	opt_config_t *const config = get_opt(name);
+	assert(config != NULL);
+	assert(config->target == OPT_TARGET_IRG);
+	if (! (config->flags & OPT_FLAG_ENABLED))
+		return false;
+	if ((config->flags & OPT_FLAG_EXPENSIVE) && is_over_budget(irg, 0))
+		return false;
+	return run_irg_opt(config, irg);
+}
+
+/**
+ * Runs a program pass if it is enabled.
+ *
+ * @return  true if the pass changed a graph or added or removed graphs
+ */
+static bool do_irp_opt(const char *name)
 {
 	opt_config_t *const config = get_opt(name);
 	assert(config->target == OPT_TARGET_IRP);
 	if (! (config->flags & OPT_FLAG_ENABLED))
-		return;
+		return false;
+
+	unsigned long const modifications = irg_modifications;
+	size_t        const n_irgs        = get_irp_n_irgs();
+	unsigned      const nodes_before
+		= opt_profile_file != NULL ? count_reachable_nodes(NULL) : 0;
 
 	timer_start(config->timer);
+	ir_timer_t *const timer = enter_profile_timer();
 	config->u.transform_irp();
+	unsigned long const usec = leave_profile_timer(timer);
 	timer_stop(config->timer);
 
+	bool const changed = irg_modifications != modifications
+	    || get_irp_n_irgs() != n_irgs;
+	if (opt_profile_file != NULL) {
+		profile_pass(config, NULL, usec, nodes_before, count_reachable_nodes(NULL),
+		             changed);
+	}
+
 	if (firm_dump.ir_graph && firm_dump.all_phases) {
 		for (size_t i = get_irp_n_irgs(); i-- > 0; ) {
 			ir_graph *irg = get_irp_irg(i);
@@ -471,6 +726,476 @@ static void do_irp_opt(const char *name)
 		}
 		timer_pop(t_verify);
 	}
+	return changed;
+}
+
+/**
+ * The optimization pipeline, given by a textual description:
+ *
+ *   pipeline := element { (',' | ';') element }
+ *   element  := primary [ '*' count ]
+ *   primary  := pass | pass '?' '(' pipeline ')' | '@' pass '(' pipeline ')'
+ *             | '(' pipeline ')'
+ *
+ * Consecutive graph passes separated by ',' are applied to one graph after
+ * the other, ';' finishes the current round over all graphs.
+ * "pass?(...)" runs the pass and then the group if the pass changed the
+ * graph (or any graph for a program pass), analyses count as a change,
+ * "@pass(...)" runs the group if the pass is enabled, without running it.
+ */
+typedef enum pipeline_kind_t {
+	PIPELINE_PASS,
+	PIPELINE_GROUP,
+	PIPELINE_IF_CHANGED,
+	PIPELINE_IF_ENABLED,
+} pipeline_kind_t;
+
+typedef struct pipeline_t pipeline_t;
+struct pipeline_t {
+	pipeline_kind_t  kind;
+	opt_config_t    *opt;     /**< the pass, or the condition of a group */
+	pipeline_t      *body;    /**< the elements of a group */
+	unsigned         repeat;  /**< number of times the element is run */
+	bool             barrier; /**< element is followed by ';' */
+	bool             per_irg; /**< contains graph passes only */
+	pipeline_t      *next;
+};
+
+static char const default_pipeline[] =
+	"remove-unused;"
+	/* first step: kill dead code */
+	"rts,combo,local,control-flow;"
+	"opt-tail-rec;"
+	"opt-func-call;"
+	"lower-const;"
+	/* 2nd round of unused function removal before we perform expensive
+	 * optimisations */
+	"remove-unused;"
+	"scalar-replace,invert-loops,unroll-loops,local,reassociation,local,gcse,"
+	"place,@confirm(control-flow,confirm,vrp,local),control-flow,"
+	"opt-load-store,lower,deconv,occults,thread-jumps,remove-confirms,gvn-pre,"
+	"gcse,place,control-flow,if-conversion?(local,control-flow),lower-mux,bool,"
+	"shape-blocks,ivopts,local,dead;"
+	"inline;"
+	"opt-proc-clone;"
+	"local,control-flow,thread-jumps,local,control-flow,"
+	"vrp?(local,vrp,local,vrp)";
+
+/** the -O level, graphs may override it, see set_irg_optimization_level() */
+static int            opt_level = 1;
+static pset_new_t     irgs_at_level[4];
+/** graphs whose pointer parameters do not alias */
+static pset_new_t     noalias_parameter_irgs;
+
+static pipeline_t    *pipeline;
+static char const    *pipeline_error;
+static unsigned long  n_pass_runs;  /**< graph passes run by the pipeline */
+static unsigned long  n_pass_skips; /**< graph passes skipped by the pipeline */
+static ir_timer_t    *t_expensive;  /**< measures expensive passes */
+static pset_new_t     over_budget;  /**< graphs exceeding the budget */
+
+/** Tracks the changes to a graph during a round of graph passes. */
+typedef struct irg_pass_state_t {
+	unsigned long version; /**< incremented whenever a pass changes the graph */
+	/** version + 1 of the graph after an idempotent pass ran */
+	unsigned long clean[ARRAY_SIZE(opts)];
+	unsigned long expensive_msec; /**< time spent in expensive passes */
+	int           level;          /**< optimization level of the graph */
+} irg_pass_state_t;
+
+void set_irg_optimization_level(ir_graph *const irg, unsigned const level)
+{
+	assert(level < ARRAY_SIZE(irgs_at_level));
+	pset_new_insert(&irgs_at_level[level], irg);
+}
+
+void set_irg_noalias_parameters(ir_graph *const irg)
+{
+	pset_new_insert(&noalias_parameter_irgs, irg);
+}
+
+int get_irg_optimization_level(ir_graph *const irg)
+{
+	for (size_t i = 0; i != ARRAY_SIZE(irgs_at_level); ++i) {
+		if (pset_new_contains(&irgs_at_level[i], irg))
+			return (int)i;
+	}
+	return -1;
+}
+
+static void free_pipeline(pipeline_t *element)
+{
+	while (element != NULL) {
+		pipeline_t *const next = element->next;
+		free_pipeline(element->body);
+		free(element);
+		element = next;
+	}
+}
+
+static pipeline_t *parse_pipeline(char const **pos);
+
+static opt_config_t *parse_pass_name(char const **const pos)
+{
+	char const *const begin = *pos;
+	char const       *end   = begin;
+	while (isalnum((unsigned char)*end) || *end == '-' || *end == '_')
+		++end;
+	if (end == begin) {
+		pipeline_error = "expected pass name";
+		return NULL;
+	}
+	*pos = end;
+
+	FOR_EACH_OPT(config) {
+		if (strncmp(config->name, begin, end - begin) == 0
+		 && config->name[end - begin] == '\0')
+			return config;
+	}
+	pipeline_error = "unknown pass";
+	return NULL;
+}
+
+static pipeline_t *parse_group(char const **const pos)
+{
+	if (**pos != '(') {
+		pipeline_error = "expected '('";
+		return NULL;
+	}
+	++*pos;
+	pipeline_t *const body = parse_pipeline(pos);
+	if (body == NULL)
+		return NULL;
+	if (**pos != ')') {
+		pipeline_error = "expected ')'";
+		free_pipeline(body);
+		return NULL;
+	}
+	++*pos;
+	return body;
+}
+
+static pipeline_t *parse_pipeline_element(char const **const pos)
+{
+	pipeline_t *const element = XMALLOCZ(pipeline_t);
+	element->repeat = 1;
+	if (**pos == '(') {
+		element->kind = PIPELINE_GROUP;
+		element->body = parse_group(pos);
+		if (element->body == NULL)
+			goto error;
+	} else if (**pos == '@') {
+		++*pos;
+		element->kind = PIPELINE_IF_ENABLED;
+		element->opt  = parse_pass_name(pos);
+		if (element->opt == NULL)
+			goto error;
+		element->body = parse_group(pos);
+		if (element->body == NULL)
+			goto error;
+	} else {
+		element->kind = PIPELINE_PASS;
+		element->opt  = parse_pass_name(pos);
+		if (element->opt == NULL)
+			goto error;
+		if (**pos == '?') {
+			++*pos;
+			element->kind = PIPELINE_IF_CHANGED;
+			element->body = parse_group(pos);
+			if (element->body == NULL)
+				goto error;
+		}
+	}
+
+	if (**pos == '*') {
+		++*pos;
+		char *end;
+		unsigned long const repeat = strtoul(*pos, &end, 10);
+		if (end == *pos || repeat == 0 || repeat > 1000) {
+			pipeline_error = "invalid repeat count";
+			goto error;
+		}
+		element->repeat = (unsigned)repeat;
+		*pos            = end;
+	}
+
+	/* graph passes can only be conditional on graph passes */
+	bool per_irg = element->opt == NULL
+	            || element->opt->target == OPT_TARGET_IRG;
+	for (pipeline_t const *e = element->body; e != NULL; e = e->next) {
+		per_irg &= e->per_irg;
+	}
+	if (element->kind == PIPELINE_IF_CHANGED && !per_irg
+	 && element->opt->target == OPT_TARGET_IRG) {
+		pipeline_error = "group depending on a graph pass contains a program pass";
+		goto error;
+	}
+	element->per_irg = per_irg;
+	return element;
+
+error:
+	free_pipeline(element);
+	return NULL;
+}
+
+static pipeline_t *parse_pipeline(char const **const pos)
+{
+	pipeline_t  *first  = NULL;
+	pipeline_t **anchor = &first;
+	for (;;) {
+		pipeline_t *const element = parse_pipeline_element(pos);
+		if (element == NULL) {
+			free_pipeline(first);
+			return NULL;
+		}
+		*anchor = element;
+		anchor  = &element->next;
+
+		if (**pos == ';') {
+			element->barrier = true;
+		} else if (**pos != ',') {
+			return first;
+		}
+		++*pos;
+	}
+}
+
+static bool set_pipeline(char const *const spec)
+{
+	char const *pos     = spec;
+	pipeline_t *const p = parse_pipeline(&pos);
+	if (p != NULL && *pos != '\0') {
+		pipeline_error = "unexpected character";
+		free_pipeline(p);
+	} else if (p != NULL) {
+		free_pipeline(pipeline);
+		pipeline = p;
+		return true;
+	}
+	errorf(NULL, "invalid optimization pipeline '%s' at '%s': %s", spec, pos,
+	       pipeline_error);
+	return false;
+}
+
+static void print_pipeline(FILE *const out, pipeline_t const *element)
+{
+	for (; element != NULL; element = element->next) {
+		switch (element->kind) {
+		case PIPELINE_PASS:
+			fputs(element->opt->name, out);
+			break;
+		case PIPELINE_GROUP:
+			fputc('(', out);
+			print_pipeline(out, element->body);
+			fputc(')', out);
+			break;
+		case PIPELINE_IF_CHANGED:
+			fprintf(out, "%s?(", element->opt->name);
+			print_pipeline(out, element->body);
+			fputc(')', out);
+			break;
+		case PIPELINE_IF_ENABLED:
+			fprintf(out, "@%s(", element->opt->name);
+			print_pipeline(out, element->body);
+			fputc(')', out);
+			break;
+		}
+		if (element->repeat != 1)
+			fprintf(out, "*%u", element->repeat);
+		if (element->next != NULL)
+			fputc(element->barrier ? ';' : ',', out);
+	}
+}
+
+static bool pipeline_contains(pipeline_t const *element,
+                              opt_config_t const *const config)
+{
+	for (; element != NULL; element = element->next) {
+		if (element->opt == config || pipeline_contains(element->body, config))
+			return true;
+	}
+	return false;
+}
+
+static bool is_opt_enabled(opt_config_t const *const config)
+{
+	return (config->flags & OPT_FLAG_ENABLED) != 0;
+}
+
+/**
+ * Checks whether a pass is enabled for a graph with its own optimization
+ * level. Passes belonging to both the global and the graph's level follow the
+ * command line switches, the others follow the graph's level.
+ */
+static bool is_opt_enabled_at(opt_config_t const *const config, int const level)
+{
+	if (level < 0 || level == opt_level)
+		return is_opt_enabled(config);
+	/* only enabled by an explicit switch */
+	if (config->level > 3)
+		return level > 0 && is_opt_enabled(config);
+	if (config->level <= MIN(level, opt_level))
+		return is_opt_enabled(config);
+	return config->level <= level;
+}
+
+/**
+ * Checks whether a graph exceeds the compile-time budget for expensive
+ * passes. Either the graph is too large or the expensive passes already took
+ * too long on it. Once a graph exceeds the budget, only cheap passes are run
+ * on it.
+ */
+static bool is_over_budget(ir_graph *const irg,
+                           unsigned long const expensive_msec)
+{
+	if (pset_new_contains(&over_budget, irg))
+		return true;
+
+	char     const *const name      = get_entity_ld_name(get_irg_entity(irg));
+	unsigned        const max_nodes = firm_opt.expensive_max_nodes;
+	unsigned        const max_msec  = firm_opt.expensive_max_msec;
+	unsigned        const n_nodes   = count_reachable_nodes(irg);
+	if (max_nodes != 0 && n_nodes > max_nodes) {
+		notef(NULL, "skipping expensive optimizations of '%s', it has %u nodes (limit %u)", name, n_nodes, max_nodes);
+	} else if (max_msec != 0 && expensive_msec > max_msec) {
+		notef(NULL, "skipping further expensive optimizations of '%s', they took more than %u ms", name, max_msec);
+	} else {
+		return false;
+	}
+	pset_new_insert(&over_budget, irg);
+	return true;
+}
+
+/**
+ * Runs a graph pass, unless it is idempotent and the graph did not change
+ * since the pass ran last, or it is expensive and the graph exceeds the
+ * compile-time budget.
+ *
+ * @return true if the pass changed the graph
+ */
+static bool run_pipeline_pass(opt_config_t *const config, ir_graph *const irg,
+                              irg_pass_state_t *const state)
+{
+	if (!is_opt_enabled_at(config, state->level))
+		return false;
+
+	size_t const idx        = config - opts;
+	bool   const idempotent = (config->flags & OPT_FLAG_IDEMPOTENT) != 0;
+	bool   const expensive  = (config->flags & OPT_FLAG_EXPENSIVE) != 0;
+	if ((idempotent && state->clean[idx] == state->version + 1)
+	 || (expensive && is_over_budget(irg, state->expensive_msec))) {
+		++n_pass_skips;
+		return false;
+	}
+
+	++n_pass_runs;
+	if (expensive)
+		ir_timer_reset_and_start(t_expensive);
+	bool const changed = run_irg_opt(config, irg);
+	if (expensive) {
+		ir_timer_stop(t_expensive);
+		state->expensive_msec += ir_timer_elapsed_msec(t_expensive);
+	}
+	if (changed)
+		++state->version;
+	if (idempotent)
+		state->clean[idx] = state->version + 1;
+	return changed;
+}
+
+static void run_pipeline_irg(pipeline_t const *const element, ir_graph *irg,
+                             irg_pass_state_t *state);
+
+static void run_pipeline_body_irg(pipeline_t const *element, ir_graph *irg,
+                                  irg_pass_state_t *const state)
+{
+	for (; element != NULL; element = element->next) {
+		run_pipeline_irg(element, irg, state);
+	}
+}
+
+/**
+ * Applies an element consisting of graph passes only to a graph.
+ */
+static void run_pipeline_irg(pipeline_t const *const element, ir_graph *irg,
+                             irg_pass_state_t *const state)
+{
+	assert(element->per_irg);
+	for (unsigned r = 0; r != element->repeat; ++r) {
+		switch (element->kind) {
+		case PIPELINE_PASS:
+			run_pipeline_pass(element->opt, irg, state);
+			break;
+		case PIPELINE_GROUP:
+			run_pipeline_body_irg(element->body, irg, state);
+			break;
+		case PIPELINE_IF_CHANGED:
+			if (run_pipeline_pass(element->opt, irg, state))
+				run_pipeline_body_irg(element->body, irg, state);
+			break;
+		case PIPELINE_IF_ENABLED:
+			if (is_opt_enabled_at(element->opt, state->level))
+				run_pipeline_body_irg(element->body, irg, state);
+			break;
+		}
+	}
+}
+
+static void run_pipeline(pipeline_t const *element);
+
+/**
+ * Runs an element containing program passes.
+ */
+static void run_pipeline_irp(pipeline_t const *const element)
+{
+	assert(!element->per_irg);
+	for (unsigned r = 0; r != element->repeat; ++r) {
+		switch (element->kind) {
+		case PIPELINE_PASS:
+			do_irp_opt(element->opt->name);
+			break;
+		case PIPELINE_GROUP:
+			run_pipeline(element->body);
+			break;
+		case PIPELINE_IF_CHANGED:
+			if (do_irp_opt(element->opt->name))
+				run_pipeline(element->body);
+			break;
+		case PIPELINE_IF_ENABLED:
+			if (is_opt_enabled(element->opt))
+				run_pipeline(element->body);
+			break;
+		}
+	}
+}
+
+static void run_pipeline(pipeline_t const *element)
+{
+	while (element != NULL) {
+		if (!element->per_irg) {
+			run_pipeline_irp(element);
+			element = element->next;
+			continue;
+		}
+
+		/* apply a round of graph passes to one graph after the other */
+		pipeline_t const *end = element;
+		while (end->per_irg && !end->barrier && end->next != NULL
+		    && end->next->per_irg)
+			end = end->next;
+		for (size_t i = 0; i < get_irp_n_irgs(); ++i) {
+			ir_graph *const  irg   = get_irp_irg(i);
+			irg_pass_state_t state;
+			memset(&state, 0, sizeof(state));
+			state.level = get_irg_optimization_level(irg);
+			for (pipeline_t const *e = element;; e = e->next) {
+				run_pipeline_irg(e, irg, &state);
+				if (e == end)
+					break;
+			}
+		}
+		element = end->next;
+	}
 }
 
 /**
@@ -506,6 +1231,30 @@ static void enable_safe_defaults(void)
 	set_opt_enabled("opt-cc", true);
 }
 
+/**
+ * Records the lowest optimization level enabling each pass for graphs with
+ * their own level. This must match enable_safe_defaults() and
+ * choose_optimization_pack().
+ */
+static void init_opt_levels(void)
+{
+	FOR_EACH_OPT(config) {
+		config->level = (config->flags & OPT_FLAG_ESSENTIAL) ? 0
+		              : is_opt_enabled(config)               ? 1
+		              :                                        4;
+	}
+	get_opt("occults")->level       = 2;
+	get_opt("memcombine")->level    = 2;
+	get_opt("bool")->level          = 3;
+	get_opt("thread-jumps")->level  = 3;
+	get_opt("if-conversion")->level = 3;
+
+	for (size_t i = 0; i != ARRAY_SIZE(irgs_at_level); ++i) {
+		pset_new_init(&irgs_at_level[i]);
+	}
+	pset_new_init(&noalias_parameter_irgs);
+}
+
 /**
  * run all the Firm optimizations
  */
@@ -520,105 +1269,46 @@ static void do_firm_optimizations(void)
 		aa_opt = aa_opt_no_alias;
 
 	set_irp_memory_disambiguator_options(aa_opt);
+	if (!(aa_opt & aa_opt_no_alias)) {
+		unsigned const noalias_parameters
+			= aa_opt | aa_opt_no_alias_args | aa_opt_no_alias_args_global;
+		for (size_t i = 0, n = get_irp_n_irgs(); i != n; ++i) {
+			ir_graph *const irg = get_irp_irg(i);
+			if (pset_new_contains(&noalias_parameter_irgs, irg))
+				set_irg_memory_disambiguator_options(irg, noalias_parameters);
+		}
+	}
 
 	/* parameter passing code should set them directly sometime... */
 	set_opt_enabled("confirm", firm_opt.confirm);
 	set_opt_enabled("remove-confirms", firm_opt.confirm);
 
-	/* first remove unused functions, to avoid spending unnecessary time
-	 * optimizing them */
-	do_irp_opt("remove-unused");
-
 	/* osr supersedes remove_phi_cycles */
 	if (get_opt_enabled("ivopts"))
 		set_opt_enabled("remove-phi-cycles", false);
 
-	/* first step: kill dead code */
-	for (size_t i = 0; i < get_irp_n_irgs(); i++) {
-		ir_graph *irg = get_irp_irg(i);
-		do_irg_opt(irg, "rts");
-		do_irg_opt(irg, "combo");
-		do_irg_opt(irg, "local");
-		do_irg_opt(irg, "control-flow");
+	if (pipeline == NULL) {
+		bool const ok = set_pipeline(default_pipeline);
+		(void)ok;
+		assert(ok);
 	}
-
-	for (size_t i = 0; i < get_irp_n_irgs(); ++i) {
-		ir_graph *irg = get_irp_irg(i);
-		do_irg_opt(irg, "opt-tail-rec");
+	if (firm_dump.passes) {
+		print_pipeline(stderr, pipeline);
+		fputc('\n', stderr);
 	}
-	do_irp_opt("opt-func-call");
-	do_irp_opt("lower-const");
+	run_pipeline(pipeline);
 
-	/* 2nd round of unused function removal before we perform expensive
-	 * optimisations */
-	do_irp_opt("remove-unused");
-
-	for (size_t i = 0; i < get_irp_n_irgs(); i++) {
-		ir_graph *irg = get_irp_irg(i);
-
-		do_irg_opt(irg, "scalar-replace");
-		do_irg_opt(irg, "invert-loops");
-		do_irg_opt(irg, "unroll-loops");
-		do_irg_opt(irg, "local");
-		do_irg_opt(irg, "reassociation");
-		do_irg_opt(irg, "local");
-		do_irg_opt(irg, "gcse");
-		do_irg_opt(irg, "place");
-
-		if (firm_opt.confirm) {
-			/* Confirm construction currently can only handle blocks with only
-			   one control flow predecessor. Calling optimize_cf here removes
-			   Bad predecessors and help the optimization of switch constructs.
-			 */
-			do_irg_opt(irg, "control-flow");
-			do_irg_opt(irg, "confirm");
-			do_irg_opt(irg, "vrp");
-			do_irg_opt(irg, "local");
-		}
-
-		do_irg_opt(irg, "control-flow");
-		do_irg_opt(irg, "opt-load-store");
-		do_irg_opt(irg, "lower");
-		do_irg_opt(irg, "deconv");
-		do_irg_opt(irg, "occults");
-		do_irg_opt(irg, "thread-jumps");
-		do_irg_opt(irg, "remove-confirms");
-		do_irg_opt(irg, "gvn-pre");
-		do_irg_opt(irg, "gcse");
-		do_irg_opt(irg, "place");
-		do_irg_opt(irg, "control-flow");
-
-		if (do_irg_opt(irg, "if-conversion")) {
-			do_irg_opt(irg, "local");
-			do_irg_opt(irg, "control-flow");
-		}
-		/* this doesn't make too much sense but tests the mux destruction... */
-		do_irg_opt(irg, "lower-mux");
+	/* the backend needs lowered constant code */
+	if (!pipeline_contains(pipeline, get_opt("lower-const")))
+		do_irp_opt("lower-const");
 
-		do_irg_opt(irg, "bool");
-		do_irg_opt(irg, "shape-blocks");
-		do_irg_opt(irg, "ivopts");
-		do_irg_opt(irg, "local");
-		do_irg_opt(irg, "dead");
+	if (firm_dump.passes) {
+		fprintf(stderr, "skipped %lu of %lu graph passes\n",
+		        n_pass_skips, n_pass_runs + n_pass_skips);
 	}
-
-	do_irp_opt("inline");
-	do_irp_opt("opt-proc-clone");
-
-	for (size_t i = 0; i < get_irp_n_irgs(); i++) {
-		ir_graph *irg = get_irp_irg(i);
-		do_irg_opt(irg, "local");
-		do_irg_opt(irg, "control-flow");
-		do_irg_opt(irg, "thread-jumps");
-		do_irg_opt(irg, "local");
-		do_irg_opt(irg, "control-flow");
-
-		if (do_irg_opt(irg, "vrp")) { // if vrp is enabled
-			do_irg_opt(irg, "local");
-			do_irg_opt(irg, "vrp");
-			do_irg_opt(irg, "local");
-			do_irg_opt(irg, "vrp");
-		}
+	if (stat_ev_enabled) {
+		stat_ev_int("opt_graph_passes_run", n_pass_runs);
+		stat_ev_int("opt_graph_passes_skipped", n_pass_skips);
 	}
 
 	if (firm_dump.ir_graph) {
@@ -693,17 +1383,51 @@ static void do_firm_lowering(void)
 	dump_all("low-opt");
 }
 
+static bool     be_debug_info;
+/** prefix of the labels, which are not visible outside the assembly file */
+static char const *be_private_prefix = ".L";
+static unsigned default_codegen_jobs = 1; /**< without -fcodegen-jobs */
+static bool     codegen_jobs_allowed = true;
+
 void set_be_option(char const *const arg)
 {
 	int res = be_parse_arg(arg);
-	if (!res)
-		panic("setting firm backend option '%s' failed (maybe an outdated version of firm is used)", arg);
+	if (!res) {
+		errorf(NULL, "setting firm backend option '%s' failed (maybe an outdated version of firm is used)", arg);
+		return;
+	}
+
+	char const *const debug = strstart(arg, "debug=");
+	if (debug != NULL)
+		be_debug_info = !streq(debug, "none");
+	char const *const format = strstart(arg, "objectformat=");
+	if (format != NULL)
+		be_private_prefix = streq(format, "mach-o") ? "L" : ".L";
 }
 
 void init_gen_firm(void)
 {
+	/* start from the defaults, the settings of a previous compilation are
+	 * still around when compiling several times in one process */
+	firm_opt = default_firm_opt;
+	memset(&firm_dump, 0, sizeof(firm_dump));
+	memset(rts_entities, 0, sizeof(rts_entities));
+	FOR_EACH_OPT(i) {
+		i->flags &= ~OPT_FLAG_ENABLED;
+	}
+	opt_level            = 1;
+	opt_profile_file     = NULL;
+	be_debug_info        = false;
+	be_private_prefix    = ".L";
+	default_codegen_jobs = 1;
+	codegen_jobs_allowed = true;
+	free_pipeline(pipeline);
+	pipeline = NULL;
+
 	ir_init();
 	enable_safe_defaults();
+	register_modification_hooks();
+	init_opt_levels();
 
 #ifdef NO_DEFAULT_VERIFY
 	set_be_option("verify=off");
@@ -721,6 +1445,8 @@ void init_gen_firm(void)
 	timer_register(t_all_opt, "Firm: all optimizations");
 	t_backend = ir_timer_new();
 	timer_register(t_backend, "Firm: backend");
+	t_expensive = ir_timer_new();
+	t_profile   = NEW_ARR_F(ir_timer_t*, 0);
 }
 
 void optimize_lower_ir_prog(void)
@@ -754,12 +1480,419 @@ void optimize_lower_ir_prog(void)
 		timer_pop(t_verify);
 	}
 
+	/* the budget also holds for the passes run directly after inlining and
+	 * during lowering */
+	pset_new_init(&over_budget);
 	do_firm_optimizations();
 	do_firm_lowering();
+	if (firm_dump.passes) {
+		fprintf(stderr, "%lu graphs exceeded the budget\n",
+		        (unsigned long)pset_new_size(&over_budget));
+	}
+	if (stat_ev_enabled)
+		stat_ev_int("opt_graphs_over_budget", pset_new_size(&over_budget));
+	pset_new_destroy(&over_budget);
 
 	timer_stop(t_all_opt);
 }
 
+static char *read_fragment(FILE *const file)
+{
+	if (fseek(file, 0, SEEK_END) != 0)
+		return NULL;
+	long const size = ftell(file);
+	if (size < 0)
+		return NULL;
+	rewind(file);
+	char *const text = XMALLOCN(char, size + 1);
+	if (fread(text, 1, size, file) != (size_t)size) {
+		free(text);
+		return NULL;
+	}
+	text[size] = '\0';
+	return text;
+}
+
+#ifdef HAVE_FORK
+typedef struct irg_size_t {
+	size_t size;
+	size_t index; /**< index of the graph in the irp */
+} irg_size_t;
+
+/** Orders graphs by decreasing size, equal sizes by index. */
+static int compare_irg_sizes(void const *const a, void const *const b)
+{
+	irg_size_t const *const size_a = (irg_size_t const*)a;
+	irg_size_t const *const size_b = (irg_size_t const*)b;
+	if (size_a->size != size_b->size)
+		return size_a->size < size_b->size ? 1 : -1;
+	return size_a->index < size_b->index ? -1 : size_a->index > size_b->index;
+}
+
+/**
+ * Distributes the graphs to @p n_jobs partitions of roughly equal size. The
+ * biggest graphs are placed first, each into the currently smallest
+ * partition.
+ *
+ * @return the partition of each graph, indexed like the irp graphs
+ */
+static unsigned *partition_irgs(unsigned const n_jobs)
+{
+	size_t      const n_irgs = get_irp_n_irgs();
+	irg_size_t *const sizes  = XMALLOCN(irg_size_t, n_irgs);
+	for (size_t i = 0; i != n_irgs; ++i) {
+		sizes[i] = (irg_size_t){ get_irg_last_idx(get_irp_irg(i)), i };
+	}
+	qsort(sizes, n_irgs, sizeof(*sizes), compare_irg_sizes);
+
+	unsigned *const owner = XMALLOCN(unsigned, n_irgs);
+	size_t   *const load  = XMALLOCNZ(size_t, n_jobs);
+	for (size_t i = 0; i != n_irgs; ++i) {
+		unsigned smallest = 0;
+		for (unsigned j = 1; j != n_jobs; ++j) {
+			if (load[j] < load[smallest])
+				smallest = j;
+		}
+		owner[sizes[i].index]  = smallest;
+		load[smallest]        += sizes[i].size;
+	}
+	free(load);
+	free(sizes);
+	return owner;
+}
+
+/**
+ * Restricts code generation to the share of partition @p job: Only the first
+ * partition emits variables, the other functions are not emitted.
+ */
+static void keep_partition(unsigned const job, unsigned const *const owner)
+{
+	for (size_t i = get_irp_n_irgs(); i-- > 0; ) {
+		if (owner[i] != job) {
+			ir_entity *const entity = get_irg_entity(get_irp_irg(i));
+			add_entity_linkage(entity, IR_LINKAGE_NO_CODEGEN);
+		}
+	}
+
+	if (job == 0)
+		return;
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = get_compound_n_members(segment); i-- > 0; ) {
+			ir_entity *const member = get_compound_member(segment, i);
+			if (!is_method_entity(member))
+				add_entity_linkage(member, IR_LINKAGE_NO_CODEGEN);
+		}
+	}
+}
+
+static bool is_symbol_start(char const c)
+{
+	return isalpha((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+static bool is_symbol_char(char const c)
+{
+	return is_symbol_start(c) || isdigit((unsigned char)c);
+}
+
+/**
+ * Records the private labels defined in an assembly fragment. Private labels,
+ * which are defined in more than one fragment, have been numbered by the
+ * backend after forking, and are added to @p duplicates. Other symbols are
+ * never renamed, a duplicate among them is left to the assembler to report.
+ */
+static void collect_labels(char const *text, pset_new_t *const defined,
+                           pset_new_t *const duplicates)
+{
+	while (*text != '\0') {
+		while (*text == ' ' || *text == '\t')
+			++text;
+		char const *const begin = text;
+		if (is_symbol_start(*text)) {
+			do {
+				++text;
+			} while (is_symbol_char(*text));
+			if (*text == ':' && strstart(begin, be_private_prefix) != NULL) {
+				ident *const id = new_id_from_chars(begin, text - begin);
+				if (!pset_new_insert(defined, id))
+					pset_new_insert(duplicates, id);
+			}
+		}
+		text = strchr(text, '\n');
+		if (text == NULL)
+			break;
+		++text;
+	}
+}
+
+/**
+ * Writes an assembly fragment and renames the labels in @p duplicates, so
+ * they are unique in the merged output.
+ */
+static void emit_fragment(FILE *const out, char const *text,
+                          unsigned const job, pset_new_t const *const duplicates)
+{
+	while (*text != '\0') {
+		char const *const begin = text;
+		if (*text == '"') {
+			/* do not touch string contents */
+			do {
+				if (*text == '\\' && text[1] != '\0')
+					++text;
+				++text;
+			} while (*text != '"' && *text != '\0');
+			if (*text == '"')
+				++text;
+			fwrite(begin, 1, text - begin, out);
+		} else if (is_symbol_start(*text)) {
+			do {
+				++text;
+			} while (is_symbol_char(*text));
+			int    const len = (int)(text - begin);
+			ident *const id  = new_id_from_chars(begin, len);
+			if (pset_new_contains(duplicates, id)) {
+				fprintf(out, "%.*s.p%u", len, begin, job);
+			} else {
+				fwrite(begin, 1, len, out);
+			}
+		} else if (is_symbol_char(*text)) {
+			/* numbers and numeric local labels */
+			do {
+				++text;
+			} while (is_symbol_char(*text));
+			fwrite(begin, 1, text - begin, out);
+		} else {
+			fputc(*text++, out);
+		}
+	}
+}
+
+/**
+ * Runs the backend in @p n_jobs forked processes, each generating code for a
+ * part of the graphs, and concatenates their output.
+ *
+ * @return false if a child failed, the caller should generate code serially
+ */
+static bool generate_code_parallel(FILE *const out,
+                                   char const *const input_filename,
+                                   unsigned const n_jobs)
+{
+	unsigned *const owner     = partition_irgs(n_jobs);
+	FILE    **const fragments = XMALLOCNZ(FILE*, n_jobs);
+	pid_t    *const children  = XMALLOCNZ(pid_t, n_jobs);
+	bool            ok        = true;
+
+	/* do not duplicate buffered output in the children */
+	fflush(NULL);
+	for (unsigned job = 0; job != n_jobs && ok; ++job) {
+		fragments[job] = tmpfile();
+		if (fragments[job] == NULL) {
+			ok = false;
+			break;
+		}
+
+		pid_t const pid = fork();
+		if (pid == 0) {
+			keep_partition(job, owner);
+			be_main(fragments[job], input_filename);
+			_exit(fflush(fragments[job]) != 0 || ferror(fragments[job]));
+		}
+		children[job] = pid;
+		ok            = pid > 0;
+	}
+
+	for (unsigned job = 0; job != n_jobs; ++job) {
+		int status;
+		if (children[job] > 0
+		 && (waitpid(children[job], &status, 0) != children[job]
+		  || !WIFEXITED(status) || WEXITSTATUS(status) != 0))
+			ok = false;
+	}
+
+	char **const texts = XMALLOCNZ(char*, n_jobs);
+	for (unsigned job = 0; job != n_jobs && ok; ++job) {
+		texts[job] = read_fragment(fragments[job]);
+		ok         = texts[job] != NULL;
+	}
+
+	if (ok) {
+		pset_new_t defined;
+		pset_new_t duplicates;
+		pset_new_init(&defined);
+		pset_new_init(&duplicates);
+		for (unsigned job = 0; job != n_jobs; ++job) {
+			collect_labels(texts[job], &defined, &duplicates);
+		}
+		for (unsigned job = 0; job != n_jobs; ++job) {
+			emit_fragment(out, texts[job], job, &duplicates);
+		}
+		pset_new_destroy(&duplicates);
+		pset_new_destroy(&defined);
+	}
+
+	for (unsigned job = 0; job != n_jobs; ++job) {
+		free(texts[job]);
+		if (fragments[job] != NULL)
+			fclose(fragments[job]);
+	}
+	free(texts);
+	free(children);
+	free(fragments);
+	free(owner);
+	return ok;
+}
+#endif
+
+void set_default_codegen_jobs(unsigned const n_jobs)
+{
+	default_codegen_jobs = n_jobs;
+}
+
+void disallow_codegen_jobs(void)
+{
+	codegen_jobs_allowed = false;
+}
+
+void set_profile_feedback(bool const generate, bool const use)
+{
+	firm_opt.profile_generate = generate;
+	firm_opt.profile_use      = use;
+}
+
+/** Percentage of the calls of the hottest callee making a callee hot. */
+#define PROFILE_HOT_PERCENT 1
+
+static void sum_block_execcount(ir_node *const block, void *const env)
+{
+	unsigned long *const executions = (unsigned long*)env;
+	*executions += ir_profile_get_block_execcount(block);
+}
+
+/**
+ * Adds the execution count of a direct call to the counter in the link of the
+ * callee.
+ */
+static void count_call(ir_node *const node, void *const env)
+{
+	(void)env;
+	if (!is_Call(node))
+		return;
+	ir_node *const ptr = get_Call_ptr(node);
+	if (!is_Address(ptr))
+		return;
+	ir_graph *const callee = get_entity_irg(get_Address_entity(ptr));
+	if (callee == NULL || callee == get_irn_irg(node))
+		return;
+	unsigned long *const calls = (unsigned long*)get_irg_link(callee);
+	*calls += ir_profile_get_block_execcount(get_nodes_block(node));
+}
+
+/**
+ * Uses the block execution counts of the training runs before optimizing:
+ * Functions never entered are not inlined and only get the basic
+ * optimizations, small functions called from hot call sites are always
+ * inlined.  Explicit inline attributes and optimization levels take
+ * precedence.
+ */
+static void apply_profile_feedback(void)
+{
+	size_t         const n_irgs = get_irp_n_irgs();
+	unsigned long *const calls  = XMALLOCNZ(unsigned long, n_irgs);
+	for (size_t i = 0; i != n_irgs; ++i) {
+		set_irg_link(get_irp_irg(i), &calls[i]);
+	}
+	for (size_t i = 0; i != n_irgs; ++i) {
+		irg_walk_graph(get_irp_irg(i), count_call, NULL, NULL);
+	}
+	unsigned long max_calls = 0;
+	for (size_t i = 0; i != n_irgs; ++i) {
+		max_calls = MAX(max_calls, calls[i]);
+	}
+
+	unsigned long n_cold = 0;
+	unsigned long n_hot  = 0;
+	for (size_t i = 0; i != n_irgs; ++i) {
+		ir_graph  *const irg    = get_irp_irg(i);
+		ir_entity *const entity = get_irg_entity(irg);
+		set_irg_link(irg, NULL);
+
+		mtp_additional_properties const props
+			= get_entity_additional_properties(entity);
+		if (props & (mtp_property_noinline | mtp_property_always_inline))
+			continue;
+
+		unsigned long executions = 0;
+		irg_block_walk_graph(irg, sum_block_execcount, NULL, &executions);
+		if (executions == 0) {
+			add_entity_additional_properties(entity, mtp_property_noinline);
+			if (opt_level > 1 && get_irg_optimization_level(irg) < 0)
+				set_irg_optimization_level(irg, 1);
+			++n_cold;
+		} else if (calls[i] != 0
+		        && calls[i] * 100 >= max_calls * PROFILE_HOT_PERCENT
+		        && get_irg_last_idx(irg) <= firm_opt.inline_maxsize / 4) {
+			add_entity_additional_properties(entity, mtp_property_always_inline);
+			++n_hot;
+		}
+	}
+	free(calls);
+
+	if (firm_dump.passes)
+		fprintf(stderr, "profile: %lu cold functions, %lu hot callees\n", n_cold, n_hot);
+	if (stat_ev_enabled) {
+		stat_ev_int("opt_profile_cold_graphs", n_cold);
+		stat_ev_int("opt_profile_hot_callees", n_hot);
+	}
+}
+
+/**
+ * Instruments the program or reads the counts of the training runs, before
+ * the optimizations change the graphs: Counts are matched to the blocks in
+ * graph walk order, so both must see the graphs as constructed.
+ */
+static void prepare_profile_feedback(char const *const input_filename)
+{
+	if (!firm_opt.profile_generate && !firm_opt.profile_use)
+		return;
+
+	size_t const len      = strlen(input_filename);
+	char  *const filename = XMALLOCN(char, len + sizeof(".irprof"));
+	memcpy(filename, input_filename, len);
+	memcpy(filename + len, ".irprof", sizeof(".irprof"));
+
+	if (firm_opt.profile_generate) {
+		ir_profile_instrument(filename);
+	} else if (ir_profile_read(filename)) {
+		apply_profile_feedback();
+		ir_profile_free();
+	} else {
+		position_t const pos = { input_filename, 0, 0, 0 };
+		warningf(WARN_OTHER, &pos, "no matching profile data in '%s', optimizing without", filename);
+	}
+	free(filename);
+}
+
+/**
+ * Generates code for the functions, which have not been found in the
+ * function cache, and adds the cached ones to the output.
+ */
+static void generate_code_cached(FILE *const out,
+                                 char const *const input_filename)
+{
+	FILE *const buffer = tmpfile();
+	if (buffer == NULL)
+		panic("cannot create temporary file: %s", strerror(errno));
+	function_cache_prepare_codegen();
+	be_main(buffer, input_filename);
+	char *const text = read_fragment(buffer);
+	fclose(buffer);
+	if (text == NULL)
+		panic("reading generated code failed");
+	function_cache_finish(out, text);
+	free(text);
+}
+
 /**
  * Called, after the Firm generation is completed,
  * do all optimizations and backend call here.
@@ -769,16 +1902,53 @@ void optimize_lower_ir_prog(void)
  */
 void generate_code(FILE *out, const char *input_filename)
 {
+	prepare_profile_feedback(input_filename);
+	bool const cache_functions = out != NULL && function_cache_active();
+	if (cache_functions)
+		function_cache_lookup();
 	optimize_lower_ir_prog();
 
 	/* run the code generator */
 	timer_start(t_backend);
+	if (cache_functions) {
+		generate_code_cached(out, input_filename);
+		timer_stop(t_backend);
+		return;
+	}
+#ifdef HAVE_FORK
+	/* debug info and global asm statements must only be emitted once */
+	unsigned const jobs   = firm_opt.codegen_jobs != 0 ? firm_opt.codegen_jobs
+	                                                   : default_codegen_jobs;
+	unsigned const n_jobs = MIN(jobs, get_irp_n_irgs());
+	if (n_jobs > 1 && codegen_jobs_allowed && out != NULL && !be_debug_info
+	 && get_irp_n_asms() == 0
+	 && generate_code_parallel(out, input_filename, n_jobs)) {
+		timer_stop(t_backend);
+		return;
+	}
+#endif
 	be_main(out, input_filename);
 	timer_stop(t_backend);
 }
 
 void exit_gen_firm(void)
 {
+	close_opt_profile();
+	for (size_t i = 0; i != ARRAY_SIZE(irgs_at_level); ++i) {
+		pset_new_destroy(&irgs_at_level[i]);
+	}
+	pset_new_destroy(&noalias_parameter_irgs);
+	if (rts_intrinsic_map != NULL) {
+		ir_free_intrinsics_map(rts_intrinsic_map);
+		rts_intrinsic_map = NULL;
+	}
+	free(irg_dump_no);
+	irg_dump_no = NULL;
+	ir_timer_free(t_expensive);
+	for (size_t i = 0, n = ARR_LEN(t_profile); i != n; ++i) {
+		ir_timer_free(t_profile[i]);
+	}
+	DEL_ARR_F(t_profile);
 	ir_finish();
 }
 
@@ -857,6 +2027,18 @@ int firm_option(const char *const opt)
 	} else if ((val = strstart(opt, "inline-threshold="))) {
 		sscanf(val, "%u", &firm_opt.inline_threshold);
 		return 1;
+	} else if ((val = strstart(opt, "passes="))) {
+		set_pipeline(val);
+		return 1;
+	} else if ((val = strstart(opt, "codegen-jobs="))) {
+		sscanf(val, "%u", &firm_opt.codegen_jobs);
+		return 1;
+	} else if ((val = strstart(opt, "expensive-max-nodes="))) {
+		sscanf(val, "%u", &firm_opt.expensive_max_nodes);
+		return 1;
+	} else if ((val = strstart(opt, "expensive-max-time="))) {
+		sscanf(val, "%u", &firm_opt.expensive_max_msec);
+		return 1;
 	} else if (streq(opt, "no-opt")) {
 		disable_all_opts();
 		return 1;
@@ -898,6 +2080,8 @@ bool firm_is_inlining_enabled(void)
 
 void choose_optimization_pack(int level)
 {
+	opt_level = MIN(level, 3);
+
 	/* apply optimization level */
 	switch (level) {
 	default:
@@ -133,6 +133,48 @@ void choose_optimization_pack(int level);
  */
 void init_implicit_optimizations(void);
 
+/** Passes an option to the backend, reports an error if it is rejected. */
 void set_be_option(char const *arg);
 
+/**
+ * Optimize a graph as if the -O switch was given with the level 0-3, e.g.
+ * because of attribute((optimize)).
+ */
+void set_irg_optimization_level(ir_graph *irg, unsigned level);
+
+/** @return the optimization level of a graph or -1 to use the global one */
+int get_irg_optimization_level(ir_graph *irg);
+
+/**
+ * Tell the memory disambiguator that the pointer parameters of a graph
+ * neither alias each other nor global variables, e.g. because all of them are
+ * restrict qualified.
+ */
+void set_irg_noalias_parameters(ir_graph *irg);
+
+/**
+ * Write a JSON profile of all optimization pass invocations to the given
+ * file, recording time, node counts and whether the pass changed the graph.
+ */
+void set_opt_profile_file(char const *filename);
+
+/**
+ * Instrument the program to count block executions into <input>.irprof, or
+ * use these counts from training runs to guide inlining and the optimization
+ * level of each function.
+ */
+void set_profile_feedback(bool generate, bool use);
+
+/**
+ * Set the number of processes running the backend, unless it is given by
+ * -fcodegen-jobs.
+ */
+void set_default_codegen_jobs(unsigned n_jobs);
+
+/**
+ * Generate code in this process even with -fcodegen-jobs, as forking is not
+ * safe in a multi-threaded program embedding the compiler.
+ */
+void disallow_codegen_jobs(void);
+
 #endif
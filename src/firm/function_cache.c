@@ -0,0 +1,753 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "driver/enable_posix.h"
+#include "function_cache.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <libfirm/firm.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_DIRENT
+#include <utime.h>
+#endif
+
+#include "adt/array.h"
+#include "adt/panic.h"
+#include "adt/pset_new.h"
+#include "adt/sha256.h"
+#include "adt/strutil.h"
+#include "adt/util.h"
+#include "adt/xmalloc.h"
+#include "driver/cache.h"
+#include "driver/target.h"
+#include "firm_opt.h"
+
+/** Depth up to which the types referenced by a type are hashed. */
+#define TYPE_HASH_DEPTH 3
+
+typedef struct function_record_t {
+	ir_graph   *irg;
+	ident      *name;            /**< ld name of the function */
+	char        source[65];      /**< hash of the printed AST */
+	char        body[65];        /**< hash of the AST and the graph */
+	char        fingerprint[65];
+	ir_entity **references;      /**< entities referenced by the graph */
+	ident     **privates;        /**< private entities the code may use */
+	char       *cached;          /**< cached assembly of a hit */
+	size_t      cached_len;
+	bool        hit;
+	bool        needed;          /**< a recompiled function may inline it */
+} function_record_t;
+
+typedef struct graph_env_t {
+	sha256_t    h;
+	ir_entity **references;
+} graph_env_t;
+
+typedef struct fingerprint_env_t {
+	sha256_t   h;
+	pset_new_t visited;
+	ident    **privates;
+	bool       complete; /**< all referenced graphs have been hashed */
+} fingerprint_env_t;
+
+static char const        *function_dir;
+static char const        *options_key;
+static function_record_t *records;
+/** Names of the functions not emitted after the lookup. */
+static pset_new_t         no_codegen;
+
+void function_cache_init(char const *const dir, char const *const key)
+{
+	function_dir = dir;
+	options_key  = key;
+	records      = NEW_ARR_F(function_record_t, 0);
+	/* the begin and end markers delimit the code of the functions */
+	set_be_option("verboseasm");
+}
+
+bool function_cache_active(void)
+{
+	return records != NULL;
+}
+
+void function_cache_record_source(ir_graph *const irg,
+                                  char const *const source, size_t const len)
+{
+	function_record_t record;
+	memset(&record, 0, sizeof(record));
+	record.irg = irg;
+	sha256_t h;
+	sha256_init(&h);
+	sha256_add(&h, source, len);
+	sha256_finish(&h, record.source);
+	ARR_APP1(function_record_t, records, record);
+}
+
+static void hash_number(sha256_t *const h, unsigned long long const number)
+{
+	sha256_add(h, &number, sizeof(number));
+}
+
+static void hash_tarval(sha256_t *const h, ir_tarval *const tv)
+{
+	char buf[128];
+	tarval_snprintf(buf, sizeof(buf), tv);
+	sha256_add_string(h, get_mode_name(get_tarval_mode(tv)));
+	sha256_add_string(h, buf);
+}
+
+static void hash_type(sha256_t *const h, ir_type *const type,
+                      unsigned const depth)
+{
+	hash_number(h, get_type_size(type));
+	hash_number(h, get_type_alignment(type));
+	if (is_Primitive_type(type)) {
+		sha256_add_string(h, get_mode_name(get_type_mode(type)));
+		return;
+	}
+	if (depth == 0)
+		return;
+
+	if (is_Pointer_type(type)) {
+		sha256_add_string(h, "pointer");
+		hash_type(h, get_pointer_points_to_type(type), depth - 1);
+	} else if (is_Array_type(type)) {
+		sha256_add_string(h, "array");
+		hash_type(h, get_array_element_type(type), depth - 1);
+	} else if (is_Method_type(type)) {
+		sha256_add_string(h, "method");
+		hash_number(h, get_method_calling_convention(type));
+		hash_number(h, get_method_additional_properties(type));
+		hash_number(h, is_method_variadic(type));
+		size_t const n_params = get_method_n_params(type);
+		hash_number(h, n_params);
+		for (size_t i = 0; i != n_params; ++i) {
+			hash_type(h, get_method_param_type(type, i), depth - 1);
+		}
+		size_t const n_ress = get_method_n_ress(type);
+		hash_number(h, n_ress);
+		for (size_t i = 0; i != n_ress; ++i) {
+			hash_type(h, get_method_res_type(type, i), depth - 1);
+		}
+	} else if (is_compound_type(type)) {
+		sha256_add_string(h, "compound");
+		size_t const n_members = get_compound_n_members(type);
+		hash_number(h, n_members);
+		for (size_t i = 0; i != n_members; ++i) {
+			ir_entity *const member = get_compound_member(type, i);
+			sha256_add_string(h, get_entity_name(member));
+			hash_number(h, get_entity_offset(member));
+			hash_number(h, get_entity_bitfield_offset(member));
+			hash_number(h, get_entity_bitfield_size(member));
+			hash_type(h, get_entity_type(member), depth - 1);
+		}
+	}
+}
+
+static void add_reference(graph_env_t *const env, ir_entity *const entity)
+{
+	sha256_add_string(&env->h, get_entity_ld_name(entity));
+	ARR_APP1(ir_entity*, env->references, entity);
+}
+
+static void hash_node(ir_node *const node, void *const data)
+{
+	graph_env_t *const env = (graph_env_t*)data;
+	sha256_t    *const h   = &env->h;
+	sha256_add_string(h, get_irn_opname(node));
+	sha256_add_string(h, get_mode_name(get_irn_mode(node)));
+	hash_number(h, get_irn_arity(node));
+	if (is_Const(node)) {
+		hash_tarval(h, get_Const_tarval(node));
+	} else if (is_Proj(node)) {
+		hash_number(h, get_Proj_num(node));
+	} else if (is_Cmp(node)) {
+		hash_number(h, get_Cmp_relation(node));
+	} else if (is_Address(node)) {
+		add_reference(env, get_Address_entity(node));
+	} else if (is_Member(node)) {
+		add_reference(env, get_Member_entity(node));
+	}
+}
+
+/**
+ * Hashes what only depends on the function itself: its AST, its frame and
+ * its graph as constructed. The graph catches values the AST does not show,
+ * like the size of a type.
+ */
+static void hash_graph(function_record_t *const record)
+{
+	ir_graph *const irg = record->irg;
+	graph_env_t     env;
+	sha256_init(&env.h);
+	sha256_add_string(&env.h, record->source);
+	hash_number(&env.h, get_irg_optimization_level(irg));
+	hash_type(&env.h, get_irg_frame_type(irg), TYPE_HASH_DEPTH);
+	env.references = NEW_ARR_F(ir_entity*, 0);
+	irg_walk_graph(irg, hash_node, NULL, &env);
+	sha256_finish(&env.h, record->body);
+	record->references = env.references;
+}
+
+static void hash_entity(fingerprint_env_t *env, ir_entity *entity);
+
+static void hash_initializer_node(fingerprint_env_t *const env,
+                                  ir_node *const node)
+{
+	sha256_t *const h = &env->h;
+	sha256_add_string(h, get_irn_opname(node));
+	sha256_add_string(h, get_mode_name(get_irn_mode(node)));
+	if (is_Const(node)) {
+		hash_tarval(h, get_Const_tarval(node));
+	} else if (is_Address(node)) {
+		hash_entity(env, get_Address_entity(node));
+	}
+	int const arity = get_irn_arity(node);
+	for (int i = 0; i < arity; ++i) {
+		hash_initializer_node(env, get_irn_n(node, i));
+	}
+}
+
+static void hash_initializer(fingerprint_env_t *const env,
+                             ir_initializer_t *const initializer)
+{
+	ir_initializer_kind_t const kind = get_initializer_kind(initializer);
+	hash_number(&env->h, kind);
+	switch (kind) {
+	case IR_INITIALIZER_CONST:
+		hash_initializer_node(env, get_initializer_const_value(initializer));
+		return;
+	case IR_INITIALIZER_TARVAL:
+		hash_tarval(&env->h, get_initializer_tarval_value(initializer));
+		return;
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_COMPOUND: {
+		size_t const n = get_initializer_compound_n_entries(initializer);
+		hash_number(&env->h, n);
+		for (size_t i = 0; i != n; ++i) {
+			hash_initializer(env, get_initializer_compound_value(initializer, i));
+		}
+		return;
+	}
+	}
+	panic("invalid initializer kind");
+}
+
+/**
+ * Hashes the declaration of @p entity and, the first time it is seen, its
+ * definition and everything referenced from there.
+ */
+static void hash_entity(fingerprint_env_t *const env, ir_entity *const entity)
+{
+	sha256_t *const h = &env->h;
+	sha256_add_string(h, get_entity_ld_name(entity));
+	if (!pset_new_insert(&env->visited, entity))
+		return;
+
+	ir_visibility const visibility = get_entity_visibility(entity);
+	hash_number(h, visibility);
+	hash_number(h, get_entity_linkage(entity));
+	hash_number(h, get_entity_alignment(entity));
+	hash_number(h, get_entity_volatility(entity));
+	hash_type(h, get_entity_type(entity), TYPE_HASH_DEPTH);
+	if (visibility == ir_visibility_private)
+		ARR_APP1(ident*, env->privates, get_entity_ld_ident(entity));
+
+	if (is_method_entity(entity)) {
+		hash_number(h, get_entity_additional_properties(entity));
+		ir_graph *const irg = get_entity_irg(entity);
+		if (irg == NULL)
+			return;
+		/* the definition of callees matters as they may be inlined */
+		function_record_t const *const record
+			= (function_record_t const*)get_irg_link(irg);
+		if (record == NULL) {
+			env->complete = false;
+			return;
+		}
+		sha256_add_string(h, record->body);
+		for (size_t i = 0, n = ARR_LEN(record->references); i != n; ++i) {
+			hash_entity(env, record->references[i]);
+		}
+	} else {
+		hash_number(h, get_entity_offset(entity));
+		if (get_entity_kind(entity) == IR_ENTITY_NORMAL) {
+			ir_initializer_t *const initializer
+				= get_entity_initializer(entity);
+			if (initializer != NULL)
+				hash_initializer(env, initializer);
+		}
+	}
+}
+
+static void compute_fingerprint(function_record_t *const record)
+{
+	/* whole program optimizations decide about local functions depending on
+	 * their callers, like giving them a custom calling convention */
+	ir_entity    *const entity     = get_irg_entity(record->irg);
+	ir_visibility const visibility = get_entity_visibility(entity);
+	if (visibility == ir_visibility_local
+	 || visibility == ir_visibility_private) {
+		record->fingerprint[0] = '\0';
+		record->privates       = NEW_ARR_F(ident*, 0);
+		return;
+	}
+
+	fingerprint_env_t env;
+	sha256_init(&env.h);
+	pset_new_init(&env.visited);
+	env.privates = NEW_ARR_F(ident*, 0);
+	env.complete = true;
+	sha256_add_string(&env.h, options_key);
+	hash_entity(&env, entity);
+	pset_new_destroy(&env.visited);
+	sha256_finish(&env.h, record->fingerprint);
+	record->privates = env.privates;
+	/* graphs created without an AST are not cached */
+	if (!env.complete)
+		record->fingerprint[0] = '\0';
+}
+
+static char *get_entry_name(function_record_t const *const record)
+{
+	char const *const fingerprint = record->fingerprint;
+	size_t      const len         = strlen(function_dir) + 72;
+	char       *const entry       = XMALLOCN(char, len);
+	snprintf(entry, len, "%s/%.2s/%s.fn.s", function_dir, fingerprint,
+	         fingerprint + 2);
+	return entry;
+}
+
+/**
+ * Keeps the optimizations of cached functions reachable from a recompiled
+ * function, so it inlines the same code as before.
+ */
+static void mark_needed(function_record_t *const record)
+{
+	for (size_t i = 0, n = ARR_LEN(record->references); i != n; ++i) {
+		ir_entity *const entity = record->references[i];
+		ir_graph  *const irg    = is_method_entity(entity)
+			? get_entity_irg(entity) : NULL;
+		if (irg == NULL)
+			continue;
+		function_record_t *const callee = (function_record_t*)get_irg_link(irg);
+		if (callee != NULL && callee->hit && !callee->needed) {
+			callee->needed = true;
+			mark_needed(callee);
+		}
+	}
+}
+
+/** Reads the cached code @p entry into @p record. */
+static bool read_entry(char const *const entry,
+                       function_record_t *const record)
+{
+	FILE *const in = fopen(entry, "rb");
+	if (in == NULL)
+		return false;
+
+	char  *text = NULL;
+	size_t len  = 0;
+	if (fseek(in, 0, SEEK_END) == 0) {
+		long const size = ftell(in);
+		rewind(in);
+		if (size > 0) {
+			text = XMALLOCN(char, size + 1);
+			len  = fread(text, 1, size, in);
+		}
+	}
+	fclose(in);
+	if (len == 0) {
+		free(text);
+		return false;
+	}
+	text[len]          = '\0';
+	record->cached     = text;
+	record->cached_len = len;
+	return true;
+}
+
+void function_cache_lookup(void)
+{
+	size_t const n_records = ARR_LEN(records);
+	for (size_t i = 0; i != n_records; ++i) {
+		function_record_t *const record = &records[i];
+		ir_entity         *const entity = get_irg_entity(record->irg);
+		set_irg_link(record->irg, record);
+		record->name = get_entity_ld_ident(entity);
+	}
+	for (size_t i = 0; i != n_records; ++i) {
+		hash_graph(&records[i]);
+	}
+
+	for (size_t i = 0; i != n_records; ++i) {
+		function_record_t *const record = &records[i];
+		compute_fingerprint(record);
+		if (record->fingerprint[0] == '\0')
+			continue;
+		char *const entry = get_entry_name(record);
+		/* read the code now, concurrent compilations may evict the entry */
+		if (read_entry(entry, record)) {
+			record->hit = true;
+#ifdef HAVE_DIRENT
+			/* mark as recently used */
+			utime(entry, NULL);
+#endif
+		}
+		free(entry);
+	}
+
+	for (size_t i = 0; i != n_records; ++i) {
+		if (!records[i].hit)
+			mark_needed(&records[i]);
+	}
+	for (size_t i = 0; i != n_records; ++i) {
+		function_record_t *const record = &records[i];
+		if (record->hit) {
+			add_entity_linkage(get_irg_entity(record->irg),
+			                   IR_LINKAGE_NO_CODEGEN);
+			if (!record->needed)
+				set_irg_optimization_level(record->irg, 0);
+		}
+		set_irg_link(record->irg, NULL);
+		/* graphs may be freed by the optimizations */
+		record->irg = NULL;
+	}
+
+	pset_new_init(&no_codegen);
+	for (size_t i = get_irp_n_irgs(); i-- != 0;) {
+		ir_entity *const entity = get_irg_entity(get_irp_irg(i));
+		if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
+			pset_new_insert(&no_codegen, get_entity_ld_ident(entity));
+	}
+}
+
+void function_cache_prepare_codegen(void)
+{
+	/* clones of cached functions inherit their linkage, but are called by
+	 * the generated code */
+	for (size_t i = get_irp_n_irgs(); i-- != 0;) {
+		ir_entity *const entity  = get_irg_entity(get_irp_irg(i));
+		ir_linkage const linkage = get_entity_linkage(entity);
+		if ((linkage & IR_LINKAGE_NO_CODEGEN)
+		 && !pset_new_contains(&no_codegen, get_entity_ld_ident(entity)))
+			set_entity_linkage(entity, linkage & ~IR_LINKAGE_NO_CODEGEN);
+	}
+}
+
+static bool is_symbol_start(char const c)
+{
+	return isalpha((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+static bool is_symbol_char(char const c)
+{
+	return is_symbol_start(c) || isdigit((unsigned char)c);
+}
+
+static char const *skip_string(char const *text, char const *const end)
+{
+	do {
+		if (*text == '\\' && text + 1 < end)
+			++text;
+		++text;
+	} while (text < end && *text != '"');
+	return text < end ? text + 1 : end;
+}
+
+/** Returns the name without the prefix of local labels or NULL. */
+static char const *get_local_label_name(char const *const symbol)
+{
+	if (symbol[0] == '.' && symbol[1] == 'L')
+		return symbol + 2;
+	if (target.object_format == OBJECT_FORMAT_MACH_O && symbol[0] == 'L')
+		return symbol + 1;
+	return NULL;
+}
+
+static bool is_private(function_record_t const *const record,
+                       char const *const name, size_t const len)
+{
+	ident *const id = new_id_from_chars(name, len);
+	for (size_t i = 0, n = ARR_LEN(record->privates); i != n; ++i) {
+		if (record->privates[i] == id)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Records the local labels defined in an assembly chunk. Private entities
+ * like the function itself keep their names.
+ */
+static void collect_local_labels(function_record_t const *const record,
+                                 char const *text, char const *const end,
+                                 pset_new_t *const defined)
+{
+	while (text < end) {
+		while (*text == ' ' || *text == '\t')
+			++text;
+		char const *const begin = text;
+		if (is_symbol_start(*text)) {
+			do {
+				++text;
+			} while (is_symbol_char(*text));
+			char const *const local = get_local_label_name(begin);
+			if (*text == ':' && local != NULL && local < text
+			 && !is_private(record, local, text - local))
+				pset_new_insert(defined, new_id_from_chars(begin, text - begin));
+		}
+		text = memchr(text, '\n', end - text);
+		if (text == NULL)
+			break;
+		++text;
+	}
+}
+
+/**
+ * Checks that an assembly chunk only uses local labels it defines itself or
+ * private entities covered by the fingerprint. Constants the backend creates
+ * are emitted outside of the function, so code using them is not cached.
+ */
+static bool is_self_contained(function_record_t const *const record,
+                              char const *text, char const *const end,
+                              pset_new_t *const defined)
+{
+	while (text < end) {
+		if (*text == '"') {
+			text = skip_string(text, end);
+		} else if (is_symbol_start(*text)) {
+			char const *const begin = text;
+			do {
+				++text;
+			} while (text < end && is_symbol_char(*text));
+			char const *const local = get_local_label_name(begin);
+			if (local != NULL && local < text
+			 && !pset_new_contains(defined, new_id_from_chars(begin, text - begin))
+			 && !is_private(record, local, text - local))
+				return false;
+		} else {
+			++text;
+		}
+	}
+	return true;
+}
+
+/**
+ * Writes an assembly chunk and appends @p suffix to its local labels, so
+ * they do not clash with the labels of the rest of the output.
+ */
+static void emit_chunk(FILE *const out, char const *text,
+                       char const *const end, pset_new_t *const defined,
+                       unsigned const suffix)
+{
+	while (text < end) {
+		char const *const begin = text;
+		if (*text == '"') {
+			text = skip_string(text, end);
+			fwrite(begin, 1, text - begin, out);
+		} else if (is_symbol_start(*text)) {
+			do {
+				++text;
+			} while (text < end && is_symbol_char(*text));
+			int    const len = (int)(text - begin);
+			ident *const id  = new_id_from_chars(begin, len);
+			if (pset_new_contains(defined, id)) {
+				fprintf(out, "%.*s.fc%u", len, begin, suffix);
+			} else {
+				fwrite(begin, 1, len, out);
+			}
+		} else if (is_symbol_char(*text)) {
+			do {
+				++text;
+			} while (text < end && is_symbol_char(*text));
+			fwrite(begin, 1, text - begin, out);
+		} else {
+			fputc(*text++, out);
+		}
+	}
+}
+
+static char const *const section_directives[] = {
+	".section", ".text", ".data", ".bss",
+};
+
+/**
+ * Returns whether the line switches the section. If the section cannot be
+ * told from the line alone, @p known is cleared.
+ */
+static bool is_section_directive(char const *line, bool *const known)
+{
+	while (*line == ' ' || *line == '\t')
+		++line;
+	char const *end = line;
+	while (is_symbol_char(*end))
+		++end;
+	size_t const len = end - line;
+	*known = true;
+	for (size_t i = 0; i != ARRAY_SIZE(section_directives); ++i) {
+		if (strlen(section_directives[i]) == len
+		 && memcmp(section_directives[i], line, len) == 0)
+			return true;
+	}
+	if ((len == 9 && memcmp(line, ".previous", len) == 0)
+	 || (len == 11 && memcmp(line, ".popsection", len) == 0)) {
+		*known = false;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Finds the record of the function named @p name, starting at @p cursor as
+ * the functions are emitted in the order they were constructed.
+ */
+static function_record_t *find_record(char const *const name, size_t const len,
+                                      size_t *const cursor)
+{
+	size_t const n_records = ARR_LEN(records);
+	for (size_t i = 0; i != n_records; ++i) {
+		size_t             const pos    = (*cursor + i) % n_records;
+		function_record_t *const record = &records[pos];
+		char const        *const ld     = get_id_str(record->name);
+		size_t             const ld_len = strlen(ld);
+		/* skip the prefixes of private and Mach-O symbols */
+		if (ld_len <= len && memcmp(name + len - ld_len, ld, ld_len) == 0
+		 && (ld_len == len || (ld_len + 1 == len && name[0] == '_')
+		  || (ld_len + 2 == len && name[0] == '.' && name[1] == 'L'))) {
+			*cursor = pos + 1;
+			return record;
+		}
+	}
+	return NULL;
+}
+
+static void store_chunk(function_record_t const *const record,
+                        char const *const section, size_t const section_len,
+                        char const *const chunk, size_t const len)
+{
+	pset_new_t defined;
+	pset_new_init(&defined);
+	collect_local_labels(record, chunk, chunk + len, &defined);
+	bool const cacheable = is_self_contained(record, chunk, chunk + len, &defined);
+	pset_new_destroy(&defined);
+	if (!cacheable)
+		return;
+
+	/* create the cache directory and the subdirectory of the entry */
+	char *const entry = get_entry_name(record);
+	char *const slash = strrchr(entry, '/');
+	*slash = '\0';
+	mkdir(function_dir, 0777);
+	mkdir(entry, 0777);
+	*slash = '/';
+
+	size_t const name_len  = strlen(entry) + 32;
+	char  *const temp_name = XMALLOCN(char, name_len);
+	snprintf(temp_name, name_len, "%s.tmp%ld", entry, (long)getpid());
+	FILE *const out = fopen(temp_name, "wb");
+	if (out != NULL) {
+		fwrite(section, 1, section_len, out);
+		fwrite(chunk, 1, len, out);
+		/* rename atomically so concurrent lookups never see partial files */
+		if (fclose(out) != 0 || rename(temp_name, entry) != 0) {
+			unlink(temp_name);
+		} else {
+			cache_add_size(section_len + len);
+		}
+	}
+	free(temp_name);
+	free(entry);
+}
+
+/**
+ * Stores the code of the compiled functions, which is found between the
+ * begin and end markers of verbose assembly, prefixed by its section.
+ */
+static void store_chunks(char const *const text)
+{
+	char const *section       = NULL;
+	size_t      section_len   = 0;
+	char const *chunk         = NULL;
+	char const *chunk_section = NULL;
+	size_t      chunk_sec_len = 0;
+	char const *name          = NULL;
+	size_t      name_len      = 0;
+	size_t      cursor        = 0;
+	for (char const *line = text; *line != '\0';) {
+		char const *const newline = strchr(line, '\n');
+		char const *const next    = newline != NULL ? newline + 1 : line + strlen(line);
+
+		bool        known;
+		char const *marker;
+		if (is_section_directive(line, &known)) {
+			section     = known ? line : NULL;
+			section_len = next - line;
+		} else if (chunk == NULL && (marker = strstart(line, "# -- Begin  ")) != NULL) {
+			chunk         = line;
+			chunk_section = section;
+			chunk_sec_len = section_len;
+			name          = marker;
+			name_len      = (newline != NULL ? newline : next) - marker;
+		} else if (chunk != NULL && (marker = strstart(line, "# -- End  ")) != NULL) {
+			size_t const len = (newline != NULL ? newline : next) - marker;
+			if (len == name_len && memcmp(marker, name, len) == 0) {
+				function_record_t *const record
+					= find_record(name, name_len, &cursor);
+				if (record != NULL && !record->hit
+				 && record->fingerprint[0] != '\0' && chunk_section != NULL)
+					store_chunk(record, chunk_section, chunk_sec_len, chunk, next - chunk);
+				chunk = NULL;
+			}
+		}
+		line = next;
+	}
+}
+
+static void splice_chunk(FILE *const out, function_record_t const *record,
+                         unsigned const suffix)
+{
+	char const *const text = record->cached;
+	size_t      const len  = record->cached_len;
+
+	pset_new_t defined;
+	pset_new_init(&defined);
+	collect_local_labels(record, text, text + len, &defined);
+	emit_chunk(out, text, text + len, &defined, suffix);
+	pset_new_destroy(&defined);
+}
+
+void function_cache_finish(FILE *const out, char const *const text)
+{
+	fputs(text, out);
+	store_chunks(text);
+
+	/* functions without callers may have been removed */
+	pset_new_t emitted;
+	pset_new_init(&emitted);
+	for (size_t i = get_irp_n_irgs(); i-- != 0;) {
+		ir_entity *const entity = get_irg_entity(get_irp_irg(i));
+		pset_new_insert(&emitted, get_entity_ld_ident(entity));
+	}
+	unsigned n_spliced = 0;
+	for (size_t i = 0, n = ARR_LEN(records); i != n; ++i) {
+		function_record_t const *const record = &records[i];
+		if (record->hit && pset_new_contains(&emitted, record->name))
+			splice_chunk(out, record, n_spliced++);
+	}
+	pset_new_destroy(&emitted);
+
+	for (size_t i = 0, n = ARR_LEN(records); i != n; ++i) {
+		DEL_ARR_F(records[i].references);
+		DEL_ARR_F(records[i].privates);
+		free(records[i].cached);
+	}
+	DEL_ARR_F(records);
+	records = NULL;
+	pset_new_destroy(&no_codegen);
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief cache of the generated code of single functions
+ *
+ * A function is fingerprinted by its AST, its graph as constructed and the
+ * declarations, types and initializers of everything it references,
+ * including the fingerprints of the functions it calls, as these may be
+ * inlined. Functions with a cached fingerprint are neither optimized nor
+ * emitted, instead their assembly from an earlier compilation is appended to
+ * the output. Local functions are not cached, as the whole program
+ * optimizations treat them depending on their callers.
+ */
+#ifndef FUNCTION_CACHE_H
+#define FUNCTION_CACHE_H
+
+#include <libfirm/firm_types.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Enables the cache with the entries in the directory @p dir, @p options_key
+ * identifies the compiler and the options. Must be called before the graphs
+ * are constructed.
+ */
+void function_cache_init(char const *dir, char const *options_key);
+
+/** Returns whether the cache is enabled. */
+bool function_cache_active(void);
+
+/** Remembers the printed AST of the function of @p irg. */
+void function_cache_record_source(ir_graph *irg, char const *source,
+                                  size_t len);
+
+/**
+ * Computes the fingerprints of all graphs and excludes functions found in
+ * the cache from optimization and code generation.
+ */
+void function_cache_lookup(void);
+
+/**
+ * Lets the optimizations' copies of cached functions, like the clones made
+ * by procedure cloning, be emitted. Call after optimization.
+ */
+void function_cache_prepare_codegen(void);
+
+/**
+ * Writes the assembly @p text generated for the program to @p out followed
+ * by the cached functions, and stores the newly generated functions.
+ */
+void function_cache_finish(FILE *out, char const *text);
+
+#endif
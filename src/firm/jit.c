@@ -0,0 +1,893 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2016 Matthias Braun <matze@braunis.de>
+ */
+#include "jit.h"
+
+#if defined(__APPLE__) || defined(__linux__)
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <libfirm/firm.h>
+#include <libfirm/jit.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "adt/array.h"
+#include "adt/sha256.h"
+#include "adt/strutil.h"
+#include "adt/util.h"
+#include "adt/xmalloc.h"
+#include "binary_ir.h"
+#include "driver/diagnostic.h"
+#include "driver/timing.h"
+#include "firm_opt.h"
+
+#define FUNCTION_ALIGNMENT 16
+#define CACHE_MAGIC        "cparser jit 1\n"
+#define CACHE_MAGIC_SIZE   (sizeof(CACHE_MAGIC) - 1)
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+/** Preferred address of the image, the cached code is only valid there. */
+#define IMAGE_BASE ((uintptr_t)0x3e0000000000ULL)
+#else
+#define IMAGE_BASE ((uintptr_t)0)
+#endif
+
+typedef struct symbol_t {
+	ident  *name;
+	size_t  offset;
+} symbol_t;
+
+/** A pointer in the global data, which is resolved when the image is
+ * loaded. */
+typedef struct relocation_t {
+	size_t   offset;  /**< in the data */
+	ident   *target;
+	uint64_t addend;
+	unsigned size;
+} relocation_t;
+
+typedef struct alias_t {
+	ident *name;
+	ident *target;
+} alias_t;
+
+typedef struct jit_t {
+	unsigned char *data;          /**< initial contents of the global data */
+	symbol_t      *data_symbols;  /**< offsets in the data */
+	relocation_t  *relocations;
+	alias_t       *aliases;
+	symbol_t      *functions;     /**< offsets in the image */
+	symbol_t      *slots;         /**< offsets in the image of the slots
+	                                   holding external addresses */
+	ir_entity    **slot_entities;
+	size_t         code_size;
+	size_t         data_offset;
+	size_t         image_size;
+	unsigned char *image;
+	bool           cacheable;
+} jit_t;
+
+typedef struct value_t {
+	ir_entity *entity;  /**< the value is relative to this symbol if set */
+	uint64_t   offset;
+} value_t;
+
+static char const *cache_dir;
+static char const *cache_key;
+
+void jit_set_cache(char const *const dir, char const *const options_key)
+{
+	cache_dir = dir;
+	cache_key = options_key;
+}
+
+static int compare_symbols(void const *const a, void const *const b)
+{
+	ident const *const name_a = ((symbol_t const*)a)->name;
+	ident const *const name_b = ((symbol_t const*)b)->name;
+	return name_a < name_b ? -1 : name_a > name_b;
+}
+
+static int compare_relocations(void const *const a, void const *const b)
+{
+	ident const *const target_a = ((relocation_t const*)a)->target;
+	ident const *const target_b = ((relocation_t const*)b)->target;
+	return target_a < target_b ? -1 : target_a > target_b;
+}
+
+static void sort_symbols(symbol_t *const symbols)
+{
+	qsort(symbols, ARR_LEN(symbols), sizeof(*symbols), compare_symbols);
+}
+
+static symbol_t const *find_symbol(symbol_t const *const symbols,
+                                   ident *const name)
+{
+	symbol_t const key = { name, 0 };
+	return (symbol_t const*)bsearch(&key, symbols, ARR_LEN(symbols),
+	                                sizeof(*symbols), compare_symbols);
+}
+
+static bool is_data_target(jit_t const *const jit, ident *const name)
+{
+	relocation_t const key = { 0, name, 0, 0 };
+	return bsearch(&key, jit->relocations, ARR_LEN(jit->relocations),
+	               sizeof(*jit->relocations), compare_relocations) != NULL;
+}
+
+/** Evaluates the constant expression @p node of an initializer. */
+static bool eval_const(ir_node *const node, value_t *const value)
+{
+	value_t left;
+	value_t right;
+	switch (get_irn_opcode(node)) {
+	case iro_Const: {
+		ir_tarval *const tv = get_Const_tarval(node);
+		if (!tarval_is_long(tv))
+			return false;
+		value->entity = NULL;
+		value->offset = (uint64_t)get_tarval_long(tv);
+		return true;
+	}
+	case iro_Address:
+		value->entity = get_Address_entity(node);
+		value->offset = 0;
+		return true;
+	case iro_Unknown:
+		value->entity = NULL;
+		value->offset = 0;
+		return true;
+	case iro_Conv:
+		return eval_const(get_Conv_op(node), value);
+	case iro_Add:
+		if (!eval_const(get_Add_left(node), &left)
+		 || !eval_const(get_Add_right(node), &right)
+		 || (left.entity != NULL && right.entity != NULL))
+			return false;
+		value->entity = left.entity != NULL ? left.entity : right.entity;
+		value->offset = left.offset + right.offset;
+		return true;
+	case iro_Sub:
+		if (!eval_const(get_Sub_left(node), &left)
+		 || !eval_const(get_Sub_right(node), &right)
+		 || (right.entity != NULL && right.entity != left.entity))
+			return false;
+		value->entity = right.entity != NULL ? NULL : left.entity;
+		value->offset = left.offset - right.offset;
+		return true;
+	case iro_Minus:
+		if (!eval_const(get_Minus_op(node), &left) || left.entity != NULL)
+			return false;
+		value->entity = NULL;
+		value->offset = -left.offset;
+		return true;
+	case iro_Mul:
+		if (!eval_const(get_Mul_left(node), &left)
+		 || !eval_const(get_Mul_right(node), &right)
+		 || left.entity != NULL || right.entity != NULL)
+			return false;
+		value->entity = NULL;
+		value->offset = left.offset * right.offset;
+		return true;
+	case iro_Member:
+		if (!eval_const(get_Member_ptr(node), value))
+			return false;
+		value->offset += get_entity_offset(get_Member_entity(node));
+		return true;
+	case iro_Sel: {
+		if (!eval_const(get_Sel_ptr(node), value)
+		 || !eval_const(get_Sel_index(node), &right) || right.entity != NULL)
+			return false;
+		ir_type *const element = get_array_element_type(get_Sel_type(node));
+		value->offset += right.offset * get_type_size(element);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+/* the backends supporting jit compilation are little endian */
+static void write_integer(unsigned char *const dest, uint64_t const value,
+                          unsigned const size)
+{
+	for (unsigned i = 0; i != size; ++i) {
+		dest[i] = (unsigned char)(value >> (8 * i));
+	}
+}
+
+static void write_tarval(jit_t *const jit, size_t const offset,
+                         ir_tarval *const tv)
+{
+	unsigned const size = get_mode_size_bytes(get_tarval_mode(tv));
+	for (unsigned i = 0; i != size; ++i) {
+		jit->data[offset + i] = get_tarval_sub_bits(tv, i);
+	}
+}
+
+static bool write_const(jit_t *const jit, size_t const offset,
+                        ir_node *const node)
+{
+	if (is_Const(node)) {
+		write_tarval(jit, offset, get_Const_tarval(node));
+		return true;
+	}
+	value_t value;
+	if (!eval_const(node, &value))
+		return false;
+	unsigned const size = get_mode_size_bytes(get_irn_mode(node));
+	if (value.entity != NULL) {
+		relocation_t const relocation = {
+			offset, get_entity_ld_ident(value.entity), value.offset, size
+		};
+		ARR_APP1(relocation_t, jit->relocations, relocation);
+	} else {
+		write_integer(jit->data + offset, value.offset, size);
+	}
+	return true;
+}
+
+static bool write_bitfield(jit_t *const jit, size_t const offset,
+                           ir_entity *const member,
+                           ir_initializer_t *const initializer)
+{
+	value_t value = { NULL, 0 };
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		return true;
+	case IR_INITIALIZER_TARVAL: {
+		ir_tarval *const tv = get_initializer_tarval_value(initializer);
+		if (!tarval_is_long(tv))
+			return false;
+		value.offset = (uint64_t)get_tarval_long(tv);
+		break;
+	}
+	case IR_INITIALIZER_CONST:
+		if (!eval_const(get_initializer_const_value(initializer), &value)
+		 || value.entity != NULL)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	unsigned const bit_offset = get_entity_bitfield_offset(member);
+	unsigned const bit_size   = get_entity_bitfield_size(member);
+	for (unsigned i = 0; i != bit_size && i != 64; ++i) {
+		if (!(value.offset >> i & 1))
+			continue;
+		unsigned const bit = bit_offset + i;
+		jit->data[offset + bit / 8] |= (unsigned char)(1u << (bit % 8));
+	}
+	return true;
+}
+
+static bool write_initializer(jit_t *const jit, size_t const offset,
+                              ir_type *const type,
+                              ir_initializer_t *const initializer)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		/* the data starts zeroed */
+		return true;
+	case IR_INITIALIZER_TARVAL:
+		write_tarval(jit, offset, get_initializer_tarval_value(initializer));
+		return true;
+	case IR_INITIALIZER_CONST:
+		return write_const(jit, offset,
+		                   get_initializer_const_value(initializer));
+	case IR_INITIALIZER_COMPOUND: {
+		size_t const n = get_initializer_compound_n_entries(initializer);
+		if (is_Array_type(type)) {
+			ir_type *const element = get_array_element_type(type);
+			size_t   const size    = get_type_size(element);
+			for (size_t i = 0; i != n; ++i) {
+				ir_initializer_t *const value
+					= get_initializer_compound_value(initializer, i);
+				if (!write_initializer(jit, offset + i * size, element, value))
+					return false;
+			}
+			return true;
+		}
+		if (!is_compound_type(type) || n > get_compound_n_members(type))
+			return false;
+		for (size_t i = 0; i != n; ++i) {
+			ir_entity        *const member = get_compound_member(type, i);
+			ir_initializer_t *const value
+				= get_initializer_compound_value(initializer, i);
+			size_t const member_offset = offset + get_entity_offset(member);
+			bool   const ok            = get_entity_bitfield_size(member) != 0
+				? write_bitfield(jit, member_offset, member, value)
+				: write_initializer(jit, member_offset, get_entity_type(member),
+				                    value);
+			if (!ok)
+				return false;
+		}
+		return true;
+	}
+	}
+	return false;
+}
+
+/** Allocates @p entity in the global data and writes its initializer. */
+static bool add_data(jit_t *const jit, ir_entity *const entity)
+{
+	ir_type *const type      = get_entity_type(entity);
+	unsigned const alignment = MAX(MAX(get_entity_alignment(entity),
+	                                   get_type_alignment(type)), 1u);
+	size_t   const offset    = (ARR_LEN(jit->data) + alignment - 1)
+	                         / alignment * alignment;
+	size_t   const end       = offset + get_type_size(type);
+	size_t   const old_size  = ARR_LEN(jit->data);
+	ARR_RESIZE(unsigned char, jit->data, end);
+	memset(jit->data + old_size, 0, end - old_size);
+
+	symbol_t const symbol = { get_entity_ld_ident(entity), offset };
+	ARR_APP1(symbol_t, jit->data_symbols, symbol);
+
+	ir_initializer_t *const initializer = get_entity_initializer(entity);
+	if (initializer != NULL
+	 && !write_initializer(jit, offset, type, initializer)) {
+		errorf(NULL, "cannot initialize '%s' in memory",
+		       get_entity_ld_name(entity));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Lays out the global data of the program. This happens before the
+ * optimizations, so it is the same whether the code is generated or taken
+ * from the cache.
+ */
+static bool layout_data(jit_t *const jit)
+{
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			ir_entity *const entity = get_compound_member(segment, i);
+			if (!entity_has_definition(entity))
+				continue;
+			if (get_entity_kind(entity) == IR_ENTITY_ALIAS) {
+				alias_t const alias = {
+					get_entity_ld_ident(entity),
+					get_entity_ld_ident(get_entity_alias(entity))
+				};
+				ARR_APP1(alias_t, jit->aliases, alias);
+				continue;
+			}
+			if (is_method_entity(entity))
+				continue;
+			if (s == IR_SEGMENT_THREAD_LOCAL) {
+				errorf(NULL, "thread-local variable '%s' is not supported in memory",
+				       get_entity_ld_name(entity));
+				return false;
+			}
+			if (!add_data(jit, entity))
+				return false;
+		}
+	}
+	sort_symbols(jit->data_symbols);
+	qsort(jit->relocations, ARR_LEN(jit->relocations),
+	      sizeof(*jit->relocations), compare_relocations);
+	return true;
+}
+
+static void collect_external_address(ir_node *const node, void *const env)
+{
+	ir_node ***const addresses = (ir_node***)env;
+	if (is_Address(node) && !entity_has_definition(get_Address_entity(node)))
+		ARR_APP1(ir_node*, *addresses, node);
+}
+
+static void clear_entity_links(void)
+{
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			set_entity_link(get_compound_member(segment, i), NULL);
+		}
+	}
+}
+
+/**
+ * Makes the code load the addresses of external symbols from slots in the
+ * image, so it does not depend on where the libraries are loaded.
+ */
+static void add_slots(jit_t *const jit)
+{
+	ir_node **addresses = NEW_ARR_F(ir_node*, 0);
+	for (size_t i = 0, n = get_irp_n_irgs(); i != n; ++i) {
+		irg_walk_graph(get_irp_irg(i), NULL, collect_external_address,
+		               &addresses);
+	}
+
+	clear_entity_links();
+	ir_type *const global_type = get_glob_type();
+	for (size_t i = 0, n = ARR_LEN(addresses); i != n; ++i) {
+		ir_node   *const node   = addresses[i];
+		ir_entity *const entity = get_Address_entity(node);
+		ir_entity *slot         = (ir_entity*)get_entity_link(entity);
+		if (slot == NULL) {
+			ir_type *const type = new_type_pointer(get_entity_type(entity));
+			slot = new_global_entity(global_type, id_unique("jit.slot.%u"),
+			                         type, ir_visibility_external,
+			                         IR_LINKAGE_DEFAULT);
+			set_entity_link(entity, slot);
+			symbol_t const symbol = { get_entity_ld_ident(entity), 0 };
+			ARR_APP1(symbol_t, jit->slots, symbol);
+			ARR_APP1(ir_entity*, jit->slot_entities, slot);
+		}
+
+		ir_graph *const irg  = get_irn_irg(node);
+		ir_mode  *const mode = get_irn_mode(node);
+		ir_node  *const addr = new_r_Address(irg, slot);
+		ir_node  *const load = new_r_Load(get_nodes_block(node),
+		                                  get_irg_no_mem(irg), addr, mode,
+		                                  get_entity_type(slot), cons_floats);
+		exchange(node, new_r_Proj(load, mode, pn_Load_res));
+	}
+	clear_entity_links();
+	DEL_ARR_F(addresses);
+}
+
+static bool is_slot(jit_t const *const jit, ir_entity *const entity)
+{
+	ident *const name = get_entity_ld_ident(entity);
+	for (size_t i = 0, n = ARR_LEN(jit->slots); i != n; ++i) {
+		if (jit->slots[i].name == name || jit->slot_entities[i] == entity)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Allocates the data the lowering created. Its layout cannot be
+ * reproduced without generating code, so the code is not cached then.
+ */
+static bool add_late_data(jit_t *const jit)
+{
+	ir_type *const global_type = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(global_type); i != n; ++i) {
+		ir_entity *const entity = get_compound_member(global_type, i);
+		ident     *const name   = get_entity_ld_ident(entity);
+		if (is_method_entity(entity)
+		 || get_entity_kind(entity) == IR_ENTITY_ALIAS
+		 || find_symbol(jit->data_symbols, name) != NULL
+		 || is_slot(jit, entity))
+			continue;
+		if (!entity_has_definition(entity)) {
+			/* the code may refer to it directly */
+			if (!is_data_target(jit, name))
+				jit->cacheable = false;
+			continue;
+		}
+		jit->cacheable = false;
+		if (!add_data(jit, entity))
+			return false;
+		sort_symbols(jit->data_symbols);
+	}
+	return true;
+}
+
+static void *resolve(jit_t const *const jit, ident *const name)
+{
+	symbol_t const *symbol = find_symbol(jit->functions, name);
+	if (symbol != NULL)
+		return jit->image + symbol->offset;
+	symbol = find_symbol(jit->data_symbols, name);
+	if (symbol != NULL)
+		return jit->image + jit->data_offset + symbol->offset;
+	for (size_t i = 0, n = ARR_LEN(jit->aliases); i != n; ++i) {
+		if (jit->aliases[i].name == name)
+			return resolve(jit, jit->aliases[i].target);
+	}
+
+	char const *const string  = get_id_str(name);
+	void             *address = dlsym(RTLD_DEFAULT, string);
+	/* Mach-O prefixes C names with an underscore */
+	if (address == NULL && string[0] == '_')
+		address = dlsym(RTLD_DEFAULT, string + 1);
+	return address;
+}
+
+static size_t get_page_size(void)
+{
+	long const page_size = sysconf(_SC_PAGESIZE);
+	return page_size > 0 ? (size_t)page_size : 4096;
+}
+
+/** Places the data after the code and the slots after the data. */
+static void layout_image(jit_t *const jit)
+{
+	size_t const page_size = get_page_size();
+	jit->data_offset = (jit->code_size + page_size - 1) / page_size * page_size;
+	size_t const slot_size = sizeof(void*);
+	size_t       offset    = (jit->data_offset + ARR_LEN(jit->data)
+	                          + slot_size - 1) / slot_size * slot_size;
+	for (size_t i = 0, n = ARR_LEN(jit->slots); i != n; ++i) {
+		jit->slots[i].offset = offset;
+		offset += slot_size;
+	}
+	jit->image_size = offset;
+}
+
+static bool map_image(jit_t *const jit, uintptr_t const base)
+{
+	void *const memory = mmap((void*)base, jit->image_size,
+	                          PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON,
+	                          -1, 0);
+	if (memory == MAP_FAILED) {
+		errorf(NULL, "cannot allocate memory for the program");
+		return false;
+	}
+	jit->image = (unsigned char*)memory;
+	return true;
+}
+
+/** Generates the code into a new image. */
+static bool compile_program(jit_t *const jit)
+{
+	ir_timer_t *t_codegen = ir_timer_new();
+	timer_register(t_codegen, "Jit: Optimization and Codegeneration");
+	timer_start(t_codegen);
+
+	optimize_lower_ir_prog();
+	add_slots(jit);
+
+	ir_jit_segment_t   *const segment   = be_new_jit_segment();
+	ir_jit_function_t **      functions = NEW_ARR_F(ir_jit_function_t*, 0);
+	ir_entity         **      entities  = NEW_ARR_F(ir_entity*, 0);
+	bool                      ok        = true;
+	for (size_t i = 0, n = get_irp_n_irgs(); i != n; ++i) {
+		ir_graph          *const irg      = get_irp_irg(i);
+		ir_entity         *const entity   = get_irg_entity(irg);
+		ir_jit_function_t *const function = be_jit_compile(segment, irg);
+		if (function == NULL) {
+			errorf(NULL, "cannot compile '%s' in memory",
+			       get_entity_ld_name(entity));
+			ok = false;
+			break;
+		}
+		jit->code_size = (jit->code_size + FUNCTION_ALIGNMENT - 1)
+		               / FUNCTION_ALIGNMENT * FUNCTION_ALIGNMENT;
+		symbol_t const symbol = { get_entity_ld_ident(entity), jit->code_size };
+		ARR_APP1(symbol_t, jit->functions, symbol);
+		ARR_APP1(ir_jit_function_t*, functions, function);
+		ARR_APP1(ir_entity*, entities, entity);
+		jit->code_size += be_get_function_size(function);
+	}
+
+	ok = ok && add_late_data(jit);
+	if (ok) {
+		layout_image(jit);
+		ok = map_image(jit, IMAGE_BASE);
+	}
+	if (ok) {
+		size_t const n_functions = ARR_LEN(functions);
+		for (size_t i = 0; i != n_functions; ++i) {
+			be_jit_set_entity_addr(entities[i],
+			                       jit->image + jit->functions[i].offset);
+		}
+		for (size_t i = 0, n = ARR_LEN(jit->slots); i != n; ++i) {
+			be_jit_set_entity_addr(jit->slot_entities[i],
+			                       jit->image + jit->slots[i].offset);
+		}
+		ir_type *const global_type = get_glob_type();
+		for (size_t i = 0, n = get_compound_n_members(global_type); i != n;
+		     ++i) {
+			ir_entity *const entity = get_compound_member(global_type, i);
+			if (is_method_entity(entity) && entity_has_definition(entity))
+				continue;
+			void *const address = resolve(jit, get_entity_ld_ident(entity));
+			if (address != NULL)
+				be_jit_set_entity_addr(entity, address);
+		}
+		for (size_t i = 0; i != n_functions; ++i) {
+			be_emit_function((char*)jit->image + jit->functions[i].offset,
+			                 functions[i]);
+		}
+	}
+	be_destroy_jit_segment(segment);
+	DEL_ARR_F(entities);
+	DEL_ARR_F(functions);
+	sort_symbols(jit->functions);
+	timer_stop(t_codegen);
+	return ok;
+}
+
+/** Returns the name of the cache entry of the program or NULL. */
+static char *get_entry_name(void)
+{
+	if (cache_dir == NULL || cache_key == NULL)
+		return NULL;
+	char ir_hash[65];
+	if (!binary_ir_hash(ir_hash))
+		return NULL;
+	sha256_t h;
+	sha256_init(&h);
+	sha256_add_string(&h, cache_key);
+	sha256_add_string(&h, ir_hash);
+	char key[65];
+	sha256_finish(&h, key);
+
+	size_t const len   = strlen(cache_dir) + 72;
+	char  *const entry = XMALLOCN(char, len);
+	snprintf(entry, len, "%s/%.2s/%s.jit", cache_dir, key, key + 2);
+	return entry;
+}
+
+static void put_number(FILE *const out, uint64_t const number)
+{
+	unsigned char buf[8];
+	write_integer(buf, number, sizeof(buf));
+	fwrite(buf, 1, sizeof(buf), out);
+}
+
+static void put_symbols(FILE *const out, symbol_t const *const symbols)
+{
+	put_number(out, ARR_LEN(symbols));
+	for (size_t i = 0, n = ARR_LEN(symbols); i != n; ++i) {
+		char const *const name = get_id_str(symbols[i].name);
+		size_t      const len  = strlen(name);
+		put_number(out, len);
+		fwrite(name, 1, len, out);
+		put_number(out, symbols[i].offset);
+	}
+}
+
+static void store_code(jit_t const *const jit, char *const entry)
+{
+	/* create the cache directory and the subdirectory of the entry */
+	char *const slash = strrchr(entry, '/');
+	*slash = '\0';
+	mkdir(cache_dir, 0777);
+	mkdir(entry, 0777);
+	*slash = '/';
+
+	size_t const name_len  = strlen(entry) + 32;
+	char  *const temp_name = XMALLOCN(char, name_len);
+	snprintf(temp_name, name_len, "%s.tmp%ld", entry, (long)getpid());
+	FILE *const out = fopen(temp_name, "wb");
+	if (out != NULL) {
+		fwrite(CACHE_MAGIC, 1, CACHE_MAGIC_SIZE, out);
+		put_number(out, (uintptr_t)jit->image);
+		put_number(out, jit->code_size);
+		put_number(out, ARR_LEN(jit->data));
+		put_number(out, jit->image_size);
+		put_symbols(out, jit->functions);
+		put_symbols(out, jit->slots);
+		fwrite(jit->image, 1, jit->code_size, out);
+		/* rename atomically so concurrent lookups never see partial files */
+		if (ferror(out) || fclose(out) != 0 || rename(temp_name, entry) != 0)
+			unlink(temp_name);
+	}
+	free(temp_name);
+}
+
+static bool get_number(FILE *const in, uint64_t *const number)
+{
+	unsigned char buf[8];
+	if (fread(buf, 1, sizeof(buf), in) != sizeof(buf))
+		return false;
+	*number = 0;
+	for (unsigned i = 0; i != sizeof(buf); ++i) {
+		*number |= (uint64_t)buf[i] << (8 * i);
+	}
+	return true;
+}
+
+static bool get_symbols(FILE *const in, symbol_t **const symbols,
+                        size_t const limit)
+{
+	uint64_t n;
+	if (!get_number(in, &n))
+		return false;
+	char *name = NULL;
+	for (uint64_t i = 0; i != n; ++i) {
+		uint64_t len;
+		uint64_t offset;
+		if (!get_number(in, &len) || len == 0 || len > 4096)
+			break;
+		name = XREALLOC(name, char, len);
+		if (fread(name, 1, len, in) != len || !get_number(in, &offset)
+		 || offset >= limit)
+			break;
+		symbol_t const symbol = { new_id_from_chars(name, len), offset };
+		ARR_APP1(symbol_t, *symbols, symbol);
+	}
+	free(name);
+	return ARR_LEN(*symbols) == n;
+}
+
+/** Loads the code from the cache into a new image. */
+static bool load_code(jit_t *const jit, char const *const entry)
+{
+	FILE *const in = fopen(entry, "rb");
+	if (in == NULL)
+		return false;
+	char     magic[CACHE_MAGIC_SIZE];
+	uint64_t base;
+	uint64_t code_size;
+	uint64_t data_size;
+	uint64_t image_size;
+	bool ok = fread(magic, 1, sizeof(magic), in) == sizeof(magic)
+	       && memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0
+	       && get_number(in, &base) && get_number(in, &code_size)
+	       && get_number(in, &data_size) && get_number(in, &image_size)
+	       && data_size == ARR_LEN(jit->data) && code_size < image_size
+	       && base == (uintptr_t)base && image_size == (size_t)image_size
+	       && get_symbols(in, &jit->functions, code_size)
+	       && get_symbols(in, &jit->slots, image_size);
+	if (ok) {
+		jit->code_size  = code_size;
+		jit->image_size = image_size;
+		layout_image(jit);
+		ok = jit->image_size == image_size && map_image(jit, base);
+	}
+	if (ok && (uintptr_t)jit->image != base) {
+		/* the code is only valid at its address */
+		munmap(jit->image, jit->image_size);
+		jit->image = NULL;
+		ok = false;
+	}
+	if (ok && fread(jit->image, 1, code_size, in) != code_size) {
+		munmap(jit->image, jit->image_size);
+		jit->image = NULL;
+		ok = false;
+	}
+	fclose(in);
+
+	if (ok) {
+		/* mark as recently used */
+		utime(entry, NULL);
+		sort_symbols(jit->functions);
+	} else {
+		ARR_SHRINKLEN(jit->functions, 0);
+		ARR_SHRINKLEN(jit->slots, 0);
+	}
+	return ok;
+}
+
+/** Copies the data into the image and resolves the external symbols. */
+static bool finish_image(jit_t *const jit)
+{
+	unsigned char *const data = jit->image + jit->data_offset;
+	memcpy(data, jit->data, ARR_LEN(jit->data));
+
+	bool ok = true;
+	for (size_t i = 0, n = ARR_LEN(jit->relocations); i != n; ++i) {
+		relocation_t const *const relocation = &jit->relocations[i];
+		void               *const address    = resolve(jit, relocation->target);
+		if (address == NULL) {
+			errorf(NULL, "undefined reference to '%s'",
+			       get_id_str(relocation->target));
+			ok = false;
+			continue;
+		}
+		write_integer(data + relocation->offset,
+		              (uintptr_t)address + relocation->addend,
+		              relocation->size);
+	}
+	for (size_t i = 0, n = ARR_LEN(jit->slots); i != n; ++i) {
+		symbol_t const *const slot    = &jit->slots[i];
+		void           *const address = resolve(jit, slot->name);
+		if (address == NULL) {
+			errorf(NULL, "undefined reference to '%s'", get_id_str(slot->name));
+			ok = false;
+			continue;
+		}
+		memcpy(jit->image + slot->offset, &address, sizeof(address));
+	}
+
+	if (ok && mprotect(jit->image, jit->code_size, PROT_READ | PROT_EXEC) != 0) {
+		errorf(NULL, "cannot make the code of the program executable");
+		ok = false;
+	}
+	return ok;
+}
+
+/** Calls the functions the pointers in @p segment point to. */
+static void call_pointers(jit_t const *const jit, ir_segment_t const segment)
+{
+	ir_type *const type = get_segment_type(segment);
+	for (size_t i = 0, n = get_compound_n_members(type); i != n; ++i) {
+		ir_entity      *const entity = get_compound_member(type, i);
+		symbol_t const *const symbol
+			= find_symbol(jit->data_symbols, get_entity_ld_ident(entity));
+		if (symbol == NULL)
+			continue;
+		void *function;
+		memcpy(&function, jit->image + jit->data_offset + symbol->offset,
+		       sizeof(function));
+		((void (*)(void))(intptr_t)function)();
+	}
+}
+
+static symbol_t const *find_main(jit_t const *const jit)
+{
+	symbol_t const *const symbol
+		= find_symbol(jit->functions, new_id_from_str("main"));
+	return symbol != NULL ? symbol
+		: find_symbol(jit->functions, new_id_from_str("_main"));
+}
+
+bool jit_run(int const argc, char **const argv, int *const exit_code)
+{
+	jit_t jit;
+	memset(&jit, 0, sizeof(jit));
+	jit.data          = NEW_ARR_F(unsigned char, 0);
+	jit.data_symbols  = NEW_ARR_F(symbol_t, 0);
+	jit.relocations   = NEW_ARR_F(relocation_t, 0);
+	jit.aliases       = NEW_ARR_F(alias_t, 0);
+	jit.functions     = NEW_ARR_F(symbol_t, 0);
+	jit.slots         = NEW_ARR_F(symbol_t, 0);
+	jit.slot_entities = NEW_ARR_F(ir_entity*, 0);
+	jit.cacheable     = true;
+
+	/* the key is computed before the optimizations change the program */
+	char *const entry = get_entry_name();
+	bool        ok    = layout_data(&jit);
+	if (ok && (entry == NULL || !load_code(&jit, entry))) {
+		ok = compile_program(&jit);
+		if (ok && entry != NULL && jit.cacheable)
+			store_code(&jit, entry);
+	}
+	free(entry);
+	ok = ok && finish_image(&jit);
+
+	symbol_t const *const main_symbol = ok ? find_main(&jit) : NULL;
+	if (ok && main_symbol == NULL) {
+		errorf(NULL, "program has no main function");
+		ok = false;
+	}
+	if (ok) {
+		typedef int (*main_func)(int argc, char **argv);
+		main_func const main_ptr
+			= (main_func)(intptr_t)(jit.image + main_symbol->offset);
+		call_pointers(&jit, IR_SEGMENT_CONSTRUCTORS);
+		*exit_code = main_ptr(argc, argv);
+		call_pointers(&jit, IR_SEGMENT_DESTRUCTORS);
+	}
+
+	if (jit.image != NULL)
+		munmap(jit.image, jit.image_size);
+	DEL_ARR_F(jit.slot_entities);
+	DEL_ARR_F(jit.slots);
+	DEL_ARR_F(jit.functions);
+	DEL_ARR_F(jit.aliases);
+	DEL_ARR_F(jit.relocations);
+	DEL_ARR_F(jit.data_symbols);
+	DEL_ARR_F(jit.data);
+	return ok;
+}
+
+#else
+
+#include "driver/diagnostic.h"
+
+void jit_set_cache(char const *const dir, char const *const options_key)
+{
+	(void)dir;
+	(void)options_key;
+}
+
+/* We don't know how to allocate executable memory on this system */
+bool jit_run(int const argc, char **const argv, int *const exit_code)
+{
+	(void)argc;
+	(void)argv;
+	(void)exit_code;
+	errorf(NULL, "running programs in memory is not supported on this system");
+	return false;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2016 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief running programs in memory
+ *
+ * The functions are compiled into executable memory together with the
+ * global data of the program. Code refers to symbols of the libraries
+ * through slots filled at load time, so it only depends on the address of
+ * its image and can be taken from a cache keyed by a hash of the IR.
+ */
+#ifndef FIRM_JIT_H
+#define FIRM_JIT_H
+
+#include <stdbool.h>
+
+/**
+ * Caches generated code in @p dir, @p options_key is a hash of the options
+ * influencing code generation.
+ */
+void jit_set_cache(char const *dir, char const *options_key);
+
+/**
+ * Compiles the program and calls its main function with @p argc and
+ * @p argv. Returns false if the program cannot be run, otherwise stores
+ * the return value of main in @p exit_code.
+ */
+bool jit_run(int argc, char **argv, int *exit_code);
+
+#endif
@@ -1,10 +0,0 @@
-/*
- * This file is part of cparser.
- * Copyright (C) 2016 Matthias Braun <matze@braunis.de>
- */
-#ifndef FIRM_JITTEST_H
-#define FIRM_JITTEST_H
-
-void jit_compile_execute_main(void);
-
-#endif
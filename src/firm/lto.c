@@ -0,0 +1,308 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "lto.h"
+
+#include <libfirm/firm.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adt/array.h"
+#include "adt/pset_new.h"
+#include "adt/strutil.h"
+#include "binary_ir.h"
+#include "driver/diagnostic.h"
+
+#define LTO_MAGIC "# cparser lto object\n"
+
+typedef struct symbol_t {
+	ident     *name;
+	ir_entity *entity;
+} symbol_t;
+
+static unsigned      n_objects;
+static bool         known_init;
+static pset_new_t   known;       /**< entities of the objects read so far */
+static binary_ir_t **lazy_files; /**< objects with unloaded function bodies */
+static pset_new_t   unloaded;    /**< functions of lazy_files */
+
+bool lto_write_object(FILE *const out)
+{
+	fputs(LTO_MAGIC, out);
+	if (!binary_ir_write(out))
+		ir_export_file(out);
+	return ferror(out) == 0;
+}
+
+bool lto_is_object(char const *const filename)
+{
+	FILE *const in = fopen(filename, "rb");
+	if (in == NULL)
+		return false;
+	char         magic[sizeof(LTO_MAGIC) - 1];
+	size_t const len = fread(magic, 1, sizeof(magic), in);
+	fclose(in);
+	return len == sizeof(magic) && memcmp(magic, LTO_MAGIC, len) == 0;
+}
+
+/**
+ * Renames the local entities, which are not known yet, as their names may
+ * clash with the ones of the other objects.
+ */
+static void rename_local_entities(bool const rename)
+{
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			ir_entity *const entity = get_compound_member(segment, i);
+			if (!pset_new_insert(&known, entity) || !rename)
+				continue;
+			ir_visibility const visibility = get_entity_visibility(entity);
+			if (visibility != ir_visibility_local
+			 && visibility != ir_visibility_private)
+				continue;
+			ident *const name = new_id_fmt("%s.lto%u",
+			                               get_entity_ld_name(entity), n_objects);
+			set_entity_ld_ident(entity, name);
+		}
+	}
+}
+
+bool lto_read_object(FILE *const in, char const *const filename)
+{
+	if (!known_init) {
+		/* keep the names of a translation unit compiled in this process */
+		pset_new_init(&known);
+		pset_new_init(&unloaded);
+		lazy_files = NEW_ARR_F(binary_ir_t*, 0);
+		known_init = true;
+		rename_local_entities(false);
+	}
+
+	char magic[sizeof(LTO_MAGIC) - 1];
+	if (fread(magic, 1, sizeof(magic), in) != sizeof(magic)
+	 || memcmp(magic, LTO_MAGIC, sizeof(magic)) != 0)
+		return false;
+	if (binary_ir_detect(in)) {
+		/* the bodies are constructed by lto_resolve(), once it is known
+		 * which definitions are kept */
+		binary_ir_t *const file = binary_ir_open(in, filename);
+		if (file == NULL)
+			return false;
+		for (size_t i = 0, n = binary_ir_n_functions(file); i != n; ++i) {
+			pset_new_insert(&unloaded, binary_ir_get_function(file, i));
+		}
+		ARR_APP1(binary_ir_t*, lazy_files, file);
+	} else if (ir_import_file(in, filename)) {
+		return false;
+	}
+	rename_local_entities(true);
+	++n_objects;
+	return true;
+}
+
+static int compare_symbols(void const *const a, void const *const b)
+{
+	ident const *const name_a = ((symbol_t const*)a)->name;
+	ident const *const name_b = ((symbol_t const*)b)->name;
+	return name_a < name_b ? -1 : name_a > name_b;
+}
+
+static bool is_weak(ir_entity const *const entity)
+{
+	return get_entity_linkage(entity) & (IR_LINKAGE_WEAK | IR_LINKAGE_MERGE);
+}
+
+/**
+ * Returns whether @p entity is defined like entity_has_definition() does,
+ * counting function bodies, which are not loaded yet.
+ */
+static bool has_definition(ir_entity *const entity)
+{
+	if (known_init && pset_new_contains(&unloaded, entity))
+		return !(get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN);
+	return entity_has_definition(entity);
+}
+
+static bool is_external(ir_entity const *const entity)
+{
+	ir_visibility const visibility = get_entity_visibility(entity);
+	return visibility != ir_visibility_local
+	    && visibility != ir_visibility_private;
+}
+
+/**
+ * Collects the externally visible definitions sorted by name. Of multiple
+ * definitions of a name only a strong one is kept, the others are not
+ * emitted.
+ */
+static symbol_t *collect_definitions(void)
+{
+	symbol_t *definitions = NEW_ARR_F(symbol_t, 0);
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			ir_entity *const entity = get_compound_member(segment, i);
+			set_entity_link(entity, NULL);
+			if (is_external(entity) && has_definition(entity)) {
+				symbol_t const symbol = { get_entity_ld_ident(entity), entity };
+				ARR_APP1(symbol_t, definitions, symbol);
+			}
+		}
+	}
+	size_t const n_definitions = ARR_LEN(definitions);
+	qsort(definitions, n_definitions, sizeof(*definitions), compare_symbols);
+
+	size_t n_unique = 0;
+	for (size_t i = 0; i != n_definitions; ++i) {
+		symbol_t *const symbol = &definitions[i];
+		if (n_unique == 0 || definitions[n_unique - 1].name != symbol->name) {
+			definitions[n_unique++] = *symbol;
+			continue;
+		}
+
+		symbol_t *const kept = &definitions[n_unique - 1];
+		if (!is_weak(symbol->entity) && !is_weak(kept->entity)) {
+			errorf(NULL, "multiple definitions of '%s'",
+			       get_id_str(symbol->name));
+			continue;
+		}
+		ir_entity *dropped = symbol->entity;
+		if (is_weak(kept->entity) && !is_weak(symbol->entity)) {
+			dropped      = kept->entity;
+			kept->entity = symbol->entity;
+		}
+		add_entity_linkage(dropped, IR_LINKAGE_NO_CODEGEN);
+	}
+	ARR_SHRINKLEN(definitions, n_unique);
+	return definitions;
+}
+
+static void replace_address(ir_node *const node, void *const env)
+{
+	(void)env;
+	if (!is_Address(node))
+		return;
+	ir_entity *const replacement
+		= (ir_entity*)get_entity_link(get_Address_entity(node));
+	if (replacement != NULL)
+		set_Address_entity(node, replacement);
+}
+
+static void replace_in_initializer(ir_initializer_t *const initializer)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_CONST:
+		irg_walk(get_initializer_const_value(initializer), replace_address,
+		         NULL, NULL);
+		return;
+	case IR_INITIALIZER_COMPOUND:
+		for (size_t i = 0, n = get_initializer_compound_n_entries(initializer);
+		     i != n; ++i) {
+			replace_in_initializer(get_initializer_compound_value(initializer, i));
+		}
+		return;
+	case IR_INITIALIZER_TARVAL:
+	case IR_INITIALIZER_NULL:
+		return;
+	}
+}
+
+/**
+ * Constructs the function bodies of the binary IR objects and closes them.
+ * The bodies of definitions, which were dropped in favour of another
+ * definition, are skipped. Returns false if a body is malformed.
+ */
+static bool load_functions(void)
+{
+	if (!known_init)
+		return true;
+	bool ok = true;
+	for (size_t f = 0, n_files = ARR_LEN(lazy_files); f != n_files; ++f) {
+		binary_ir_t *const file = lazy_files[f];
+		for (size_t i = 0, n = binary_ir_n_functions(file); i != n && ok; ++i) {
+			/* a dropped definition refers to the kept one */
+			if (get_entity_link(binary_ir_get_function(file, i)) != NULL)
+				continue;
+			ok = binary_ir_load_function(file, i) != NULL;
+		}
+		binary_ir_close(file);
+	}
+	ARR_SHRINKLEN(lazy_files, 0);
+	return ok;
+}
+
+bool lto_resolve(bool const whole_program)
+{
+	symbol_t *const definitions   = collect_definitions();
+	size_t    const n_definitions = ARR_LEN(definitions);
+
+	/* link declarations and dropped definitions to the kept definitions */
+	ir_entity **declarations = NEW_ARR_F(ir_entity*, 0);
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			ir_entity *const entity = get_compound_member(segment, i);
+			if (!is_external(entity))
+				continue;
+			symbol_t const  key    = { get_entity_ld_ident(entity), entity };
+			symbol_t const *symbol = (symbol_t const*)bsearch(&key,
+				definitions, n_definitions, sizeof(*definitions),
+				compare_symbols);
+			if (symbol == NULL || symbol->entity == entity)
+				continue;
+			set_entity_link(entity, symbol->entity);
+			if (!has_definition(entity))
+				ARR_APP1(ir_entity*, declarations, entity);
+		}
+	}
+	bool const ok = load_functions();
+
+	for (size_t i = get_irp_n_irgs(); i-- != 0;) {
+		irg_walk_graph(get_irp_irg(i), replace_address, NULL, NULL);
+	}
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			ir_entity *const entity = get_compound_member(segment, i);
+			if (is_method_entity(entity))
+				continue;
+			ir_initializer_t *const initializer = get_entity_initializer(entity);
+			if (initializer != NULL)
+				replace_in_initializer(initializer);
+		}
+	}
+
+	/* nothing refers to the declarations anymore */
+	for (size_t i = 0, n = ARR_LEN(declarations); i != n; ++i) {
+		free_entity(declarations[i]);
+	}
+	DEL_ARR_F(declarations);
+
+	if (whole_program) {
+		/* let the optimizations see all calls of the functions */
+		for (size_t i = 0; i != n_definitions; ++i) {
+			ir_entity *const entity = definitions[i].entity;
+			if (is_method_entity(entity) && !is_weak(entity)
+			 && !(get_entity_linkage(entity) & IR_LINKAGE_HIDDEN_USER)
+			 && !streq(get_entity_name(entity), "main"))
+				set_entity_visibility(entity, ir_visibility_local);
+		}
+	}
+	DEL_ARR_F(definitions);
+	if (known_init) {
+		pset_new_destroy(&unloaded);
+		pset_new_destroy(&known);
+		DEL_ARR_F(lazy_files);
+		known_init = false;
+	}
+
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i != n; ++i) {
+			set_entity_link(get_compound_member(segment, i), NULL);
+		}
+	}
+	return ok;
+}
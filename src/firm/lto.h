@@ -0,0 +1,43 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief link time optimization
+ *
+ * With -flto objects contain the exported IR of their translation unit
+ * instead of machine code. The link step imports all of them into one
+ * program, resolves the declarations of each object to the definitions in
+ * the others and generates code for the whole program at once, so the
+ * optimizations work across translation units.
+ */
+#ifndef LTO_H
+#define LTO_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/** Writes the IR of the program as an object. */
+bool lto_write_object(FILE *out);
+
+/** Returns whether @p filename is an object written by lto_write_object(). */
+bool lto_is_object(char const *filename);
+
+/**
+ * Imports the IR of an object into the program. The function bodies of
+ * binary IR objects are only constructed by lto_resolve().
+ */
+bool lto_read_object(FILE *in, char const *filename);
+
+/**
+ * Binds the references to declarations to the definitions of the imported
+ * objects. If @p whole_program is set, the user asserted that no code outside
+ * of the program (like libraries or dynamic symbol lookups) refers to its
+ * functions, so all of them except main become local. Returns false if a
+ * function body of an object is malformed.
+ */
+bool lto_resolve(bool whole_program);
+
+#endif
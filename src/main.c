@@ -10,8 +10,10 @@
 
 #include "adt/panic.h"
 #include "adt/strutil.h"
+#include "adt/xmalloc.h"
 #include "ast/ast.h"
 #include "driver/c_driver.h"
+#include "driver/cache.h"
 #include "driver/diagnostic.h"
 #include "driver/driver.h"
 #include "driver/driver_t.h"
@@ -22,7 +24,7 @@
 #include "driver/timing.h"
 #include "firm/ast2firm.h"
 #include "firm/firm_opt.h"
-#include "firm/jittest.h"
+#include "firm/jit.h"
 #include "parser/parser.h"
 #include "parser/preprocessor.h"
 #include "wrappergen/write_compoundsizes.h"
@@ -46,9 +48,15 @@ typedef enum compile_mode_t {
 	MODE_PRINT_JNA,
 	MODE_PRINT_COMPOUND_SIZE,
 	MODE_JITTEST,
+	MODE_RUN,
 } compile_mode_t;
 static compile_mode_t mode = MODE_COMPILE_ASSEMBLE_LINK;
 
+/** arguments following "--", which are passed to the program with --run */
+static int    program_argc;
+static char **program_argv;
+static int    program_exit_code;
+
 static bool print_fluffy(compilation_env_t *env, compilation_unit_t *unit)
 {
 	if (!open_output(env))
@@ -137,12 +145,23 @@ static void set_unused_after(compile_mode_t mode)
 	}
 }
 
-static bool jittest(compilation_env_t *env, compilation_unit_t *unit)
+static bool run_program(compilation_env_t *env, compilation_unit_t *unit)
 {
 	(void)env;
-	(void)unit;
-	jit_compile_execute_main();
-	return true;
+	if (cache_enabled())
+		jit_set_cache(cache_get_dir(), cache_get_options_key());
+
+	int    const argc = program_argc + 1;
+	char **const argv = XMALLOCN(char*, argc + 1);
+	argv[0] = (char*)unit->original_name;
+	memcpy(argv + 1, program_argv, program_argc * sizeof(*argv));
+	argv[argc] = NULL;
+	bool const res = jit_run(argc, argv, &program_exit_code);
+	free(argv);
+	if (res && mode == MODE_JITTEST)
+		fprintf(stderr, "Exit code: %d\n", program_exit_code);
+	unit->name = NULL; /* avoid warnings about unused inputs */
+	return res;
 }
 
 /** modify compilation sequence based on choosen compilation mode */
@@ -201,8 +220,9 @@ static void set_handlers(compile_mode_t mode)
 		set_unused_after(MODE_COMPILE);
 		return;
 	case MODE_JITTEST:
+	case MODE_RUN:
 		set_unit_handler(COMPILATION_UNIT_INTERMEDIATE_REPRESENTATION,
-		                 jittest, true);
+		                 run_program, true);
 		set_unused_after(MODE_COMPILE);
 		return;
 	case MODE_COMPILE_ASSEMBLE:
@@ -257,8 +277,24 @@ static bool parse_compile_mode_options(options_state_t *s)
 		mode         = MODE_COMPILE_DUMP;
 	} else if (simple_arg("-export-ir", s)) {
 		mode = MODE_COMPILE_EXPORTIR;
+	} else if (simple_arg("-export-ir-text", s)) {
+		mode           = MODE_COMPILE_EXPORTIR;
+		driver_ir_text = true;
 	} else if (simple_arg("-jittest", s)) {
 		mode = MODE_JITTEST;
+	} else if (simple_arg("-run", s)) {
+		mode = MODE_RUN;
+	} else if (simple_arg("-", s)) {
+		if (mode != MODE_RUN && mode != MODE_JITTEST) {
+			errorf(NULL, "'--' is only allowed after --run or --jittest");
+			s->argument_errors = true;
+			s->i               = s->argc - 1;
+			return true;
+		}
+		/* the remaining arguments belong to the program */
+		program_argc = s->argc - s->i - 1;
+		program_argv = &s->argv[s->i + 1];
+		s->i         = s->argc - 1;
 	} else if (simple_arg("fsyntax-only", s)) {
 		set_mode_gcc_prec(MODE_PARSE_ONLY, full_option);
 	} else if (simple_arg("fno-syntax-only", s)) {
@@ -297,6 +333,8 @@ int action_compile(const char *argv0)
 			result = EXIT_FAILURE;
 		}
 	}
+	if (result == EXIT_SUCCESS && mode == MODE_RUN)
+		result = program_exit_code;
 
 	if (do_timing)
 		timer_term(print_timing ? stderr : NULL);
@@ -320,8 +358,13 @@ int main(int argc, char **argv)
 	state.argv   = argv;
 	state.action = action_compile;
 
+	/* remember the original arguments, option parsing removes some */
+	cache_set_commandline(argc, argv);
+
 	/* do early option parsing */
 	for (state.i = 1; state.i < argc; ++state.i) {
+		if (streq(argv[state.i], "--"))
+			break;
 		if (options_parse_early_target(&state)
 		 || options_parse_early_sysroot(&state)
 		 || options_parse_early_codegen(&state))
@@ -332,7 +375,8 @@ int main(int argc, char **argv)
 		isysroot = lsysroot;
 
 	/* Setup target so later options can override the target defaults */
-	target_set_defaults();
+	if (!target_set_defaults())
+		return EXIT_FAILURE;
 
 	/* parse rest of options */
 	for (state.i = 1; state.i < argc; ++state.i) {
@@ -356,8 +400,7 @@ int main(int argc, char **argv)
 		help_usage(argv[0]);
 		return EXIT_FAILURE;
 	}
-
-	if (!target_setup())
+	if (!target_setup() || error_count > 0)
 		return EXIT_FAILURE;
 
 	assert(state.action != NULL);
@@ -4,7 +4,12 @@
  */
 #include "builtins.h"
 
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "adt/strutil.h"
+#include "adt/util.h"
 #include "ast/dialect.h"
 #include "ast/entity_t.h"
 #include "ast/symbol_t.h"
@@ -28,157 +33,258 @@ static entity_t *create_builtin_function(builtin_kind_t kind, symbol_t *symbol,
 	return entity;
 }
 
-static entity_t *record_builtin_function(builtin_kind_t kind, symbol_t *symbol,
-                                         type_t *function_type)
-{
-	entity_t *entity = create_builtin_function(kind, symbol, function_type);
-	record_entity(entity, /*is_definition=*/false);
-	return entity;
-}
+typedef struct builtin_t {
+	char const       *name;          /**< the name of the builtin */
+	builtin_kind_t    kind;
+	ir_builtin_kind   firm_kind;     /**< the firm builtin for BUILTIN_FIRM */
+	char const       *actual_name;   /**< the libc function implementing it */
+	unsigned          chk_arg_pos;   /**< for BUILTIN_LIBC_CHECK, the atomic_op_t
+	                                      for BUILTIN_ATOMIC_(FETCH_OP|OP_FETCH) */
+	type_t          **return_type;
+	int               n_parameters;
+	type_t          **parameters[6];
+	bool              variadic;
+	decl_modifiers_t  modifiers;
+} builtin_t;
+
+#define GNU(kind, name, ret, mods, n, ...) \
+	{ "__builtin_" name, kind, ir_bk_trap, NULL, 0, &ret, n, { __VA_ARGS__ }, false, mods }
+#define FIRM(kind, name, ret, mods, n, ...) \
+	{ name, BUILTIN_FIRM, kind, NULL, 0, &ret, n, { __VA_ARGS__ }, false, mods }
+#define LIBC(name, ret, mods, n, ...) \
+	{ "__builtin_" name, BUILTIN_LIBC, ir_bk_trap, name, 0, &ret, n, { __VA_ARGS__ }, false, mods }
+#define CHK(name, pos, ret, mods, n, ...) \
+	{ "__builtin___" name "_chk", BUILTIN_LIBC_CHECK, ir_bk_trap, name, pos, &ret, n, { __VA_ARGS__ }, false, mods }
+#define ATOMIC(kind, name, op, ret, n, ...) \
+	{ name, kind, ir_bk_trap, NULL, op, &ret, n, { __VA_ARGS__ }, false, DM_NONE }
+
+/* sorted by name on first use */
+static builtin_t gnu_builtins[] = {
+	GNU(BUILTIN_ALLOCA,      "alloca",         type_void_ptr,    DM_NONE,  1, &type_size_t),
+	GNU(BUILTIN_INF,         "huge_val",       type_double,      DM_CONST, 0, NULL),
+	GNU(BUILTIN_INF,         "huge_valf",      type_float,       DM_CONST, 0, NULL),
+	GNU(BUILTIN_INF,         "huge_vall",      type_long_double, DM_CONST, 0, NULL),
+	GNU(BUILTIN_INF,         "inf",            type_double,      DM_CONST, 0, NULL),
+	GNU(BUILTIN_INF,         "inff",           type_float,       DM_CONST, 0, NULL),
+	GNU(BUILTIN_INF,         "infl",           type_long_double, DM_CONST, 0, NULL),
+	GNU(BUILTIN_NAN,         "nan",            type_double,      DM_CONST, 1, &type_char_ptr),
+	GNU(BUILTIN_NAN,         "nanf",           type_float,       DM_CONST, 1, &type_char_ptr),
+	GNU(BUILTIN_NAN,         "nanl",           type_long_double, DM_CONST, 1, &type_char_ptr),
+	GNU(BUILTIN_VA_END,      "va_end",         type_void,        DM_NONE,  1, &type_valist_arg),
+	GNU(BUILTIN_EXPECT,      "expect",         type_long,        DM_CONST, 2, &type_long, &type_long),
+	GNU(BUILTIN_OBJECT_SIZE, "object_size",    type_size_t,      DM_CONST, 2, &type_void_ptr, &type_int),
+	GNU(BUILTIN_UNREACHABLE, "unreachable",    type_void,        DM_NORETURN, 0, NULL),
+	{ "__builtin_assume_aligned", BUILTIN_ASSUME_ALIGNED, ir_bk_trap, NULL, 0, &type_void_ptr, 1, { &type_const_void_ptr }, true, DM_CONST },
+
+	FIRM(ir_bk_bswap,          "__builtin_bswap32",        type_int32_t,  DM_CONST,    1, &type_int32_t),
+	FIRM(ir_bk_bswap,          "__builtin_bswap64",        type_int64_t,  DM_CONST,    1, &type_int64_t),
+	FIRM(ir_bk_clz,            "__builtin_clz",            type_int,      DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_clz,            "__builtin_clzl",           type_int,      DM_CONST,    1, &type_unsigned_long),
+	FIRM(ir_bk_clz,            "__builtin_clzll",          type_int,      DM_CONST,    1, &type_unsigned_long_long),
+	FIRM(ir_bk_ctz,            "__builtin_ctz",            type_int,      DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_ctz,            "__builtin_ctzl",           type_int,      DM_CONST,    1, &type_unsigned_long),
+	FIRM(ir_bk_ctz,            "__builtin_ctzll",          type_int,      DM_CONST,    1, &type_unsigned_long_long),
+	FIRM(ir_bk_ffs,            "__builtin_ffs",            type_int,      DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_ffs,            "__builtin_ffsl",           type_int,      DM_CONST,    1, &type_unsigned_long),
+	FIRM(ir_bk_ffs,            "__builtin_ffsll",          type_int,      DM_CONST,    1, &type_unsigned_long_long),
+	FIRM(ir_bk_frame_address,  "__builtin_frame_address",  type_void_ptr, DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_parity,         "__builtin_parity",         type_int,      DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_parity,         "__builtin_parityl",        type_int,      DM_CONST,    1, &type_unsigned_long),
+	FIRM(ir_bk_parity,         "__builtin_parityll",       type_int,      DM_CONST,    1, &type_unsigned_long_long),
+	FIRM(ir_bk_popcount,       "__builtin_popcount",       type_int,      DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_popcount,       "__builtin_popcountl",      type_int,      DM_CONST,    1, &type_unsigned_long),
+	FIRM(ir_bk_popcount,       "__builtin_popcountll",     type_int,      DM_CONST,    1, &type_unsigned_long_long),
+	{ "__builtin_prefetch", BUILTIN_FIRM, ir_bk_prefetch, NULL, 0, &type_float, 1, { &type_void_ptr }, true, DM_NONE },
+	FIRM(ir_bk_return_address, "__builtin_return_address", type_void_ptr, DM_CONST,    1, &type_unsigned_int),
+	FIRM(ir_bk_trap,           "__builtin_trap",           type_void,     DM_NORETURN, 0, NULL),
+
+	FIRM(ir_bk_compare_swap, "__sync_val_compare_and_swap", type_builtin_template, DM_NONE, 3, &type_builtin_template_ptr, &type_builtin_template, &type_builtin_template),
+	FIRM(ir_bk_may_alias,    "__builtin_may_alias",         type_int,              DM_NONE, 2, &type_const_void_ptr, &type_const_void_ptr),
+
+	ATOMIC(BUILTIN_ATOMIC_COMPARE_EXCHANGE, "__atomic_compare_exchange_n",  0,              type_bool,             6, &type_builtin_template_ptr, &type_builtin_template_ptr, &type_builtin_template, &type_bool, &type_int, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_EXCHANGE,         "__atomic_exchange_n",          0,              type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FENCE,            "__atomic_signal_fence",        0,              type_void,             1, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FENCE,            "__atomic_thread_fence",        0,              type_void,             1, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_LOAD,             "__atomic_load_n",              0,              type_builtin_template, 2, &type_builtin_template_ptr, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_STORE,            "__atomic_store_n",             0,              type_void,             3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__atomic_fetch_add",           ATOMIC_OP_ADD,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__atomic_fetch_and",           ATOMIC_OP_AND,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__atomic_fetch_nand",          ATOMIC_OP_NAND, type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__atomic_fetch_or",            ATOMIC_OP_OR,   type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__atomic_fetch_sub",           ATOMIC_OP_SUB,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__atomic_fetch_xor",           ATOMIC_OP_XOR,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__atomic_add_fetch",           ATOMIC_OP_ADD,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__atomic_and_fetch",           ATOMIC_OP_AND,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__atomic_nand_fetch",          ATOMIC_OP_NAND, type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__atomic_or_fetch",            ATOMIC_OP_OR,   type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__atomic_sub_fetch",           ATOMIC_OP_SUB,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__atomic_xor_fetch",           ATOMIC_OP_XOR,  type_builtin_template, 3, &type_builtin_template_ptr, &type_builtin_template, &type_int),
+
+	ATOMIC(BUILTIN_ATOMIC_EXCHANGE,         "__sync_lock_test_and_set",     0,              type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_FENCE,            "__sync_synchronize",           0,              type_void,             0, NULL),
+	ATOMIC(BUILTIN_ATOMIC_STORE,            "__sync_lock_release",          0,              type_void,             1, &type_builtin_template_ptr),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__sync_fetch_and_add",         ATOMIC_OP_ADD,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__sync_fetch_and_and",         ATOMIC_OP_AND,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__sync_fetch_and_nand",        ATOMIC_OP_NAND, type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__sync_fetch_and_or",          ATOMIC_OP_OR,   type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__sync_fetch_and_sub",         ATOMIC_OP_SUB,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_FETCH_OP,         "__sync_fetch_and_xor",         ATOMIC_OP_XOR,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__sync_add_and_fetch",         ATOMIC_OP_ADD,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__sync_and_and_fetch",         ATOMIC_OP_AND,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__sync_nand_and_fetch",        ATOMIC_OP_NAND, type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__sync_or_and_fetch",          ATOMIC_OP_OR,   type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__sync_sub_and_fetch",         ATOMIC_OP_SUB,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_ATOMIC_OP_FETCH,         "__sync_xor_and_fetch",         ATOMIC_OP_XOR,  type_builtin_template, 2, &type_builtin_template_ptr, &type_builtin_template),
+	ATOMIC(BUILTIN_SYNC_BOOL_COMPARE_SWAP,  "__sync_bool_compare_and_swap", 0,              type_bool,             3, &type_builtin_template_ptr, &type_builtin_template, &type_builtin_template),
+
+	LIBC("abort",   type_void,        DM_NORETURN, 0, NULL),
+	LIBC("abs",     type_int,         DM_CONST,    1, &type_int),
+	LIBC("atan2l",  type_long_double, DM_CONST,    2, &type_long_double, &type_long_double),
+	LIBC("exit",    type_void,        DM_NORETURN, 1, &type_int),
+	LIBC("fabs",    type_double,      DM_CONST,    1, &type_double),
+	LIBC("fabsf",   type_float,       DM_CONST,    1, &type_float),
+	LIBC("fabsl",   type_long_double, DM_CONST,    1, &type_long_double),
+	LIBC("labs",    type_long,        DM_CONST,    1, &type_long),
+	LIBC("llabs",   type_long_long,   DM_CONST,    1, &type_long_long),
+	LIBC("malloc",  type_void_ptr,    DM_MALLOC,   1, &type_size_t),
+	LIBC("memcmp",  type_int,         DM_PURE,     3, &type_const_void_ptr, &type_const_void_ptr, &type_size_t),
+	LIBC("memcpy",  type_void_ptr,    DM_NONE,     3, &type_void_ptr_restrict, &type_const_void_ptr_restrict, &type_size_t),
+	LIBC("memmove", type_void_ptr,    DM_NONE,     3, &type_void_ptr_restrict, &type_const_void_ptr_restrict, &type_size_t),
+	LIBC("memset",  type_void_ptr,    DM_NONE,     3, &type_void_ptr, &type_int, &type_size_t),
+	LIBC("stpcpy",  type_char_ptr,    DM_NONE,     2, &type_char_ptr_restrict, &type_const_char_ptr_restrict),
+	LIBC("strcat",  type_char_ptr,    DM_NONE,     2, &type_char_ptr_restrict, &type_const_char_ptr_restrict),
+	LIBC("strchr",  type_char_ptr,    DM_NONE,     2, &type_const_char_ptr, &type_int),
+	LIBC("strcmp",  type_int,         DM_PURE,     2, &type_const_char_ptr, &type_const_char_ptr),
+	LIBC("strcpy",  type_char_ptr,    DM_NONE,     2, &type_char_ptr_restrict, &type_const_char_ptr_restrict),
+	LIBC("strlen",  type_size_t,      DM_PURE,     1, &type_const_char_ptr),
+	LIBC("strncat", type_char_ptr,    DM_NONE,     3, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t),
+	LIBC("strncpy", type_char_ptr,    DM_NONE,     3, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t),
+
+	CHK("memcpy",  3, type_void_ptr, DM_NONE, 4, &type_void_ptr_restrict, &type_const_void_ptr_restrict, &type_size_t, &type_size_t),
+	CHK("memmove", 3, type_void_ptr, DM_NONE, 4, &type_void_ptr_restrict, &type_const_void_ptr_restrict, &type_size_t, &type_size_t),
+	CHK("memset",  3, type_void_ptr, DM_NONE, 4, &type_void_ptr, &type_int, &type_size_t, &type_size_t),
+	CHK("stpcpy",  2, type_char_ptr, DM_NONE, 3, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t),
+	CHK("stpncpy", 3, type_char_ptr, DM_NONE, 4, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t, &type_size_t),
+	CHK("strcat",  2, type_char_ptr, DM_NONE, 3, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t),
+	CHK("strcpy",  2, type_char_ptr, DM_NONE, 3, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t),
+	CHK("strncat", 3, type_char_ptr, DM_NONE, 4, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t, &type_size_t),
+	CHK("strncpy", 3, type_char_ptr, DM_NONE, 4, &type_char_ptr_restrict, &type_const_char_ptr_restrict, &type_size_t, &type_size_t),
 
-static symbol_t *finalize_symbol_string(void)
-{
-	char     *const string = obstack_nul_finish(&symbol_obstack);
-	symbol_t *const symbol = symbol_table_insert(string);
-	if (symbol->string != string)
-		obstack_free(&symbol_obstack, string);
-	return symbol;
-}
+	/* TODO: gcc has a LONG list of builtin functions (nearly everything from
+	 * C89-C99 and others). Complete this */
+};
 
-static entity_t *create_gnu_builtin(builtin_kind_t kind, const char *name,
-                                    type_t *type)
-{
-	obstack_printf(&symbol_obstack, "__builtin_%s", name);
-	symbol_t *symbol = finalize_symbol_string();
-	entity_t *entity = record_builtin_function(kind, symbol, type);
-	return entity;
-}
+/* sorted by name on first use */
+static builtin_t microsoft_intrinsics[] = {
+	/* intrinsics for all architectures */
+	{ "_rotl",   BUILTIN_ROTL, ir_bk_trap, NULL, 0, &type_unsigned_int,   2, { &type_unsigned_int,   &type_int }, false, DM_CONST },
+	{ "_rotl64", BUILTIN_ROTL, ir_bk_trap, NULL, 0, &type_unsigned_int64, 2, { &type_unsigned_int64, &type_int }, false, DM_CONST },
+	{ "_rotr",   BUILTIN_ROTR, ir_bk_trap, NULL, 0, &type_unsigned_int,   2, { &type_unsigned_int,   &type_int }, false, DM_CONST },
+	{ "_rotr64", BUILTIN_ROTR, ir_bk_trap, NULL, 0, &type_unsigned_int64, 2, { &type_unsigned_int64, &type_int }, false, DM_CONST },
 
-static entity_t *create_gnu_builtin_firm(ir_builtin_kind kind, const char *name,
-                                         type_t *type)
-{
-	obstack_printf(&symbol_obstack, "__builtin_%s", name);
-	symbol_t *symbol = finalize_symbol_string();
-	entity_t *entity = record_builtin_function(BUILTIN_FIRM, symbol, type);
-	entity->function.b.firm_builtin_kind = kind;
-	return entity;
-}
+	FIRM(ir_bk_bswap,    "_byteswap_ushort",     type_unsigned_short, DM_CONST, 1, &type_unsigned_short),
+	FIRM(ir_bk_bswap,    "_byteswap_ulong",      type_unsigned_long,  DM_CONST, 1, &type_unsigned_long),
+	FIRM(ir_bk_bswap,    "_byteswap_uint64",     type_unsigned_int64, DM_CONST, 1, &type_unsigned_int64),
 
-static entity_t *create_builtin_firm(ir_builtin_kind kind, const char *name,
-                                     type_t *type)
+	FIRM(ir_bk_debugbreak,     "__debugbreak",   type_void,         DM_NONE,  0, NULL),
+	FIRM(ir_bk_return_address, "_ReturnAddress", type_void_ptr,     DM_NONE,  0, NULL),
+	FIRM(ir_bk_popcount,       "__popcount",     type_unsigned_int, DM_CONST, 1, &type_unsigned_int),
+
+	/* x86/x64 only */
+	FIRM(ir_bk_inport,   "__inbyte",             type_unsigned_char,  DM_NONE,     1, &type_unsigned_short),
+	FIRM(ir_bk_inport,   "__inword",             type_unsigned_short, DM_NONE,     1, &type_unsigned_short),
+	FIRM(ir_bk_inport,   "__indword",            type_unsigned_long,  DM_NONE,     1, &type_unsigned_short),
+	FIRM(ir_bk_outport,  "__outbyte",            type_void,           DM_NONE,     2, &type_unsigned_short, &type_unsigned_char),
+	FIRM(ir_bk_outport,  "__outword",            type_void,           DM_NONE,     2, &type_unsigned_short, &type_unsigned_short),
+	FIRM(ir_bk_outport,  "__outdword",           type_void,           DM_NONE,     2, &type_unsigned_short, &type_unsigned_long),
+	FIRM(ir_bk_trap,     "__ud2",                type_void,           DM_NORETURN, 0, NULL),
+};
+
+#undef ATOMIC
+#undef CHK
+#undef LIBC
+#undef FIRM
+#undef GNU
+
+static int compare_builtins(void const *const a, void const *const b)
 {
-	symbol_t *symbol = symbol_table_insert(name);
-	entity_t *entity = record_builtin_function(BUILTIN_FIRM, symbol, type);
-	entity->function.b.firm_builtin_kind = kind;
-	return entity;
+	return strcmp(((builtin_t const*)a)->name, ((builtin_t const*)b)->name);
 }
 
-static entity_t *create_gnu_builtin_libc(const char *name, type_t *type)
+static builtin_t const *find_builtin(builtin_t *const builtins, size_t const n,
+                                     bool *const sorted, char const *const name)
 {
-	obstack_printf(&symbol_obstack, "__builtin_%s", name);
-	symbol_t *symbol = finalize_symbol_string();
-	entity_t *entity = record_builtin_function(BUILTIN_LIBC, symbol, type);
-	entity->function.builtin_in_lib = true;
-	entity->function.actual_name    = symbol_table_insert(name);
-	return entity;
+	if (!*sorted) {
+		qsort(builtins, n, sizeof(*builtins), compare_builtins);
+		*sorted = true;
+	}
+	builtin_t const key = { .name = name };
+	return bsearch(&key, builtins, n, sizeof(*builtins), compare_builtins);
 }
 
-static entity_t *create_gnu_builtin_chk(const char *name, unsigned chk_arg_pos,
-                                        type_t *type)
+static entity_t *create_builtin(builtin_t const *const builtin,
+                                symbol_t *const symbol)
 {
-	obstack_printf(&symbol_obstack, "__builtin___%s_chk", name);
-	symbol_t *symbol = finalize_symbol_string();
-	entity_t *entity = record_builtin_function(BUILTIN_LIBC_CHECK, symbol, type);
-	entity->function.builtin_in_lib = true;
-	entity->function.actual_name    = symbol_table_insert(name);
-	entity->function.b.chk_arg_pos  = chk_arg_pos;
+	type_t *parameters[ARRAY_SIZE(builtin->parameters)];
+	for (int i = 0; i != builtin->n_parameters; ++i) {
+		parameters[i] = *builtin->parameters[i];
+	}
+	type_t *const return_type = *builtin->return_type;
+	type_t *type;
+	if (builtin->variadic) {
+		assert(builtin->n_parameters == 1);
+		type = make_function_1_type_variadic(return_type, parameters[0],
+		                                     builtin->modifiers);
+	} else {
+		type = make_function_type(return_type, builtin->n_parameters,
+		                          parameters, builtin->modifiers);
+	}
+
+	entity_t *const entity = create_builtin_function(builtin->kind, symbol, type);
+	switch (builtin->kind) {
+	case BUILTIN_FIRM:
+		entity->function.b.firm_builtin_kind = builtin->firm_kind;
+		break;
+	case BUILTIN_LIBC_CHECK:
+		entity->function.b.chk_arg_pos = builtin->chk_arg_pos;
+		break;
+	case BUILTIN_ATOMIC_FETCH_OP:
+	case BUILTIN_ATOMIC_OP_FETCH:
+		entity->function.b.atomic_op = (atomic_op_t)builtin->chk_arg_pos;
+		break;
+	default:
+		break;
+	}
+	if (builtin->actual_name != NULL) {
+		entity->function.builtin_in_lib = true;
+		entity->function.actual_name    = symbol_table_insert(builtin->actual_name);
+	}
 	return entity;
 }
 
-void create_gnu_builtins(void)
+entity_t *get_builtin(symbol_t const *const symbol)
 {
-	entity_t *(*b)(builtin_kind_t,const char*,type_t*) = create_gnu_builtin;
-	b(BUILTIN_ALLOCA,      "alloca",         make_function_1_type(type_void_ptr, type_size_t, DM_NONE));
-	b(BUILTIN_INF,         "huge_val",       make_function_0_type(type_double, DM_CONST));
-	b(BUILTIN_INF,         "huge_valf",      make_function_0_type(type_float, DM_CONST));
-	b(BUILTIN_INF,         "huge_vall",      make_function_0_type(type_long_double, DM_CONST));
-	b(BUILTIN_INF,         "inf",            make_function_0_type(type_double, DM_CONST));
-	b(BUILTIN_INF,         "inff",           make_function_0_type(type_float, DM_CONST));
-	b(BUILTIN_INF,         "infl",           make_function_0_type(type_long_double, DM_CONST));
-	b(BUILTIN_NAN,         "nan",            make_function_1_type(type_double, type_char_ptr, DM_CONST));
-	b(BUILTIN_NAN,         "nanf",           make_function_1_type(type_float, type_char_ptr, DM_CONST));
-	b(BUILTIN_NAN,         "nanl",           make_function_1_type(type_long_double, type_char_ptr, DM_CONST));
-	b(BUILTIN_VA_END,      "va_end",         make_function_1_type(type_void, type_valist_arg, DM_NONE));
-	b(BUILTIN_EXPECT,      "expect",         make_function_2_type(type_long, type_long, type_long, DM_CONST));
-	b(BUILTIN_OBJECT_SIZE, "object_size",    make_function_2_type(type_size_t, type_void_ptr, type_int, DM_CONST));
-
-	entity_t *(*f)(ir_builtin_kind,const char*,type_t*)
-		= create_gnu_builtin_firm;
-	f(ir_bk_bswap,          "bswap32",        make_function_1_type(type_int32_t, type_int32_t, DM_CONST));
-	f(ir_bk_bswap,          "bswap64",        make_function_1_type(type_int64_t, type_int64_t, DM_CONST));
-	f(ir_bk_clz,            "clz",            make_function_1_type(type_int, type_unsigned_int, DM_CONST));
-	f(ir_bk_clz,            "clzl",           make_function_1_type(type_int, type_unsigned_long, DM_CONST));
-	f(ir_bk_clz,            "clzll",          make_function_1_type(type_int, type_unsigned_long_long, DM_CONST));
-	f(ir_bk_ctz,            "ctz",            make_function_1_type(type_int, type_unsigned_int, DM_CONST));
-	f(ir_bk_ctz,            "ctzl",           make_function_1_type(type_int, type_unsigned_long, DM_CONST));
-	f(ir_bk_ctz,            "ctzll",          make_function_1_type(type_int, type_unsigned_long_long, DM_CONST));
-	f(ir_bk_ffs,            "ffs",            make_function_1_type(type_int, type_unsigned_int, DM_CONST));
-	f(ir_bk_ffs,            "ffsl",           make_function_1_type(type_int, type_unsigned_long, DM_CONST));
-	f(ir_bk_ffs,            "ffsll",          make_function_1_type(type_int, type_unsigned_long_long, DM_CONST));
-	f(ir_bk_frame_address,  "frame_address",  make_function_1_type(type_void_ptr, type_unsigned_int, DM_CONST));
-	f(ir_bk_parity,         "parity",         make_function_1_type(type_int, type_unsigned_int, DM_CONST));
-	f(ir_bk_parity,         "parityl",        make_function_1_type(type_int, type_unsigned_long, DM_CONST));
-	f(ir_bk_parity,         "parityll",       make_function_1_type(type_int, type_unsigned_long_long, DM_CONST));
-	f(ir_bk_popcount,       "popcount",       make_function_1_type(type_int, type_unsigned_int, DM_CONST));
-	f(ir_bk_popcount,       "popcountl",      make_function_1_type(type_int, type_unsigned_long, DM_CONST));
-	f(ir_bk_popcount,       "popcountll",     make_function_1_type(type_int, type_unsigned_long_long, DM_CONST));
-	f(ir_bk_prefetch,       "prefetch",       make_function_1_type_variadic(type_float, type_void_ptr, DM_NONE));
-	f(ir_bk_return_address, "return_address", make_function_1_type(type_void_ptr, type_unsigned_int, DM_CONST));
-	f(ir_bk_trap,           "trap",           make_function_type(type_void, 0, NULL, DM_NORETURN));
-
-	entity_t *(*s)(ir_builtin_kind,const char*,type_t*) = create_builtin_firm;
-	type_t *template     = type_builtin_template;
-	type_t *template_ptr = type_builtin_template_ptr;
-	s(ir_bk_compare_swap, "__sync_val_compare_and_swap", make_function_type(template, 3, (type_t*[]) { template_ptr, template, template }, DM_NONE));
-	s(ir_bk_may_alias,    "__builtin_may_alias",         make_function_type(type_int, 2, (type_t*[]) { type_const_void_ptr, type_const_void_ptr }, DM_NONE));
-
-	entity_t *(*l)(const char*,type_t*) = create_gnu_builtin_libc;
-	l("abort",   make_function_type(type_void, 0, NULL, DM_NORETURN));
-	l("abs",     make_function_type(type_int, 1, (type_t *[]) { type_int }, DM_CONST));
-	l("atan2l",  make_function_type(type_long_double, 2, (type_t*[]) { type_long_double, type_long_double }, DM_CONST));
-	l("exit",    make_function_type(type_void, 1, (type_t *[]) { type_int }, DM_NORETURN));
-	l("fabs",    make_function_type(type_double, 1, (type_t *[]) { type_double }, DM_CONST));
-	l("fabsf",   make_function_type(type_float, 1, (type_t *[]) { type_float }, DM_CONST));
-	l("fabsl",   make_function_type(type_long_double, 1, (type_t *[]) { type_long_double }, DM_CONST));
-	l("labs",    make_function_type(type_long, 1, (type_t *[]) { type_long }, DM_CONST));
-	l("llabs",   make_function_type(type_long_long, 1, (type_t *[]) { type_long_long }, DM_CONST));
-	l("malloc",  make_function_type(type_void_ptr, 1, (type_t *[]) { type_size_t }, DM_MALLOC));
-	l("memcmp",  make_function_type(type_int, 3, (type_t *[]) { type_const_void_ptr, type_const_void_ptr, type_size_t }, DM_PURE));
-	l("memcpy",  make_function_type(type_void_ptr, 3, (type_t *[]) { type_void_ptr_restrict, type_const_void_ptr_restrict, type_size_t }, DM_NONE));
-	l("memmove", make_function_type(type_void_ptr, 3, (type_t *[]) { type_void_ptr_restrict, type_const_void_ptr_restrict, type_size_t }, DM_NONE));
-	l("memset",  make_function_type(type_void_ptr, 3, (type_t *[]) { type_void_ptr, type_int, type_size_t }, DM_NONE));
-	l("stpcpy",  make_function_type(type_char_ptr, 2, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict }, DM_NONE));
-	l("strcat",  make_function_type(type_char_ptr, 2, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict }, DM_NONE));
-	l("strchr",  make_function_type(type_char_ptr, 2, (type_t *[]) { type_const_char_ptr, type_int }, DM_NONE));
-	l("strcmp",  make_function_type(type_int, 2, (type_t *[]) { type_const_char_ptr, type_const_char_ptr }, DM_PURE));
-	l("strcpy",  make_function_type(type_char_ptr, 2, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict }, DM_NONE));
-	l("strlen",  make_function_type(type_size_t, 1, (type_t *[]) { type_const_char_ptr }, DM_PURE));
-	l("strncat", make_function_type(type_char_ptr, 3, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t }, DM_NONE));
-	l("strncpy", make_function_type(type_char_ptr, 3, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t }, DM_NONE));
-
-	entity_t *(*c)(const char*,unsigned,type_t*) = create_gnu_builtin_chk;
-	c("memcpy",  3, make_function_type(type_void_ptr, 4, (type_t *[]) { type_void_ptr_restrict, type_const_void_ptr_restrict, type_size_t, type_size_t}, DM_NONE));
-	c("memmove", 3, make_function_type(type_void_ptr, 4, (type_t *[]) { type_void_ptr_restrict, type_const_void_ptr_restrict, type_size_t, type_size_t }, DM_NONE));
-	c("memset",  3, make_function_type(type_void_ptr, 4, (type_t *[]) { type_void_ptr, type_int, type_size_t, type_size_t }, DM_NONE));
-	c("stpcpy",  2, make_function_type(type_char_ptr, 3, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t }, DM_NONE));
-	c("stpncpy", 3, make_function_type(type_char_ptr, 4, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t, type_size_t }, DM_NONE));
-	c("strcat",  2, make_function_type(type_char_ptr, 3, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t }, DM_NONE));
-	c("strcpy",  2, make_function_type(type_char_ptr, 3, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t }, DM_NONE));
-	c("strncat", 3, make_function_type(type_char_ptr, 4, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t, type_size_t }, DM_NONE));
-	c("strncpy", 3, make_function_type(type_char_ptr, 4, (type_t *[]) { type_char_ptr_restrict, type_const_char_ptr_restrict, type_size_t, type_size_t }, DM_NONE));
+	/* all builtins and intrinsics start with an underscore */
+	char const *const name = symbol->string;
+	if (name[0] != '_')
+		return NULL;
+
+	static bool      gnu_builtins_sorted;
+	builtin_t const *builtin = find_builtin(gnu_builtins,
+	                                        ARRAY_SIZE(gnu_builtins),
+	                                        &gnu_builtins_sorted, name);
+	if (builtin == NULL && dialect.ms) {
+		static bool microsoft_intrinsics_sorted;
+		builtin = find_builtin(microsoft_intrinsics,
+		                       ARRAY_SIZE(microsoft_intrinsics),
+		                       &microsoft_intrinsics_sorted, name);
+	}
+	if (builtin == NULL)
+		return NULL;
 
-	/* TODO: gcc has a LONG list of builtin functions (nearly everything from
-	 * C89-C99 and others). Complete this */
+	entity_t *const entity = create_builtin(builtin, symbol_table_insert(name));
+	record_builtin(entity);
+	return entity;
 }
 
 static entity_t *find_existing_entity(const char *name)
@@ -243,51 +349,6 @@ void find_known_libc_functions(void)
 	}
 }
 
-static entity_t *create_intrinsic_firm(ir_builtin_kind kind, const char *name,
-                                       type_t *type)
-{
-	symbol_t *symbol = symbol_table_insert(name);
-	entity_t *entity = record_builtin_function(BUILTIN_FIRM, symbol, type);
-	entity->function.b.firm_builtin_kind = kind;
-	return entity;
-}
-
-static entity_t *create_intrinsic(builtin_kind_t kind, const char *name,
-                                  type_t *type)
-{
-	symbol_t *symbol = symbol_table_insert(name);
-	entity_t *entity = record_builtin_function(kind, symbol, type);
-	return entity;
-}
-
-void create_microsoft_intrinsics(void)
-{
-	entity_t *(*i)(builtin_kind_t,const char*,type_t*) = create_intrinsic;
-	entity_t *(*f)(ir_builtin_kind,const char*,type_t*) = create_intrinsic_firm;
-	/* intrinsics for all architectures */
-	i(BUILTIN_ROTL,   "_rotl",                make_function_2_type(type_unsigned_int,   type_unsigned_int, type_int, DM_CONST));
-	i(BUILTIN_ROTL,   "_rotl64",              make_function_2_type(type_unsigned_int64, type_unsigned_int64, type_int, DM_CONST));
-	i(BUILTIN_ROTR,   "_rotr",                make_function_2_type(type_unsigned_int,   type_unsigned_int, type_int, DM_CONST));
-	i(BUILTIN_ROTR,   "_rotr64",              make_function_2_type(type_unsigned_int64, type_unsigned_int64, type_int, DM_CONST));
-
-	f(ir_bk_bswap,    "_byteswap_ushort",     make_function_1_type(type_unsigned_short, type_unsigned_short, DM_CONST));
-	f(ir_bk_bswap,    "_byteswap_ulong",      make_function_1_type(type_unsigned_long,  type_unsigned_long, DM_CONST));
-	f(ir_bk_bswap,    "_byteswap_uint64",     make_function_1_type(type_unsigned_int64, type_unsigned_int64, DM_CONST));
-
-	f(ir_bk_debugbreak,     "__debugbreak",   make_function_0_type(type_void, DM_NONE));
-	f(ir_bk_return_address, "_ReturnAddress", make_function_0_type(type_void_ptr, DM_NONE));
-	f(ir_bk_popcount,       "__popcount",     make_function_1_type(type_unsigned_int, type_unsigned_int, DM_CONST));
-
-	/* x86/x64 only */
-	f(ir_bk_inport,   "__inbyte",             make_function_1_type(type_unsigned_char, type_unsigned_short, DM_NONE));
-	f(ir_bk_inport,   "__inword",             make_function_1_type(type_unsigned_short, type_unsigned_short, DM_NONE));
-	f(ir_bk_inport,   "__indword",            make_function_1_type(type_unsigned_long, type_unsigned_short, DM_NONE));
-	f(ir_bk_outport,  "__outbyte",            make_function_2_type(type_void, type_unsigned_short, type_unsigned_char, DM_NONE));
-	f(ir_bk_outport,  "__outword",            make_function_2_type(type_void, type_unsigned_short, type_unsigned_short, DM_NONE));
-	f(ir_bk_outport,  "__outdword",           make_function_2_type(type_void, type_unsigned_short, type_unsigned_long, DM_NONE));
-	f(ir_bk_trap,     "__ud2",                make_function_type(type_void, 0, NULL, DM_NORETURN));
-}
-
 static type_t *add_type_modifier(type_t *orig_type, decl_modifiers_t modifiers)
 {
 	type_t *type = skip_typeref(orig_type);
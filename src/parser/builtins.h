@@ -6,16 +6,15 @@
 #define BUILTINS_H
 
 #include "ast/entity.h"
+#include "ast/symbol.h"
 
 /**
- * Create predefined gnu builtins.
+ * Returns the GNU builtin or MS intrinsic named @p symbol. Builtins are only
+ * created when they are looked up the first time.
+ *
+ * @return the builtin or NULL if there is no builtin of this name
  */
-void create_gnu_builtins(void);
-
-/**
- * Create predefined MS intrinsics.
- */
-void create_microsoft_intrinsics(void);
+entity_t *get_builtin(symbol_t const *symbol);
 
 /**
  * Some functions like setjmp,longjmp are known from libc and need special
@@ -23,7 +23,10 @@ struct input_t {
 	input_kind_t kind;
 	union {
 		FILE *file;
-		const char *string;
+		struct {
+			const char *pos;
+			const char *end;
+		} string;
 	} in;
 	input_decoder_t *decoder;
 
@@ -56,10 +59,10 @@ static size_t read_block(input_t *input, unsigned char *const read_buf,
 		return s;
 	} else {
 		assert(input->kind == INPUT_STRING);
-		size_t len = strlen(input->in.string);
+		size_t len = input->in.string.end - input->in.string.pos;
 		len = MIN(len, n);
-		memcpy(read_buf, input->in.string, len);
-		input->in.string += len;
+		memcpy(read_buf, input->in.string.pos, len);
+		input->in.string.pos += len;
 		return len;
 	}
 }
@@ -354,10 +357,17 @@ FILE *input_get_file(const input_t *const input)
 
 input_t *input_from_string(const char *string, input_decoder_t *decoder)
 {
-	input_t *result   = XMALLOCZ(input_t);
-	result->kind      = INPUT_STRING;
-	result->in.string = string;
-	result->decoder   = decoder;
+	return input_from_memory(string, strlen(string), decoder);
+}
+
+input_t *input_from_memory(const char *data, size_t size,
+                           input_decoder_t *decoder)
+{
+	input_t *result       = XMALLOCZ(input_t);
+	result->kind          = INPUT_STRING;
+	result->in.string.pos = data;
+	result->in.string.end = data + size;
+	result->decoder       = decoder;
 	return result;
 }
 
@@ -16,6 +16,9 @@ input_decoder_t *input_get_decoder(const char *encoding);
 
 input_t *input_from_stream(FILE *stream, input_decoder_t *decoder);
 input_t *input_from_string(const char *string, input_decoder_t *decoder);
+/** The @p size bytes at @p data must stay valid until the input is freed. */
+input_t *input_from_memory(const char *data, size_t size,
+                           input_decoder_t *decoder);
 
 input_decoder_t input_decode_utf8;
 
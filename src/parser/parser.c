@@ -6,10 +6,14 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <libfirm/irmode.h>
+#include <libfirm/tv.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
 
 #include "adt/array.h"
+#include "adt/bitfiddle.h"
 #include "adt/panic.h"
 #include "adt/strutil.h"
 #include "adt/util.h"
@@ -72,6 +76,15 @@ static token_t              token;
 static token_t              lookahead_buffer[MAX_LOOKAHEAD];
 /** Position of the next token in the lookahead buffer. */
 static size_t               lookahead_bufpos;
+/** An #embed being expanded into the list of its bytes, see
+ * parse_embed_expression(). */
+static embed_t              embed_expansion;
+/** The next byte of embed_expansion, which is preceded by a comma. */
+static size_t               embed_expansion_pos;
+static bool                 embed_expansion_comma;
+/** The token following the #embed being expanded. */
+static token_t              embed_expansion_next;
+static bool                 embed_expanding;
 static stack_entry_t       *environment_stack = NULL;
 static stack_entry_t       *label_stack       = NULL;
 static scope_t             *file_scope        = NULL;
@@ -86,6 +99,8 @@ static linkage_kind_t       current_linkage;
 static statement_t         *cgoto_first       = NULL;
 static label_t             *label_first       = NULL;
 static label_t            **label_anchor      = NULL;
+/** builtins created on demand, see record_builtin(). */
+static entity_t           **builtin_entities  = NULL;
 /** current translation unit. */
 static translation_unit_t  *unit              = NULL;
 /** true if we are in an __extension__ context. */
@@ -179,6 +194,7 @@ static void semantic_comparison(binary_expression_t *expression,
 	     T_const:           \
 	case T_restrict:        \
 	case T_volatile:        \
+	case T__Atomic:         \
 	case T_inline:          \
 	case T__forceinline
 
@@ -422,7 +438,8 @@ static size_t get_initializer_size(initializer_kind_t kind)
 		[INITIALIZER_VALUE]      = sizeof(initializer_value_t),
 		[INITIALIZER_STRING]     = sizeof(initializer_value_t),
 		[INITIALIZER_LIST]       = sizeof(initializer_list_t),
-		[INITIALIZER_DESIGNATOR] = sizeof(initializer_designator_t)
+		[INITIALIZER_DESIGNATOR] = sizeof(initializer_designator_t),
+		[INITIALIZER_DATA]       = sizeof(initializer_data_t)
 	};
 	assert((size_t)kind < ARRAY_SIZE(sizes));
 	assert(sizes[kind] != 0);
@@ -471,14 +488,56 @@ static size_t label_top(void)
 	return ARR_LEN(label_stack);
 }
 
+/** Creates a number token for a byte of an #embed. */
+static token_t make_embed_byte_token(unsigned char const byte)
+{
+	begin_string_construction();
+	obstack_printf(&string_obst, "%u", byte);
+	string_t *const string = finish_string_construction(STRING_ENCODING_CHAR);
+	return (token_t){
+		.literal = {
+			.base          = { .kind = T_NUMBER, .pos = embed_expansion.base.pos },
+			.string        = string,
+			.has_value     = true,
+			.suffix_offset = string->size,
+			.value         = byte,
+		}
+	};
+}
+
+/** Returns the next token of the #embed being expanded. */
+static token_t next_embed_token(void)
+{
+	if (embed_expansion_pos == embed_expansion.size) {
+		embed_expanding = false;
+		return embed_expansion_next;
+	}
+	if (embed_expansion_comma) {
+		embed_expansion_comma = false;
+		return (token_t){
+			.base = {
+				.kind   = ',',
+				.pos    = embed_expansion.base.pos,
+				.symbol = token_symbols[','],
+			}
+		};
+	}
+	embed_expansion_comma = true;
+	return make_embed_byte_token(embed_expansion.data[embed_expansion_pos++]);
+}
+
 /**
  * Return the next token.
  */
 static inline void next_token(void)
 {
-	token                              = lookahead_buffer[lookahead_bufpos];
-	lookahead_buffer[lookahead_bufpos] = pp_token;
-	next_preprocessing_token();
+	token = lookahead_buffer[lookahead_bufpos];
+	if (embed_expanding) {
+		lookahead_buffer[lookahead_bufpos] = next_embed_token();
+	} else {
+		lookahead_buffer[lookahead_bufpos] = pp_token;
+		next_preprocessing_token();
+	}
 
 	lookahead_bufpos = (lookahead_bufpos + 1) % MAX_LOOKAHEAD;
 }
@@ -709,6 +768,9 @@ entity_t *get_entity(const symbol_t *const symbol, entity_namespace_t namespc)
 			return entity;
 	}
 
+	/* builtins are created on first use */
+	if (namespc == NAMESPACE_NORMAL && file_scope != NULL)
+		return get_builtin(symbol);
 	return NULL;
 }
 
@@ -750,6 +812,18 @@ static void reset_symbol(symbol_t *symbol, entity_namespace_t namespc)
 	*anchor = iter->base.symbol_next;
 }
 
+/** Removes @p entity from the entities linked to its symbol. */
+static void unlink_entity(entity_t *const entity)
+{
+	entity_t **anchor = &entity->base.symbol->entity;
+	for (; *anchor != NULL; anchor = &(*anchor)->base.symbol_next) {
+		if (*anchor == entity) {
+			*anchor = entity->base.symbol_next;
+			return;
+		}
+	}
+}
+
 static void note_prev_decl(entity_t const *const entity)
 {
 	notef(&entity->base.pos, "previous declaration of '%N' was here", entity);
@@ -1872,6 +1946,145 @@ static void skip_initializers(void)
 	}
 }
 
+static bool value_fits_mode(unsigned long long const value,
+                            ir_mode const *const mode)
+{
+	unsigned const bits = get_mode_size_bits(mode) - mode_is_signed(mode);
+	return bits >= sizeof(value) * CHAR_BIT || value >> bits == 0;
+}
+
+/**
+ * Checks whether elements of the given type at the current position of the
+ * path may be collected into a data initializer.
+ */
+static bool is_data_element(type_path_t const *const path,
+                            type_t const *const type)
+{
+	if (type->kind != TYPE_ATOMIC || !is_type_integer(type)
+	 || type->atomic.akind == ATOMIC_TYPE_BOOL)
+		return false;
+	type_path_entry_t const *const top = get_type_path_top(path);
+	return is_type_array(top->type);
+}
+
+/**
+ * Checks whether the current token is a complete initializer consisting of a
+ * plain integer literal, whose value fits the mode of the element type.
+ */
+static bool is_data_literal(ir_mode const *const mode)
+{
+	return peek(T_NUMBER) && token.literal.has_value
+	    && token.literal.suffix_offset == token.literal.string->size
+	    && token.literal.value <= LONG_MAX
+	    && value_fits_mode(token.literal.value, mode)
+	    && (peek_ahead(',') || peek_ahead('}'));
+}
+
+/**
+ * Parses a run of integer literals initializing consecutive elements of the
+ * array at the top of the path into a single data initializer. No expression
+ * is created for the elements.
+ *
+ * @param separator_consumed  set if the run stopped after eating a ','
+ */
+static initializer_t *parse_data_initializer(type_path_t *const path,
+                                             bool *const separator_consumed)
+{
+	type_t            *const type  = path->top_type;
+	ir_mode           *const mode  = atomic_modes[skip_typeref(type)->atomic.akind];
+	type_path_entry_t *const top   = get_type_path_top(path);
+	type_t      const *const array = top->type;
+	size_t             const limit = array->array.size_constant
+		? array->array.size - top->v.index : (size_t)-1;
+	unsigned           const size  = get_ctype_size(type);
+	position_t         const pos   = *HERE;
+
+	unsigned char *data = NEW_ARR_F(unsigned char, 0);
+	size_t         len  = 0;
+	for (;;) {
+		unsigned long long const value = token.literal.value;
+		for (unsigned b = 0; b != size; ++b) {
+			ARR_APP1(unsigned char, data, (unsigned char)(value >> b * 8));
+		}
+		++len;
+		eat(T_NUMBER);
+
+		if (len == limit || !peek(',') || !peek_ahead(T_NUMBER))
+			break;
+		eat(',');
+		if (!is_data_literal(mode)) {
+			*separator_consumed = true;
+			break;
+		}
+	}
+
+	size_t const   n_bytes = ARR_LEN(data);
+	unsigned char *bytes   = allocate_ast(n_bytes);
+	memcpy(bytes, data, n_bytes);
+	DEL_ARR_F(data);
+
+	initializer_t *result = allocate_initializer_zero(INITIALIZER_DATA, &pos);
+	result->data.type         = type;
+	result->data.len          = len;
+	result->data.element_size = size;
+	result->data.data         = bytes;
+
+	/* the caller advances past the last element */
+	top->v.index += len - 1;
+	return result;
+}
+
+/**
+ * Turns the contents of an #embed directive into a data initializer for
+ * consecutive elements of the array at the top of the path. Byte sized
+ * elements refer to the embedded resource directly.
+ */
+static initializer_t *parse_embed_initializer(type_path_t *const path,
+                                              parse_initializer_env_t *const env)
+{
+	type_t            *const type  = path->top_type;
+	type_path_entry_t *const top   = get_type_path_top(path);
+	type_t      const *const array = top->type;
+	unsigned           const size  = get_ctype_size(type);
+	position_t         const pos   = *HERE;
+
+	size_t len = token.embed.size;
+	if (array->array.size_constant) {
+		size_t const remaining = array->array.size - top->v.index;
+		if (len > remaining) {
+			if (env->entity != NULL) {
+				warningf(WARN_OTHER, &pos,
+				         "excess elements in initializer for '%N'",
+				         env->entity);
+			} else {
+				warningf(WARN_OTHER, &pos, "excess elements in initializer");
+			}
+			len = remaining;
+		}
+	}
+
+	unsigned char const *data = token.embed.data;
+	if (size != 1) {
+		/* widen the bytes to the element size */
+		unsigned char *const widened = allocate_ast_zero(len * size);
+		for (size_t i = 0; i != len; ++i) {
+			widened[i * size] = data[i];
+		}
+		data = widened;
+	}
+	eat(T_EMBED);
+
+	initializer_t *result = allocate_initializer_zero(INITIALIZER_DATA, &pos);
+	result->data.type         = type;
+	result->data.len          = len;
+	result->data.element_size = size;
+	result->data.data         = data;
+
+	/* the caller advances past the last element */
+	top->v.index += len - 1;
+	return result;
+}
+
 /**
  * Parse a part of an initialiser for a struct or union,
  */
@@ -1897,7 +2110,8 @@ static initializer_t *parse_sub_initializer(type_path_t *path,
 	initializer_t **initializers = NEW_ARR_F(initializer_t*, 0);
 
 	while (true) {
-		designator_t *designator = NULL;
+		designator_t *designator         = NULL;
+		bool          separator_consumed = false;
 		if (peek('.') || peek('[')) {
 			designator = parse_designation();
 			goto finish_designator;
@@ -1959,6 +2173,12 @@ finish_designator:
 
 				ascend_from_subtype(path);
 			}
+		} else if (type != NULL && is_data_element(path, type)
+		        && is_data_literal(atomic_modes[type->atomic.akind])) {
+			sub = parse_data_initializer(path, &separator_consumed);
+		} else if (peek(T_EMBED) && type != NULL
+		        && is_data_element(path, type)) {
+			sub = parse_embed_initializer(path, env);
 		} else {
 			/* must be an expression */
 			expression_t *expression = parse_assignment_expression();
@@ -2039,7 +2259,7 @@ excess_elements:;
 		ARR_APP1(initializer_t*, initializers, sub);
 
 error_parse_next:
-		if (!accept(','))
+		if (!separator_consumed && !accept(','))
 			break;
 		if (peek('}'))
 			break;
@@ -2761,6 +2981,23 @@ check_specifier:
 			newtype = true;
 			type    = parse_typeof();
 			break;
+		case T__Atomic:
+			if (!peek_ahead('(')) {
+				qualifiers |= TYPE_QUALIFIER_ATOMIC;
+				eat(T__Atomic);
+				break;
+			}
+			/* _Atomic(type-name) specifier */
+			CHECK_DOUBLE_TYPE();
+			eat(T__Atomic);
+			add_anchor_token(')');
+			expect('(');
+			type       = parse_typename();
+			qualifiers |= TYPE_QUALIFIER_ATOMIC;
+			rem_anchor_token(')');
+			expect(')');
+			newtype    = false;
+			break;
 		case T___builtin_va_list:
 			CHECK_DOUBLE_TYPE();
 			newtype = false;
@@ -3011,6 +3248,7 @@ static type_qualifiers_t parse_type_qualifiers(void)
 		MATCH_TYPE_QUALIFIER(T_const,    TYPE_QUALIFIER_CONST);
 		MATCH_TYPE_QUALIFIER(T_restrict, TYPE_QUALIFIER_RESTRICT);
 		MATCH_TYPE_QUALIFIER(T_volatile, TYPE_QUALIFIER_VOLATILE);
+		MATCH_TYPE_QUALIFIER(T__Atomic,  TYPE_QUALIFIER_ATOMIC);
 		/* microsoft extended type modifiers */
 		MATCH_TYPE_QUALIFIER(T__w64,     TYPE_QUALIFIER_W64);
 		MATCH_TYPE_QUALIFIER(T___ptr32,  TYPE_QUALIFIER_PTR32);
@@ -3955,6 +4193,19 @@ static void add_entity(entity_t *const entity)
 	append_entity(current_scope, entity);
 }
 
+void record_builtin(entity_t *const entity)
+{
+	/* The builtin may be looked up in any scope, but belongs to the file scope.
+	 * It is not pushed on the environment stack, because leaving the current
+	 * scope must not remove it. */
+	entity->base.parent_scope = file_scope;
+	PUSH_CURRENT_ENTITY(NULL);
+	append_entity(file_scope, entity);
+	POP_CURRENT_ENTITY();
+	set_entity(entity);
+	ARR_APP1(entity_t*, builtin_entities, entity);
+}
+
 static void check_typedef(const position_t *const pos, entity_t *const entity, entity_t *const previous)
 {
 	type_t *const type      = skip_typeref(entity->declaration.type);
@@ -4769,6 +5020,7 @@ static bool initializer_returns(initializer_t const *const init)
 
 	case INITIALIZER_STRING:
 	case INITIALIZER_DESIGNATOR: // designators have no payload
+	case INITIALIZER_DATA:
 		return true;
 	}
 	panic("unhandled initializer");
@@ -5332,6 +5584,9 @@ static void parse_external_declaration(void)
 	 * record_entity() reported the error and returned the fresh one. */
 	assert(function->body == NULL);
 
+	if (function->optimize == 0)
+		function->optimize = pragma_optimize_level;
+
 	/* parse function body */
 	int         label_stack_top      = label_top();
 	function_t *old_current_function = current_function;
@@ -5697,16 +5952,26 @@ static expression_t *parse_boolean_literal(bool value)
 	return literal;
 }
 
-static bool try_create_integer(literal_expression_t *literal, type_t *type)
+static bool try_create_integer(literal_expression_t *literal, type_t *type,
+                               literal_t const *const lexed)
 {
 	assert(type->kind == TYPE_ATOMIC || type->kind == TYPE_COMPLEX);
 	atomic_type_kind_t akind = type->atomic.akind;
 
-	ir_mode    *const mode = atomic_modes[akind];
-	char const *const str  = literal->value->begin;
-	ir_tarval  *const tv   = new_tarval_from_str(str, literal->suffix - str, mode);
-	if (tv == tarval_bad)
-		return false;
+	ir_mode   *const mode = atomic_modes[akind];
+	ir_tarval *tv;
+	if (lexed->has_value && lexed->value <= LONG_MAX) {
+		/* Use the value computed by the lexer instead of parsing the string
+		 * again. */
+		if (!value_fits_mode(lexed->value, mode))
+			return false;
+		tv = new_tarval_from_long((long)lexed->value, mode);
+	} else {
+		char const *const str = literal->value->begin;
+		tv = new_tarval_from_str(str, literal->suffix - str, mode);
+		if (tv == tarval_bad)
+			return false;
+	}
 
 	literal->base.type    = type;
 	literal->target_value = tv;
@@ -5718,7 +5983,8 @@ static bool try_create_integer(literal_expression_t *literal, type_t *type)
  * Since this is backend dependent the parses needs this call exposed.
  * Works for EXPR_LITERAL_* expressions.
  */
-static void determine_literal_type(literal_expression_t *const literal)
+static void determine_literal_type(literal_expression_t *const literal,
+                                   literal_t const *const lexed)
 {
 	assert(literal->base.kind == EXPR_LITERAL_INTEGER);
 
@@ -5732,12 +5998,12 @@ static void determine_literal_type(literal_expression_t *const literal)
 
 	/* First try, if the constant fits into the type specified by the suffix.
 	 * Otherwise check, if it is small enough for some type. */
-	if (!try_create_integer(literal, literal->base.type)
-	 && (sign < 0 || !try_create_integer(literal, type_unsigned_int))
-	 && (sign > 0 || !try_create_integer(literal, type_long))
-	 && (sign < 0 || !try_create_integer(literal, type_unsigned_long))
-	 && (sign > 0 || !try_create_integer(literal, type_long_long))
-	 && (sign < 0 || !try_create_integer(literal, type_unsigned_long_long))) {
+	if (!try_create_integer(literal, literal->base.type, lexed)
+	 && (sign < 0 || !try_create_integer(literal, type_unsigned_int, lexed))
+	 && (sign > 0 || !try_create_integer(literal, type_long, lexed))
+	 && (sign < 0 || !try_create_integer(literal, type_unsigned_long, lexed))
+	 && (sign > 0 || !try_create_integer(literal, type_long_long, lexed))
+	 && (sign < 0 || !try_create_integer(literal, type_unsigned_long_long, lexed))) {
 		char const *const signedness = sign < 0 ? "signed" : "unsigned";
 		errorf(&literal->base.pos,
 		     "integer constant '%E' is larger than the largest %s integer type",
@@ -5749,7 +6015,8 @@ static void determine_literal_type(literal_expression_t *const literal)
 }
 
 static void check_number_suffix(expression_t *const expr,
-                                char const *const suffix, bool const is_float)
+                                char const *const suffix, bool const is_float,
+                                literal_t const *const lexed)
 {
 	unsigned spec = SPECIFIER_NONE;
 	for (char const *c = suffix; *c != '\0'; ++c) {
@@ -5827,12 +6094,22 @@ error:
 		/* Integer type depends on the size of the number and the size
 		 * representable by the types. The backend/codegeneration has to
 		 * determine that. */
-		determine_literal_type(&expr->literal);
+		determine_literal_type(&expr->literal, lexed);
 }
 
 static expression_t *parse_number_literal(void)
 {
-	string_t const *const str      = token.literal.string;
+	string_t const *const str = token.literal.string;
+	if (token.literal.has_value) {
+		/* The lexer already checked the digits and computed the value. */
+		expression_t *const expr = allocate_expression_zero(EXPR_LITERAL_INTEGER);
+		expr->literal.value  = str;
+		expr->literal.suffix = str->begin + token.literal.suffix_offset;
+		check_number_suffix(expr, expr->literal.suffix, false, &token.literal);
+		eat(T_NUMBER);
+		return expr;
+	}
+
 	char     const *      i        = str->begin;
 	unsigned              digits   = 0;
 	bool                  is_float = false;
@@ -5943,7 +6220,7 @@ done:;
 			errorf(HERE, "invalid digit in %K", &token);
 		} else {
 			expr->literal.suffix = i;
-			check_number_suffix(expr, i, is_float);
+			check_number_suffix(expr, i, is_float, &token.literal);
 		}
 	}
 
@@ -5951,6 +6228,28 @@ done:;
 	return expr;
 }
 
+/**
+ * Parses an #embed, which is not the initializer of an integer array, as the
+ * comma separated list of its bytes: The first byte is parsed as a number and
+ * the tokens of the others are inserted before the following token.
+ */
+static expression_t *parse_embed_expression(void)
+{
+	embed_t const embed = token.embed;
+	embed_expansion = embed;
+	if (embed.size > 1) {
+		/* with a single token of lookahead only the next token is pending */
+		assert(MAX_LOOKAHEAD == 1);
+		embed_expansion_pos                = 1;
+		embed_expansion_comma              = true;
+		embed_expansion_next               = *look_ahead(1);
+		embed_expanding                    = true;
+		lookahead_buffer[lookahead_bufpos] = next_embed_token();
+	}
+	token = make_embed_byte_token(embed.data[0]);
+	return parse_number_literal();
+}
+
 /**
  * Parse a character constant.
  */
@@ -6813,6 +7112,10 @@ static expression_t *parse_primary_expression(void)
 		errorf(&pos, "encountered type '%T' while parsing expression", type);
 		return create_error_expression();
 	}
+
+	case T_EMBED:
+		return parse_embed_expression();
+
 	default:
 		break;
 	}
@@ -7141,6 +7444,61 @@ static void handle_builtin_argument_restrictions(call_expression_t *const call,
 			       "second argument of '%Y' must be a constant expression",
 			       call->function->reference.entity->base.symbol);
 		break;
+
+	case BUILTIN_ASSUME_ALIGNED: {
+		if (call->arguments == NULL)
+			break;
+
+		call_argument_t const *const arg = call->arguments->next;
+		if (arg == NULL || (arg->next != NULL && arg->next->next != NULL)) {
+			errorf(&call->base.pos, "'%Y' expects two or three arguments",
+			       call->function->reference.entity->base.symbol);
+			break;
+		}
+		expression_t *const alignment = arg->expression;
+		if (is_constant_expression(alignment) == EXPR_CLASS_VARIABLE) {
+			errorf(&call->base.pos,
+			       "second argument of '%Y' must be a constant expression",
+			       call->function->reference.entity->base.symbol);
+		} else if (fold_expression_to_int(alignment) <= 0
+		        || !is_po2(fold_expression_to_int(alignment))) {
+			errorf(&call->base.pos,
+			       "second argument of '%Y' must be a power of 2",
+			       call->function->reference.entity->base.symbol);
+		}
+		break;
+	}
+
+	case BUILTIN_ATOMIC_COMPARE_EXCHANGE:
+	case BUILTIN_ATOMIC_EXCHANGE:
+	case BUILTIN_ATOMIC_FETCH_OP:
+	case BUILTIN_ATOMIC_LOAD:
+	case BUILTIN_ATOMIC_OP_FETCH:
+	case BUILTIN_ATOMIC_STORE:
+	case BUILTIN_SYNC_BOOL_COMPARE_SWAP: {
+		if (call->arguments == NULL)
+			break;
+
+		/* only values fitting a compare-and-swap can be accessed atomically */
+		type_t *const ptr_type = skip_typeref(call->arguments->expression->base.type);
+		if (!is_type_pointer(ptr_type))
+			break;
+		type_t *const type = skip_typeref(ptr_type->pointer.points_to);
+		if (!is_type_valid(type))
+			break;
+		builtin_kind_t const kind = entity->function.btk;
+		if (kind == BUILTIN_ATOMIC_FETCH_OP || kind == BUILTIN_ATOMIC_OP_FETCH) {
+			if (!is_type_integer(type))
+				errorf(&call->base.pos,
+				       "first argument of '%Y' must be a pointer to an integer type",
+				       call->function->reference.entity->base.symbol);
+		} else if (!is_type_integer(type) && !is_type_pointer(type)) {
+			errorf(&call->base.pos,
+			       "first argument of '%Y' must be a pointer to an integer or pointer type",
+			       call->function->reference.entity->base.symbol);
+		}
+		break;
+	}
 	default:
 		break;
 	}
@@ -11048,8 +11406,9 @@ void start_parsing(void)
 	environment_stack = NEW_ARR_F(stack_entry_t, 0);
 	label_stack       = NEW_ARR_F(stack_entry_t, 0);
 	alias_entities    = NEW_ARR_F(entity_t*, 0);
+	builtin_entities  = NEW_ARR_F(entity_t*, 0);
 
-	print_to_file(stderr);
+	print_to_file(get_diagnostic_output());
 
 	assert(unit == NULL);
 	unit = allocate_ast_zero(sizeof(unit[0]));
@@ -11060,10 +11419,6 @@ void start_parsing(void)
 	assert(current_scope == NULL);
 	scope_push(&unit->scope);
 
-	create_gnu_builtins();
-	if (dialect.ms)
-		create_microsoft_intrinsics();
-
 	symbol_main = symbol_table_insert("main");
 }
 
@@ -11082,6 +11437,13 @@ translation_unit_t *finish_parsing(void)
 	check_unused_globals();
 	file_scope = NULL;
 
+	/* builtins are not on the environment stack, unlink them explicitly */
+	for (size_t i = 0, n = ARR_LEN(builtin_entities); i != n; ++i) {
+		unlink_entity(builtin_entities[i]);
+	}
+	DEL_ARR_F(builtin_entities);
+	builtin_entities = NULL;
+
 	DEL_ARR_F(environment_stack);
 	DEL_ARR_F(label_stack);
 
@@ -11155,6 +11517,7 @@ static void prepare_main_collect2(entity_t *const entity)
 void parse(void)
 {
 	lookahead_bufpos = 0;
+	embed_expanding  = false;
 	for (int i = 0; i < MAX_LOOKAHEAD + 2; ++i) {
 		next_token();
 	}
@@ -11169,6 +11532,8 @@ void parse(void)
 void init_parser(void)
 {
 	memset(token_anchor_set, 0, sizeof(token_anchor_set));
+	default_visibility = ELF_VISIBILITY_DEFAULT;
+	support_exceptions = false;
 
 	init_expression_parsers();
 	obstack_init(&temp_obst);
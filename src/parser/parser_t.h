@@ -18,6 +18,11 @@ entity_t *record_entity(entity_t *entity, bool is_definition);
  */
 void merge_into_decl(entity_t *decl, const entity_t *other);
 
+/**
+ * Make a builtin, which was created on demand, visible in the file scope.
+ */
+void record_builtin(entity_t *entity);
+
 /**
  * Search an entity by its symbol in a given namespace.
  */
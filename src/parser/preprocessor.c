@@ -11,9 +11,14 @@
 #include <libfirm/firm_common.h>
 #include <libfirm/irmode.h>
 #include <libfirm/tv.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <string.h>
 #include <time.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "adt/array.h"
 #include "adt/panic.h"
@@ -23,6 +28,7 @@
 #include "adt/unicode.h"
 #include "adt/util.h"
 #include "ast/ast_t.h"
+#include "ast/attribute.h"
 #include "ast/dialect.h"
 #include "ast/string_hash.h"
 #include "ast/string_rep.h"
@@ -31,6 +37,7 @@
 #include "driver/diagnostic.h"
 #include "driver/c_driver.h"
 #include "input.h"
+#include "vfs_pack.h"
 
 #define MAX_PUTBACK   3
 #define BUFSIZE       1024
@@ -132,6 +139,13 @@ typedef struct macro_call_t {
 	bool             previous_may_recurse  : 1;
 } macro_call_t;
 
+/** A resource loaded by #embed, kept alive until the preprocessor exits. */
+typedef struct embed_resource_t {
+	void   *data;
+	size_t  size;
+	bool    mapped;
+} embed_resource_t;
+
 typedef struct include_t include_t;
 struct include_t {
 	include_t  *next;
@@ -173,6 +187,22 @@ static pset_new_t            includeset;
 static include_t            *includes;
 static include_t            *last_include;
 
+static embed_resource_t     *embed_resources;
+/** pseudo definition used to emit the tokens produced by an #embed */
+static pp_definition_t       embed_definition;
+static token_t              *embed_tokens;
+
+/** A file read from memory instead of the filesystem. */
+typedef struct virtual_file_t {
+	char const *name;
+	char const *data;
+	size_t      size;
+	char const *pack; /**< pack file containing the file or NULL */
+} virtual_file_t;
+
+static virtual_file_t       *virtual_files;
+bool                         virtual_files_only;
+
 struct searchpath_t {
 	searchpath_entry_t  *first;
 	searchpath_entry_t **anchor;
@@ -215,6 +245,28 @@ static void init_symbols(void)
 
 static void print_line_directive(const position_t *pos, const char *add);
 
+/**
+ * Record a file for dependency output. Assume filename is identified in the
+ * string hash.
+ */
+static void add_dependency(char const *const filename,
+                           bool const is_system_header)
+{
+	bool new_dep = pset_new_insert(&includeset, (void*)filename);
+	if (new_dep) {
+		include_t *include = OALLOC(&pp_obstack, include_t);
+		include->next             = NULL;
+		include->filename         = filename;
+		include->is_system_header = is_system_header;
+		if (last_include != NULL) {
+			last_include->next = include;
+		} else {
+			includes = include;
+		}
+		last_include = include;
+	}
+}
+
 /**
  * Switch input to another file/stream. Assume input_name is identified in the
  * string hash.
@@ -256,35 +308,100 @@ static void switch_input(input_t *const decoder, char const *const input_name,
 	input.pos.lineno = 0;
 	input.c          = '\n';
 
-	/* track include (for dependency output) */
-	if (input_name != builtin_position.input_name) {
-		bool new_dep = pset_new_insert(&includeset, (void*)input_name);
-		if (new_dep) {
-			include_t *include = OALLOC(&pp_obstack, include_t);
-			include->next             = NULL;
-			include->filename         = input_name;
-			include->is_system_header = is_system_header;
-			if (last_include != NULL) {
-				last_include->next = include;
-			} else {
-				includes = include;
-			}
-			last_include = include;
+}
+
+/** Returns @p name identified in the string hash. */
+static char const *identify_filename(char const *const name)
+{
+	begin_string_construction();
+	obstack_grow(&string_obst, name, strlen(name));
+	return finish_string_construction(STRING_ENCODING_CHAR)->begin;
+}
+
+/**
+ * Records the file @p filename, from which a header or resource was read,
+ * for the dependency output.
+ */
+static void track_file(char const *const filename, bool const is_system_header)
+{
+	add_dependency(identify_filename(filename), is_system_header);
+}
+
+/**
+ * Records the pack file containing a virtual file for the dependency output,
+ * as its name does not exist on disk. Files in memory are not recorded.
+ */
+static void track_virtual_file(virtual_file_t const *const file)
+{
+	/* the pack is not a system header even if the first file read from it
+	 * is, so dependency output without system headers still has it */
+	if (file->pack != NULL)
+		track_file(file->pack, false);
+}
+
+static void switch_to_input(input_t *const input, char const *const input_name, searchpath_entry_t *const path, bool const is_system_header)
+{
+	switch_input(input, identify_filename(input_name), path, is_system_header);
+}
+
+void switch_pp_input(FILE *const stream, char const *const input_name, searchpath_entry_t *const path, bool const is_system_header)
+{
+	switch_to_input(input_from_stream(stream, input_decoder), input_name, path,
+	                is_system_header);
+	track_file(input_name, is_system_header);
+}
+
+void add_virtual_file(char const *const name, char const *const data,
+                      size_t const size)
+{
+	virtual_file_t const file = { name, data, size, NULL };
+	ARR_APP1(virtual_file_t, virtual_files, file);
+}
+
+/**
+ * Looks up @p name in the virtual files and then in the pack files, which
+ * both take precedence over the filesystem.
+ */
+static bool find_virtual_file(char const *const name,
+                              virtual_file_t *const file)
+{
+	for (size_t i = 0, n = ARR_LEN(virtual_files); i != n; ++i) {
+		if (streq(virtual_files[i].name, name)) {
+			*file = virtual_files[i];
+			return true;
 		}
 	}
+	file->name = name;
+	return vfs_pack_find(name, &file->data, &file->size, &file->pack);
 }
 
-void switch_pp_input(FILE *const stream, char const *const input_name, searchpath_entry_t *const path, bool const is_system_header)
+/**
+ * Returns whether a file, which is a system header if @p is_system_header,
+ * may be read from the filesystem. Sets errno if not.
+ */
+static bool may_open_file(bool const is_system_header)
 {
-	input_t *const input = input_from_stream(stream, input_decoder);
-	begin_string_construction();
-	obstack_grow(&string_obst, input_name, strlen(input_name));
-	const string_t *string = finish_string_construction(STRING_ENCODING_CHAR);
-	switch_input(input, string->begin, path, is_system_header);
+	if (virtual_files_only && !is_system_header) {
+		errno = ENOENT;
+		return false;
+	}
+	return true;
 }
 
 static bool try_switch_input(char const* const name, searchpath_entry_t *const path, bool const is_system_header)
 {
+	virtual_file_t virtual_file;
+	if (find_virtual_file(name, &virtual_file)) {
+		input_t *const input = input_from_memory(virtual_file.data,
+		                                         virtual_file.size,
+		                                         input_decoder);
+		switch_to_input(input, name, path, is_system_header);
+		track_virtual_file(&virtual_file);
+		return true;
+	}
+	if (!may_open_file(is_system_header))
+		return false;
+
 	FILE *const file = fopen(name, "r");
 	if (!file)
 		return false;
@@ -301,9 +418,10 @@ void close_pp_input(void)
 static void close_pp_input_file(void)
 {
 	FILE* const file = input_get_file(input.input);
-	assert(file);
 	close_pp_input();
-	fclose(file);
+	/* virtual files have no FILE */
+	if (file != NULL)
+		fclose(file);
 }
 
 void print_pp_header(void)
@@ -1198,6 +1316,12 @@ static void grow_token(struct obstack *obst, const token_t *token)
 		grow_string_escaped(obst, token->literal.string, "'");
 		break;
 
+	case T_EMBED:
+		for (size_t i = 0; i != token->embed.size; ++i) {
+			obstack_printf(obst, i == 0 ? "%u" : ",%u", token->embed.data[i]);
+		}
+		break;
+
 	case T_IDENTIFIER:
 	default: {
 		const char *str = token->base.symbol->string;
@@ -1326,11 +1450,81 @@ dollar_sign:
 	return true;
 }
 
+/**
+ * Computes the value of an integer literal, so the parser does not have to
+ * parse the digits a second time. Floating point literals, malformed literals
+ * and values exceeding an unsigned long long are left to the parser.
+ */
+static void evaluate_number(literal_t *const literal)
+{
+	literal->has_value = false;
+
+	string_t const *const str = literal->string;
+	char     const *      i   = str->begin;
+	unsigned                base;
+	bool                    has_digits;
+	if (*i == '0') {
+		switch (*++i) {
+		case 'B': case 'b': base =  2; ++i; has_digits = false; break;
+		case 'X': case 'x': base = 16; ++i; has_digits = false; break;
+		default:            base =  8;      has_digits = true;  break;
+		}
+	} else {
+		base       = 10;
+		has_digits = false;
+	}
+
+	unsigned long long value = 0;
+	for (;; ++i) {
+		unsigned digit;
+		switch (*i) {
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			digit = *i - '0';
+			break;
+		case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+			digit = *i - 'A' + 10;
+			break;
+		case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
+			digit = *i - 'a' + 10;
+			break;
+		case '.':
+			return;
+		default:
+			goto suffix;
+		}
+
+		if (digit >= base) {
+			/* exponent of a decimal floating point literal */
+			if (digit >= 10)
+				goto suffix;
+			return;
+		}
+		if (value > (ULLONG_MAX - digit) / base)
+			return;
+		value      = value * base + digit;
+		has_digits = true;
+	}
+
+suffix:
+	/* Floating point literal or malformed. */
+	if (!has_digits || (base == 16 && (*i == 'P' || *i == 'p'))
+	 || ((base == 8 || base == 10) && (*i == 'E' || *i == 'e')))
+		return;
+	if ((size_t)(i - str->begin) > UINT_MAX)
+		return;
+
+	literal->has_value     = true;
+	literal->suffix_offset = i - str->begin;
+	literal->value         = value;
+}
+
 static void make_number(void)
 {
 	pp_token.literal.base.kind   = T_NUMBER;
 	pp_token.literal.base.symbol = NULL;
 	pp_token.literal.string = finish_string_construction(STRING_ENCODING_CHAR);
+	evaluate_number(&pp_token.literal);
 }
 
 static bool concat_number(const token_t *token0, const token_t *token1)
@@ -2000,8 +2194,7 @@ dollar_sign:
 	}
 
 end_number:
-	pp_token.kind           = T_NUMBER;
-	pp_token.literal.string = finish_string_construction(STRING_ENCODING_CHAR);
+	make_number();
 }
 
 #define MAYBE_PROLOG \
@@ -2439,6 +2632,12 @@ void emit_pp_token(void)
 		fputs(pp_token.literal.string->begin, out);
 		break;
 
+	case T_EMBED:
+		for (size_t i = 0; i != pp_token.embed.size; ++i) {
+			fprintf(out, i == 0 ? "%u" : ",%u", pp_token.embed.data[i]);
+		}
+		break;
+
 	case T_STRING_LITERAL:
 		fputs(get_string_encoding_prefix(pp_token.literal.string->encoding), out);
 		fputc('"', out);
@@ -2720,6 +2919,11 @@ static void update_definition_int(pp_definition_t *const definition,
 	obstack_printf(&string_obst, "%u", value);
 	string_t *string = finish_string_construction(STRING_ENCODING_CHAR);
 	update_definition_string_t(definition, string);
+
+	literal_t *const literal = &definition->token_list[0].literal;
+	literal->has_value     = true;
+	literal->suffix_offset = string->size;
+	literal->value         = value;
 }
 
 static void update_file(pp_definition_t *definition)
@@ -3182,15 +3386,23 @@ finish_headername:;
 	return headername;
 }
 
-static bool do_include(bool const bracket_include, bool const include_next,
-                       char const *const headername)
+typedef bool (*try_input_func)(char const *name, searchpath_entry_t *path,
+                               bool is_system_header);
+
+/**
+ * Look for @p headername in the include search paths and call @p try_input
+ * for each candidate until it succeeds.
+ */
+static bool find_include(bool const bracket_include, bool const include_next,
+                         char const *const headername,
+                         try_input_func const try_input)
 {
 	/* A file included from a system header is a system header, too. */
 	bool const is_system_header = input.pos.is_system_header;
 
 	/* is it an absolute path? */
 	if (headername[0] == '/')
-		return try_switch_input(headername, NULL, is_system_header);
+		return try_input(headername, NULL, is_system_header);
 
 	size_t const headername_size = strlen(headername) + 1;
 
@@ -3210,7 +3422,7 @@ static bool do_include(bool const bracket_include, bool const include_next,
 		obstack_grow(&symbol_obstack, headername, headername_size);
 
 		char *const name    = obstack_finish(&symbol_obstack);
-		bool  const success = try_switch_input(name, NULL, is_system_header);
+		bool  const success = try_input(name, NULL, is_system_header);
 		obstack_free(&symbol_obstack, name);
 		if (success)
 			return true;
@@ -3228,7 +3440,7 @@ static bool do_include(bool const bracket_include, bool const include_next,
 		obstack_grow(&symbol_obstack, headername, headername_size);
 
 		char *const name    = obstack_finish(&symbol_obstack);
-		bool  const success = try_switch_input(name, entry, entry->is_system_path);
+		bool  const success = try_input(name, entry, entry->is_system_path);
 		obstack_free(&symbol_obstack, name);
 		if (success)
 			return true;
@@ -3237,6 +3449,13 @@ static bool do_include(bool const bracket_include, bool const include_next,
 	return false;
 }
 
+static bool do_include(bool const bracket_include, bool const include_next,
+                       char const *const headername)
+{
+	return find_include(bracket_include, include_next, headername,
+	                    try_switch_input);
+}
+
 static void parse_include_directive(bool const include_next)
 {
 	if (skip_mode) {
@@ -3317,6 +3536,16 @@ static ir_tarval *pp_one;
 static void       next_condition_token(void);
 static bool       start_expanding(void);
 static ir_tarval *parse_pp_expression(precedence_t prec);
+static ir_tarval *parse_has_embed(void);
+
+/**
+ * Returns whether @p symbol is a macro for defined and #ifdef. __has_embed
+ * counts as one, so its availability can be tested.
+ */
+static bool is_defined(symbol_t const *const symbol)
+{
+	return symbol->pp_definition != NULL || symbol->pp_ID == TP___has_embed;
+}
 
 static ir_tarval *parse_pp_operand(void)
 {
@@ -3420,6 +3649,8 @@ error:
 		if (!is_identifierlike_token(&pp_token)) {
 			errorf(&pp_token.base.pos, "unexpected %K in preprocessor condition", &pp_token);
 			return tarval_bad;
+		} else if (pp_token.base.symbol->pp_ID == TP___has_embed) {
+			return parse_has_embed();
 		} else if (pp_token.base.symbol->pp_ID == TP_defined) {
 			// Prevent macro expansion after 'defined'.
 			bool has_paren = false;
@@ -3477,7 +3708,7 @@ read_input:
 next:;
 			ir_tarval *res;
 			if (is_identifierlike_token(&pp_token)) {
-				res = pp_token.base.symbol->pp_definition ? pp_one : pp_null;
+				res = is_defined(pp_token.base.symbol) ? pp_one : pp_null;
 				next_condition_token();
 			} else {
 				errorf(&pp_token.base.pos, "unexpected %K in preprocessor condition, expected identifier", &pp_token);
@@ -3698,7 +3929,7 @@ static void parse_ifdef_ifndef_directive(bool const is_ifdef)
 		condition = true;
 	} else {
 		/* evaluate whether we are in true or false case */
-		condition = (bool)pp_token.base.symbol->pp_definition == is_ifdef;
+		condition = is_defined(pp_token.base.symbol) == is_ifdef;
 		next_input_token();
 
 		expect_directive_end(WARN_ERROR, ctx);
@@ -3758,6 +3989,496 @@ typedef enum stdc_pragma_value_kind_t {
 	STDC_VALUE_DEFAULT
 } stdc_pragma_value_kind_t;
 
+static embed_resource_t embed_found;
+static size_t           embed_limit;
+
+/**
+ * Loads at most embed_limit bytes of the file @p name into embed_found.
+ * Regular files are mapped into memory instead of being copied.
+ */
+static bool load_embed_file(char const *const name)
+{
+	FILE *const file = fopen(name, "rb");
+	if (file == NULL)
+		return false;
+
+	embed_resource_t resource = { NULL, 0, false };
+#ifdef HAVE_MMAP
+	struct stat st;
+	if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode)
+	 && st.st_size > 0) {
+		size_t const size = MIN((size_t)st.st_size, embed_limit);
+		void  *const data = size > 0
+			? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(file), 0)
+			: MAP_FAILED;
+		if (data != MAP_FAILED)
+			resource = (embed_resource_t){ data, size, true };
+	}
+#endif
+	if (!resource.mapped) {
+		/* read the contents, this also works for pipes and devices */
+		unsigned char *data     = NULL;
+		size_t         size     = 0;
+		size_t         capacity = 0;
+		while (size < embed_limit) {
+			if (size == capacity) {
+				capacity = capacity == 0 ? 4096 : capacity * 2;
+				data     = XREALLOC(data, unsigned char, capacity);
+			}
+			size_t const n_want = MIN(capacity - size, embed_limit - size);
+			size_t const n_read = fread(data + size, 1, n_want, file);
+			if (n_read == 0)
+				break;
+			size += n_read;
+		}
+		resource = (embed_resource_t){ data, size, false };
+	}
+	fclose(file);
+
+	if (resource.data != NULL)
+		ARR_APP1(embed_resource_t, embed_resources, resource);
+	embed_found = resource;
+	return true;
+}
+
+/** Loads the resource @p name for #embed. */
+static bool try_embed_file(char const *const name,
+                           searchpath_entry_t *const path,
+                           bool const is_system_header)
+{
+	(void)path;
+	virtual_file_t virtual_file;
+	if (find_virtual_file(name, &virtual_file)) {
+		/* not recorded in embed_resources as the data is not ours */
+		embed_found = (embed_resource_t){
+			(void*)virtual_file.data, MIN(virtual_file.size, embed_limit),
+			false
+		};
+		track_virtual_file(&virtual_file);
+		return true;
+	}
+	if (!may_open_file(is_system_header) || !load_embed_file(name))
+		return false;
+	track_file(name, is_system_header);
+	return true;
+}
+
+/**
+ * Parses the balanced token list in parentheses following the parameter
+ * @p param of @p directive, the current token being the '('. The tokens are
+ * appended to @p tokens unless it is NULL.
+ */
+static bool parse_balanced_tokens(char const *const directive,
+                                  symbol_t const *const param,
+                                  token_t **const tokens)
+{
+	unsigned depth = 0;
+	for (;;) {
+		next_condition_token();
+		switch (pp_token.kind) {
+		case T_NEWLINE:
+		case T_EOF:
+			errorf(&pp_token.base.pos, "missing ')' after %s parameter '%Y'",
+			       directive, param);
+			return false;
+
+		case '(':
+			++depth;
+			break;
+
+		case ')':
+			if (depth == 0) {
+				next_condition_token();
+				return true;
+			}
+			--depth;
+			break;
+
+		default:
+			break;
+		}
+		if (tokens != NULL) {
+			/* the tokens are already macro expanded */
+			pp_token.base.expansion_forbidden = true;
+			ARR_APP1(token_t, *tokens, pp_token);
+		}
+	}
+}
+
+/**
+ * Parses the balanced token list argument of an #embed parameter.
+ */
+static bool parse_embed_tokens(char const *const directive,
+                               symbol_t const *const param,
+                               token_t **const tokens)
+{
+	next_condition_token();
+	if (pp_token.kind != '(') {
+		errorf(&pp_token.base.pos, "expected '(' after %s parameter '%Y'",
+		       directive, param);
+		return false;
+	}
+	return parse_balanced_tokens(directive, param, tokens);
+}
+
+/** The parameters of #embed and __has_embed. */
+typedef struct embed_parameters_t {
+	size_t   limit;
+	token_t *prefix;
+	token_t *suffix;
+	token_t *if_empty;
+} embed_parameters_t;
+
+static void init_embed_parameters(embed_parameters_t *const params)
+{
+	params->limit    = (size_t)-1;
+	params->prefix   = NEW_ARR_F(token_t, 0);
+	params->suffix   = NEW_ARR_F(token_t, 0);
+	params->if_empty = NEW_ARR_F(token_t, 0);
+}
+
+static void free_embed_parameters(embed_parameters_t *const params)
+{
+	DEL_ARR_F(params->if_empty);
+	DEL_ARR_F(params->suffix);
+	DEL_ARR_F(params->prefix);
+}
+
+/**
+ * Parses the parameters of #embed up to the end of the line or, if
+ * @p has_embed is set, the parameters of __has_embed up to the closing ')'.
+ * Unknown parameters are an error in #embed. In __has_embed they are skipped
+ * and clear @p supported.
+ */
+static bool parse_embed_parameters(embed_parameters_t *const params,
+                                   bool const has_embed, bool *const supported)
+{
+	char const *const directive = has_embed ? "__has_embed" : "#embed";
+	while (has_embed ? pp_token.kind != ')'
+	                 : pp_token.kind != T_NEWLINE && pp_token.kind != T_EOF) {
+		symbol_t const *const param = pp_token.base.symbol;
+		if (!is_identifierlike_token(&pp_token)) {
+			errorf(&pp_token.base.pos, "expected %s parameter, got %K",
+			       directive, &pp_token);
+			return false;
+		}
+
+		token_t **tokens;
+		switch (param->pp_ID) {
+		case TP_limit:
+		case TP___limit__: {
+			next_condition_token();
+			if (pp_token.kind != '(') {
+				errorf(&pp_token.base.pos,
+				       "expected '(' after %s parameter '%Y'", directive, param);
+				return false;
+			}
+			next_condition_token();
+			position_t const expr_pos = pp_token.base.pos;
+			ir_tarval *const value    = parse_pp_expression(PREC_BOTTOM);
+			if (pp_token.kind != ')') {
+				errorf(&pp_token.base.pos,
+				       "missing ')' after %s parameter '%Y'", directive, param);
+				return false;
+			}
+			if (tarval_is_negative(value)) {
+				errorf(&expr_pos, "%s limit must not be negative", directive);
+			} else if (tarval_is_long(value)) {
+				params->limit = (size_t)get_tarval_long(value);
+			}
+			next_condition_token();
+			continue;
+		}
+
+		case TP_prefix:
+		case TP___prefix__:
+			tokens = &params->prefix;
+			goto parse_tokens;
+
+		case TP_suffix:
+		case TP___suffix__:
+			tokens = &params->suffix;
+			goto parse_tokens;
+
+		case TP_if_empty:
+		case TP___if_empty__:
+			tokens = &params->if_empty;
+parse_tokens:
+			if (!parse_embed_tokens(directive, param, tokens))
+				return false;
+			continue;
+
+		default:
+			if (!has_embed) {
+				errorf(&pp_token.base.pos, "unsupported #embed parameter '%Y'",
+				       param);
+				return false;
+			}
+			*supported = false;
+			next_condition_token();
+			/* vendor parameters like gnu::name */
+			while (pp_token.kind == ':' || pp_token.kind == T_COLONCOLON) {
+				next_condition_token();
+				if (is_identifierlike_token(&pp_token))
+					next_condition_token();
+			}
+			if (pp_token.kind == '('
+			 && !parse_balanced_tokens(directive, param, NULL))
+				return false;
+			continue;
+		}
+	}
+	return true;
+}
+
+/**
+ * Parses an #embed directive. The resulting tokens are placed in
+ * embed_tokens. Returns true if there are tokens to emit.
+ */
+static bool parse_embed_directive(void)
+{
+	if (skip_mode) {
+exit_skip:
+		/* do not attempt to interpret headernames as tokens */
+		skip_till_newline(false);
+		eat_pp_directive();
+		return false;
+	}
+
+	position_t const pos = pp_token.base.pos;
+	/* do not eat the TP_embed, since it would already parse the next token
+	 * which needs special handling here. */
+	skip_till_newline(true);
+	bool              system_include;
+	char const *const headername = parse_headername(&system_include);
+	if (headername == NULL)
+		goto exit_skip;
+
+	bool res = false;
+	embed_parameters_t params;
+	init_embed_parameters(&params);
+
+	bool const old_resolve_escape_sequences = resolve_escape_sequences;
+	resolve_escape_sequences = true;
+
+	next_condition_token();
+	if (!parse_embed_parameters(&params, false, NULL))
+		goto error;
+
+	embed_limit = params.limit;
+	if (!find_include(system_include, false, headername, try_embed_file)) {
+		char const ldelim = system_include ? '<' : '"';
+		char const rdelim = system_include ? '>' : '"';
+		errorf(&pos, "failed embedding %c%s%c: %s", ldelim, headername, rdelim,
+		       strerror(errno));
+		goto end;
+	}
+
+	ARR_SHRINKLEN(embed_tokens, 0);
+	if (embed_found.size == 0) {
+		for (size_t i = 0, n = ARR_LEN(params.if_empty); i != n; ++i) {
+			ARR_APP1(token_t, embed_tokens, params.if_empty[i]);
+		}
+	} else {
+		for (size_t i = 0, n = ARR_LEN(params.prefix); i != n; ++i) {
+			ARR_APP1(token_t, embed_tokens, params.prefix[i]);
+		}
+		token_t const embed = {
+			.embed = {
+				.base = { .kind = T_EMBED, .pos = pos },
+				.data = embed_found.data,
+				.size = embed_found.size,
+			}
+		};
+		ARR_APP1(token_t, embed_tokens, embed);
+		for (size_t i = 0, n = ARR_LEN(params.suffix); i != n; ++i) {
+			ARR_APP1(token_t, embed_tokens, params.suffix[i]);
+		}
+	}
+	res = ARR_LEN(embed_tokens) > 0;
+	goto end;
+
+error:
+	eat_pp_directive();
+end:
+	resolve_escape_sequences = old_resolve_escape_sequences;
+	free_embed_parameters(&params);
+	return res;
+}
+
+/**
+ * Parses the resource name of __has_embed from the (macro expanded) tokens
+ * of a preprocessor condition. The name is placed on the symbol obstack.
+ */
+static char const *parse_condition_headername(bool *const system_include)
+{
+	assert(obstack_object_size(&symbol_obstack) == 0);
+	if (pp_token.kind == T_STRING_LITERAL) {
+		*system_include = false;
+		string_t const *const string = pp_token.literal.string;
+		obstack_grow(&symbol_obstack, string->begin, string->size);
+	} else if (pp_token.kind == '<') {
+		*system_include = true;
+		for (bool first = true;; first = false) {
+			next_condition_token();
+			if (pp_token.kind == '>')
+				break;
+			if (pp_token.kind == T_NEWLINE || pp_token.kind == T_EOF) {
+				obstack_free(&symbol_obstack, obstack_finish(&symbol_obstack));
+				errorf(&pp_token.base.pos, "header name without closing '>'");
+				return NULL;
+			}
+			if (!first && pp_token.base.space_before)
+				obstack_1grow(&symbol_obstack, ' ');
+			grow_token(&symbol_obstack, &pp_token);
+		}
+	} else {
+		errorf(&pp_token.base.pos,
+		       "expected \"FILENAME\" or <FILENAME> after '__has_embed('");
+		return NULL;
+	}
+	next_condition_token();
+	return obstack_nul_finish(&symbol_obstack);
+}
+
+/**
+ * Evaluates __has_embed in a preprocessor condition to
+ * __STDC_EMBED_NOT_FOUND__ (0), __STDC_EMBED_FOUND__ (1) or
+ * __STDC_EMBED_EMPTY__ (2).
+ */
+static ir_tarval *parse_has_embed(void)
+{
+	next_condition_token();
+	if (pp_token.kind != '(') {
+		errorf(&pp_token.base.pos, "expected '(' after '__has_embed'");
+		return tarval_bad;
+	}
+	next_condition_token();
+	bool              system_include;
+	char const *const headername = parse_condition_headername(&system_include);
+	if (headername == NULL)
+		return tarval_bad;
+
+	ir_tarval         *res       = tarval_bad;
+	bool               supported = true;
+	embed_parameters_t params;
+	init_embed_parameters(&params);
+	if (parse_embed_parameters(&params, true, &supported)) {
+		next_condition_token();
+		long found = 0;
+		/* a single byte tells whether the resource is empty */
+		embed_limit = MIN(params.limit, 1);
+		if (supported
+		 && find_include(system_include, false, headername, try_embed_file))
+			found = embed_found.size != 0 ? 1 : 2;
+		res = new_tarval_from_long(found, mode_Ls);
+	}
+	free_embed_parameters(&params);
+	obstack_free(&symbol_obstack, (char*)headername);
+	return res;
+}
+
+/**
+ * Emits the tokens produced by an #embed directive, before continuing with
+ * the line following the directive.
+ */
+static void start_embed_expansion(void)
+{
+	embed_definition.list_len   = ARR_LEN(embed_tokens);
+	embed_definition.token_list = embed_tokens;
+
+	expansion_pos = embed_tokens[0].base.pos;
+	start_object_macro_expansion(&embed_definition);
+	expand_next();
+	/* the expansion must not be mistaken for a new directive */
+	info.at_line_begin = false;
+}
+
+unsigned         pragma_optimize_level;
+static unsigned *optimize_level_stack; /**< #pragma GCC push_options */
+
+/**
+ * Copies a GCC pragma to the preprocessed output. This keeps the optimization
+ * level when compiling the output and makes the pragma part of the key of the
+ * compilation cache.
+ */
+static void print_gcc_pragma(position_t const *const pos,
+                             char const *const name,
+                             string_t const *const argument)
+{
+	if (!out)
+		return;
+	fprintf(out, "\n#pragma GCC %s", name);
+	if (argument != NULL)
+		fprintf(out, "(\"%s\")", argument->begin);
+	fputc('\n', out);
+	/* continue with the line following the pragma */
+	position_t next = *pos;
+	++next.lineno;
+	print_line_directive(&next, NULL);
+}
+
+/**
+ * Handles the GCC pragmas controlling the optimization level of the following
+ * function definitions.
+ *
+ * @return false if the pragma is unknown
+ */
+static bool parse_gcc_pragma(void)
+{
+	if (pp_token.kind != T_IDENTIFIER)
+		return false;
+
+	position_t const pos = pp_token.base.pos;
+	switch (pp_token.base.symbol->pp_ID) {
+	case TP_optimize: {
+		next_input_token();
+		if (pp_token.kind == '(')
+			next_input_token();
+		if (pp_token.kind != T_STRING_LITERAL) {
+			errorf(&pp_token.base.pos, "expected string after #pragma GCC optimize");
+			return true;
+		}
+		string_t const *const string = pp_token.literal.string;
+		int             const level  = get_optimize_level(string->begin);
+		if (level < 0) {
+			warningf(WARN_UNKNOWN_PRAGMAS, &pp_token.base.pos,
+			         "unsupported optimization level '%S' ignored", string);
+		} else {
+			pragma_optimize_level = level + 1;
+			print_gcc_pragma(&pos, "optimize", string);
+		}
+		return true;
+	}
+
+	case TP_push_options:
+		ARR_APP1(unsigned, optimize_level_stack, pragma_optimize_level);
+		print_gcc_pragma(&pos, "push_options", NULL);
+		return true;
+
+	case TP_pop_options: {
+		size_t const n = ARR_LEN(optimize_level_stack);
+		if (n == 0) {
+			warningf(WARN_UNKNOWN_PRAGMAS, &pp_token.base.pos,
+			         "#pragma GCC pop_options without push_options");
+		} else {
+			pragma_optimize_level = optimize_level_stack[n - 1];
+			ARR_SHRINKLEN(optimize_level_stack, n - 1);
+			print_gcc_pragma(&pos, "pop_options", NULL);
+		}
+		return true;
+	}
+
+	case TP_reset_options:
+		pragma_optimize_level = 0;
+		print_gcc_pragma(&pos, "reset_options", NULL);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 static void parse_pragma_directive(void)
 {
 	eat_pp(TP_pragma);
@@ -3773,6 +4494,17 @@ static void parse_pragma_directive(void)
 		return;
 	}
 
+	if (pp_token.base.symbol->pp_ID == TP_GCC) {
+		next_input_token();
+		bool const known = parse_gcc_pragma();
+		eat_pp_directive();
+		if (!known) {
+			warningf(WARN_UNKNOWN_PRAGMAS, &pp_token.base.pos,
+			         "encountered unknown #pragma");
+		}
+		return;
+	}
+
 	stdc_pragma_kind_t kind = STDC_UNKNOWN;
 	if (pp_token.base.symbol->pp_ID == TP_STDC && dialect.c99) {
 		/* a STDC pragma */
@@ -3937,6 +4669,7 @@ static void parse_preprocessing_directive(void)
 	stop_at_newline = true;
 	eat_token('#');
 
+	bool embedded = false;
 	if (pp_token.kind == '\n') {
 		/* empty directive */
 	} else if (pp_token.base.symbol) {
@@ -3944,6 +4677,7 @@ static void parse_preprocessing_directive(void)
 		case TP_define:       parse_define_directive();            break;
 		case TP_elif:         parse_elif_directive();              break;
 		case TP_else:         parse_else_directive();              break;
+		case TP_embed:        embedded = parse_embed_directive();  break;
 		case TP_endif:        parse_endif_directive();             break;
 		case TP_error:        parse_diagnostic_directive(true);    break;
 		case TP_ident:        parse_ident_directive("#ident");     break;
@@ -3972,6 +4706,11 @@ skip:
 	pop_macro_call();
 
 	stop_at_newline = false;
+	if (embedded) {
+		/* the newline stays in the input and is read after the tokens */
+		start_embed_expansion();
+		return;
+	}
 	eat_token(T_NEWLINE);
 }
 
@@ -4259,8 +4998,28 @@ static void input_error(unsigned const delta_lines, unsigned const delta_cols, c
 	warningf(WARN_INVALID_BYTE_SEQUENCE, &pos, "%s", message);
 }
 
+static void init_searchpath(searchpath_t *const searchpath,
+                            bool const is_system_path)
+{
+	searchpath->first          = NULL;
+	searchpath->anchor         = &searchpath->first;
+	searchpath->is_system_path = is_system_path;
+}
+
 void init_preprocessor(void)
 {
+	init_searchpath(&bracket_searchpath, false);
+	init_searchpath(&quote_searchpath,   false);
+	init_searchpath(&system_searchpath,  true);
+	init_searchpath(&after_searchpath,   true);
+	input_decoder       = &input_decode_utf8;
+	no_dollar_in_symbol = false;
+	virtual_files       = NEW_ARR_F(virtual_file_t, 0);
+	virtual_files_only  = false;
+	init_vfs_packs();
+	pp_date             = NULL;
+	pp_time             = NULL;
+
 	init_string_hash();
 	init_symbol_table();
 	init_symbols();
@@ -4283,6 +5042,10 @@ void setup_preprocessor(void)
 	pset_new_init(&includeset);
 	includes = NULL;
 	last_include = NULL;
+	embed_resources = NEW_ARR_F(embed_resource_t, 0);
+	embed_tokens    = NEW_ARR_F(token_t, 0);
+	optimize_level_stack  = NEW_ARR_F(unsigned, 0);
+	pragma_optimize_level = 0;
 
 	setup_include_path();
 
@@ -4293,18 +5056,39 @@ void setup_preprocessor(void)
 	set_preprocessor_output(NULL);
 }
 
-void exit_preprocessor(void)
+/** Frees the state created by setup_preprocessor(). */
+static void exit_setup(void)
 {
-	if (macro_call_stack == NULL)
-		return;
 	pset_new_destroy(&includeset);
+	for (size_t i = 0, n = ARR_LEN(embed_resources); i != n; ++i) {
+		embed_resource_t *const resource = &embed_resources[i];
+#ifdef HAVE_MMAP
+		if (resource->mapped) {
+			munmap(resource->data, resource->size);
+			continue;
+		}
+#endif
+		free(resource->data);
+	}
+	DEL_ARR_F(embed_resources);
+	DEL_ARR_F(embed_tokens);
+	DEL_ARR_F(optimize_level_stack);
 	DEL_ARR_F(macro_call_stack);
 	DEL_ARR_F(argument_stack);
 	DEL_ARR_F(expansion_stack);
+	macro_call_stack = NULL;
 	obstack_free(&input_obstack, NULL);
+	exit_tokens();
+}
+
+void exit_preprocessor(void)
+{
+	if (macro_call_stack != NULL)
+		exit_setup();
+	DEL_ARR_F(virtual_files);
+	exit_vfs_packs();
 	obstack_free(&pp_obstack, NULL);
 	obstack_free(&config_obstack, NULL);
-	exit_tokens();
 	exit_symbol_table();
 	exit_string_hash();
 }
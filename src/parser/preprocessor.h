@@ -31,6 +31,17 @@ void switch_pp_input(FILE *stream, char const *input_name,
                      searchpath_entry_t *entry, bool is_system_header);
 void close_pp_input(void);
 
+/**
+ * Makes the preprocessor read @p size bytes at @p data when the file @p name
+ * is included, instead of looking at the filesystem. Names are compared
+ * literally with the paths the include search composes. The data must stay
+ * valid until exit_preprocessor().
+ */
+void add_virtual_file(char const *name, char const *data, size_t size);
+
+/** Only read system headers from the filesystem, other files are virtual. */
+extern bool virtual_files_only;
+
 /** print the header displayed by gcc when writing preprocessing tokens */
 void print_pp_header(void);
 
@@ -58,6 +69,8 @@ string_t *make_string(char const *string);
 extern bool             no_dollar_in_symbol;
 extern token_t          pp_token;
 extern input_decoder_t *input_decoder;
+/** optimization level + 1 set by #pragma GCC optimize, 0 if unset */
+extern unsigned         pragma_optimize_level;
 
 void set_preprocessor_output(FILE *output);
 void emit_pp_token(void);
@@ -17,6 +17,7 @@ symbol_t *token_symbols[T_LAST_TOKEN];
 const position_t builtin_position = { "<built-in>", 0, 0, true };
 
 static token_kind_t last_id;
+static bool         tokens_initialized;
 
 static symbol_t *intern_register_token(token_kind_t id, const char *string)
 {
@@ -50,7 +51,6 @@ static void register_pp_token(pp_token_kind_t const id, char const *const string
 
 void init_tokens(void)
 {
-	static bool tokens_initialized = false;
 	if (tokens_initialized)
 		return;
 	tokens_initialized = true;
@@ -68,6 +68,9 @@ void init_tokens(void)
 
 void exit_tokens(void)
 {
+	/* the symbols die with the symbol table */
+	tokens_initialized = false;
+	last_id            = 0;
 }
 
 void print_token_kind(FILE *f, token_kind_t token_kind)
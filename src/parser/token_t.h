@@ -34,6 +34,7 @@ extern symbol_t *token_symbols[];
 typedef struct token_base_t      token_base_t;
 typedef struct literal_t         literal_t;
 typedef struct macro_parameter_t macro_parameter_t;
+typedef struct embed_t           embed_t;
 typedef union  token_t           token_t;
 
 struct token_base_t {
@@ -48,8 +49,13 @@ struct token_base_t {
 };
 
 struct literal_t {
-	token_base_t base;
-	string_t    *string;
+	token_base_t       base;
+	string_t          *string;
+	/** T_NUMBER only: the lexer already computed the value of an integer
+	 * literal, which fits into an unsigned long long. */
+	bool               has_value;
+	unsigned           suffix_offset; /**< Start of the suffix in string. */
+	unsigned long long value;
 };
 
 struct macro_parameter_t {
@@ -57,11 +63,19 @@ struct macro_parameter_t {
 	pp_definition_t *def;
 };
 
+/** T_EMBED: the contents of a resource included by #embed */
+struct embed_t {
+	token_base_t         base;
+	unsigned char const *data;
+	size_t               size;
+};
+
 union token_t {
 	ENUMBF(token_kind_t) kind : 16;
 	token_base_t      base;
 	literal_t         literal;
 	macro_parameter_t macro_parameter;
+	embed_t           embed;
 };
 
 char const *get_string_encoding_prefix(string_encoding_t);
@@ -6,26 +6,41 @@ T(CX_LIMITED_RANGE)
 T(DEFAULT)
 T(FENV_ACCESS)
 T(FP_CONTRACT)
+T(GCC)
 T(L)
 T(OFF)
 T(ON)
 T(STDC)
 T(U)
+T(__has_embed)
+T(__if_empty__)
+T(__limit__)
+T(__prefix__)
+T(__suffix__)
 T(define)
 T(defined)
 T(elif)
 T(else)  /* remember that this gives T_else, not T_IDENTIFIER like most others */
+T(embed)
 T(endif)
 T(error)
 T(ident)
 T(if)    /* remember that this gives T_if */
 T(ifdef)
+T(if_empty)
 T(ifndef)
 T(include)
 T(include_next)
+T(limit)
 T(line)
+T(optimize)
+T(pop_options)
 T(pragma)
+T(prefix)
+T(push_options)
+T(reset_options)
 T(sccs)
+T(suffix)
 T(u)
 T(u8)
 T(undef)
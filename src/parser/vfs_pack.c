@@ -0,0 +1,235 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+#include "driver/enable_posix.h"
+#include "vfs_pack.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "adt/array.h"
+#include "adt/util.h"
+#include "adt/xmalloc.h"
+#include "driver/diagnostic.h"
+
+#define VFS_PACK_MAGIC       "cpvfspk"
+#define VFS_PACK_VERSION     1
+#define VFS_PACK_HEADER_SIZE 16
+#define VFS_PACK_ENTRY_SIZE  24
+
+typedef struct vfs_pack_t {
+	char                *filename;
+	unsigned char const *data;
+	size_t               size;
+	bool                 mapped;
+	size_t               n_files;
+} vfs_pack_t;
+
+/** An entry of the index of a pack. */
+typedef struct vfs_entry_t {
+	char const *name;
+	size_t      name_size;
+	char const *data;
+	size_t      size;
+} vfs_entry_t;
+
+static vfs_pack_t *packs;
+
+static uint32_t read_u32(unsigned char const *const p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16
+	     | (uint32_t)p[3] << 24;
+}
+
+static uint64_t read_u64(unsigned char const *const p)
+{
+	return read_u32(p) | (uint64_t)read_u32(p + 4) << 32;
+}
+
+/** Returns whether the @p size bytes at @p offset lie within @p pack. */
+static bool in_pack(vfs_pack_t const *const pack, uint64_t const offset,
+                    uint64_t const size)
+{
+	return offset <= pack->size && size <= pack->size - offset;
+}
+
+/** Decodes the @p i-th index entry of @p pack, returns false if it points
+ * outside of the pack. */
+static bool get_entry(vfs_pack_t const *const pack, size_t const i,
+                      vfs_entry_t *const entry)
+{
+	unsigned char const *const p
+		= pack->data + VFS_PACK_HEADER_SIZE + i * VFS_PACK_ENTRY_SIZE;
+	uint32_t const name_offset = read_u32(p);
+	uint32_t const name_size   = read_u32(p + 4);
+	uint64_t const offset      = read_u64(p + 8);
+	uint64_t const size        = read_u64(p + 16);
+	if (!in_pack(pack, name_offset, name_size) || !in_pack(pack, offset, size))
+		return false;
+	entry->name      = (char const*)pack->data + name_offset;
+	entry->name_size = name_size;
+	entry->data      = (char const*)pack->data + offset;
+	entry->size      = size;
+	return true;
+}
+
+static int compare_names(char const *const a, size_t const a_size,
+                         char const *const b, size_t const b_size)
+{
+	int const res = memcmp(a, b, MIN(a_size, b_size));
+	if (res != 0)
+		return res;
+	return a_size < b_size ? -1 : a_size > b_size;
+}
+
+/** Checks the header and index of @p pack. */
+static bool check_pack(vfs_pack_t *const pack)
+{
+	if (pack->size < VFS_PACK_HEADER_SIZE
+	 || memcmp(pack->data, VFS_PACK_MAGIC, sizeof(VFS_PACK_MAGIC)) != 0
+	 || read_u32(pack->data + 8) != VFS_PACK_VERSION)
+		return false;
+	uint32_t const n_files = read_u32(pack->data + 12);
+	if (!in_pack(pack, VFS_PACK_HEADER_SIZE,
+	             (uint64_t)n_files * VFS_PACK_ENTRY_SIZE))
+		return false;
+	pack->n_files = n_files;
+
+	vfs_entry_t prev = { NULL, 0, NULL, 0 };
+	for (size_t i = 0; i != n_files; ++i) {
+		vfs_entry_t entry;
+		if (!get_entry(pack, i, &entry))
+			return false;
+		if (i > 0 && compare_names(prev.name, prev.name_size, entry.name,
+		                           entry.name_size) >= 0)
+			return false;
+		prev = entry;
+	}
+	return true;
+}
+
+/** Maps or reads the file @p filename into @p pack. */
+static bool read_pack(char const *const filename, vfs_pack_t *const pack)
+{
+	FILE *const file = fopen(filename, "rb");
+	if (file == NULL)
+		return false;
+
+#ifdef HAVE_MMAP
+	struct stat st;
+	if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode)
+	 && st.st_size > 0) {
+		void *const data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+		                        fileno(file), 0);
+		if (data != MAP_FAILED) {
+			*pack = (vfs_pack_t){ NULL, data, st.st_size, true, 0 };
+			fclose(file);
+			return true;
+		}
+	}
+#endif
+	/* read the contents, this also works for pipes */
+	unsigned char *data     = NULL;
+	size_t         size     = 0;
+	size_t         capacity = 0;
+	for (;;) {
+		if (size == capacity) {
+			capacity = capacity == 0 ? 4096 : capacity * 2;
+			data     = XREALLOC(data, unsigned char, capacity);
+		}
+		size_t const n_read = fread(data + size, 1, capacity - size, file);
+		if (n_read == 0)
+			break;
+		size += n_read;
+	}
+	bool const res = !ferror(file);
+	fclose(file);
+	*pack = (vfs_pack_t){ NULL, data, size, false, 0 };
+	return res;
+}
+
+static void free_pack(vfs_pack_t *const pack)
+{
+	free(pack->filename);
+#ifdef HAVE_MMAP
+	if (pack->mapped) {
+		munmap((void*)pack->data, pack->size);
+		return;
+	}
+#endif
+	free((void*)pack->data);
+}
+
+bool vfs_pack_load(char const *const filename)
+{
+	position_t const pos = { filename, 0, 0, 0 };
+	vfs_pack_t pack;
+	if (!read_pack(filename, &pack)) {
+		errorf(&pos, "could not read pack file: %s", strerror(errno));
+		return false;
+	}
+	if (!check_pack(&pack)) {
+		errorf(&pos, "malformed pack file");
+		free_pack(&pack);
+		return false;
+	}
+	pack.filename = xstrdup(filename);
+	ARR_APP1(vfs_pack_t, packs, pack);
+	return true;
+}
+
+bool vfs_packs_loaded(void)
+{
+	return ARR_LEN(packs) != 0;
+}
+
+bool vfs_pack_find(char const *const name, char const **const data,
+                   size_t *const size, char const **const pack_name)
+{
+	size_t const name_size = strlen(name);
+	for (size_t p = 0, n = ARR_LEN(packs); p != n; ++p) {
+		vfs_pack_t const *const pack = &packs[p];
+		/* the entries were checked when loading the pack */
+		size_t lower = 0;
+		size_t upper = pack->n_files;
+		while (lower < upper) {
+			size_t const middle = lower + (upper - lower) / 2;
+			vfs_entry_t  entry;
+			get_entry(pack, middle, &entry);
+			int const res = compare_names(name, name_size, entry.name,
+			                              entry.name_size);
+			if (res == 0) {
+				*data      = entry.data;
+				*size      = entry.size;
+				*pack_name = pack->filename;
+				return true;
+			} else if (res < 0) {
+				upper = middle;
+			} else {
+				lower = middle + 1;
+			}
+		}
+	}
+	return false;
+}
+
+void init_vfs_packs(void)
+{
+	packs = NEW_ARR_F(vfs_pack_t, 0);
+}
+
+void exit_vfs_packs(void)
+{
+	for (size_t i = 0, n = ARR_LEN(packs); i != n; ++i) {
+		free_pack(&packs[i]);
+	}
+	DEL_ARR_F(packs);
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/**
+ * @file
+ * @brief pack files holding the headers of a virtual file system
+ *
+ * A pack file starts with the magic "cpvfspk\0", the little endian 32 bit
+ * version (1) and number of files. The index follows with an entry per file
+ * holding the little endian 32 bit offset and length of its name and the
+ * 64 bit offset and size of its contents. Offsets count from the start of
+ * the pack file. The entries are sorted by name, comparing bytes as unsigned
+ * values, so files are found by binary search. Names are the paths the
+ * include search composes (like "gen/config.h" for -Igen) and are not NUL
+ * terminated.
+ */
+#ifndef VFS_PACK_H
+#define VFS_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Maps the pack file @p filename into memory. Reports an error and returns
+ * false if it cannot be read or is malformed. Files are looked up in the
+ * packs in the order they were loaded.
+ */
+bool vfs_pack_load(char const *filename);
+
+/**
+ * Looks up the file @p name in the loaded packs and stores its contents in
+ * @p data and @p size, which stay valid until exit_vfs_packs(), and the name
+ * of the pack file containing it in @p pack_name.
+ */
+bool vfs_pack_find(char const *name, char const **data, size_t *size,
+                   char const **pack_name);
+
+/** Returns whether any pack file has been loaded. */
+bool vfs_packs_loaded(void);
+
+void init_vfs_packs(void);
+void exit_vfs_packs(void);
+
+#endif
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Compares the time to import the binary and the text IR format. Every C
+# file given is exported in both formats, then each export is compiled
+# REPEAT times and the "Firm: IR import" timer of --time is summed up.
+set -eu
+
+CPARSER="${CPARSER:-cparser}"
+REPEAT="${REPEAT:-10}"
+TMPDIR="$(mktemp -d)"
+trap 'rm -rf "$TMPDIR"' EXIT
+
+import_time() {
+	i=0
+	total=0
+	while [ "$i" -lt "$REPEAT" ]; do
+		msec="$("$CPARSER" --time -S -o /dev/null "$1" 2>&1 \
+			| sed -n 's/.*Firm: IR import[^0-9]*\([0-9.]*\).*/\1/p')"
+		total="$(echo "$total + ${msec:-0}" | bc)"
+		i=$((i + 1))
+	done
+	echo "$total"
+}
+
+printf "%-32s %12s %12s\n" "input" "binary msec" "text msec"
+for input in "$@"; do
+	base="$TMPDIR/$(basename "$input" .c)"
+	"$CPARSER" --export-ir      -o "$base.bin.ir" "$input"
+	"$CPARSER" --export-ir-text -o "$base.txt.ir" "$input"
+	printf "%-32s %12s %12s\n" "$(basename "$input")" \
+		"$(import_time "$base.bin.ir")" "$(import_time "$base.txt.ir")"
+done
@@ -0,0 +1,39 @@
+#!/usr/bin/env python
+# Merges the block execution counts of several runs of a program compiled
+# with -fprofile-generate into one profile for -fprofile-use, like the
+# <input>.irprof files written for each input.
+# A profile is the magic "firmprof" followed by one 32 bit little endian
+# counter per basic block; the counters of all inputs are summed up.
+import struct
+import sys
+
+MAGIC = b"firmprof"
+COUNTER_MAX = 0xFFFFFFFF
+
+def read_profile(filename):
+    data = open(filename, "rb").read()
+    if data[:len(MAGIC)] != MAGIC or (len(data) - len(MAGIC)) % 4 != 0:
+        sys.stderr.write("%s: not a profile\n" % filename)
+        sys.exit(1)
+    n = (len(data) - len(MAGIC)) // 4
+    return struct.unpack("<%dI" % n, data[len(MAGIC):])
+
+if len(sys.argv) < 3:
+    sys.stderr.write("usage: %s OUTPUT INPUT...\n" % sys.argv[0])
+    sys.exit(1)
+
+merged = None
+for filename in sys.argv[2:]:
+    counts = read_profile(filename)
+    if merged is None:
+        merged = list(counts)
+    elif len(counts) != len(merged):
+        sys.stderr.write("%s: profile of a different program\n" % filename)
+        sys.exit(1)
+    else:
+        merged = [min(a + b, COUNTER_MAX) for a, b in zip(merged, counts)]
+
+out = open(sys.argv[1], "wb")
+out.write(MAGIC)
+out.write(struct.pack("<%dI" % len(merged), *merged))
+out.close()
@@ -0,0 +1,104 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/*
+ * Checks the lowering of the __atomic and __sync builtins and of operations
+ * on _Atomic objects. Several threads modify shared objects concurrently, so
+ * lost updates show up as wrong totals.
+ *
+ *   cparser -O2 -pthread test/atomic.c -o atomic && ./atomic
+ *
+ * exits with status 0 if all checks pass.
+ */
+#include <pthread.h>
+#include <stdio.h>
+
+#define N_THREADS    4
+#define N_ITERATIONS 100000
+
+static int            counter;
+static _Atomic int    atomic_counter;
+static _Atomic float  atomic_float;
+static _Atomic long   atomic_long;
+static unsigned       bits;
+static int            spinlock;
+static int            guarded;
+
+static void *worker(void *arg)
+{
+	(void)arg;
+	for (int i = 0; i != N_ITERATIONS; ++i) {
+		__atomic_fetch_add(&counter, 1, __ATOMIC_SEQ_CST);
+		++atomic_counter;
+		atomic_counter -= 2;
+		atomic_float   += 1.0f;
+		atomic_long++;
+		__atomic_fetch_or(&bits, 1u << (i % 32), __ATOMIC_RELAXED);
+
+		while (__sync_lock_test_and_set(&spinlock, 1) != 0) {
+		}
+		++guarded;
+		__sync_lock_release(&spinlock);
+	}
+	return NULL;
+}
+
+static int failed;
+
+static void check(char const *const what, long long const value,
+                  long long const expected)
+{
+	if (value != expected) {
+		fprintf(stderr, "%s: %lld, expected %lld\n", what, value, expected);
+		failed = 1;
+	}
+}
+
+static void check_single_threaded(void)
+{
+	int value = 5;
+	check("exchange",  __atomic_exchange_n(&value, 7, __ATOMIC_SEQ_CST), 5);
+	check("load",      __atomic_load_n(&value, __ATOMIC_ACQUIRE), 7);
+	__atomic_store_n(&value, 3, __ATOMIC_RELEASE);
+	check("store",     value, 3);
+	check("add_fetch", __atomic_add_fetch(&value, 2, __ATOMIC_SEQ_CST), 5);
+	check("fetch_sub", __atomic_fetch_sub(&value, 1, __ATOMIC_SEQ_CST), 5);
+	check("nand",      __atomic_nand_fetch(&value, 6, __ATOMIC_SEQ_CST), ~(4 & 6));
+
+	int expected = 0;
+	value = 1;
+	check("cmpxchg fail", __atomic_compare_exchange_n(&value, &expected, 2, 0,
+	      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST), 0);
+	check("cmpxchg expected", expected, 1);
+	check("cmpxchg success", __atomic_compare_exchange_n(&value, &expected, 2,
+	      0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST), 1);
+	check("cmpxchg value", value, 2);
+	check("sync cas", __sync_bool_compare_and_swap(&value, 2, 9), 1);
+	check("sync cas value", value, 9);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+int main(void)
+{
+	check_single_threaded();
+
+	pthread_t threads[N_THREADS];
+	for (int i = 0; i != N_THREADS; ++i) {
+		pthread_create(&threads[i], NULL, worker, NULL);
+	}
+	for (int i = 0; i != N_THREADS; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	long long const total = (long long)N_THREADS * N_ITERATIONS;
+	check("fetch_add",      counter,            total);
+	check("_Atomic int",    atomic_counter,     -total);
+	/* the sums are exact in float */
+	check("_Atomic float",  (long long)atomic_float, total);
+	check("_Atomic long",   atomic_long,        total);
+	check("fetch_or",       bits,               0xFFFFFFFFu);
+	check("spinlock",       guarded,            total);
+	return failed;
+}
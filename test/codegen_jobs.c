@@ -0,0 +1,98 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/*
+ * Checks merging the assembly of parallel code generation. Each process
+ * numbers the private labels of its functions (blocks, jump tables, float
+ * constants) from the same start, so the merged output must rename them,
+ * while global and static symbols, whose names look alike, must stay.
+ *
+ *   cparser -O2 -fcodegen-jobs=4 test/codegen_jobs.c -o codegen_jobs \
+ *     && ./codegen_jobs
+ *
+ * exits with status 0 if all checks pass.
+ */
+#include <stdio.h>
+
+/* symbols resembling private labels, which are visible to the linker */
+int    Lglobal = 1;
+int    L1      = 2;
+static int Lstatic = 3;
+
+#define SWITCH_FUNCTION(name, k) \
+	int name(int x) \
+	{ \
+		switch (x) { \
+		case 0:  return k + 10; \
+		case 1:  return k + 21; \
+		case 2:  return k + 32; \
+		case 3:  return k + 43; \
+		case 4:  return k + 54; \
+		case 5:  return k + 65; \
+		case 6:  return k + 76; \
+		case 7:  return k + 87; \
+		default: return k; \
+		} \
+	}
+
+#define FLOAT_FUNCTION(name, k) \
+	double name(double x) \
+	{ \
+		return x * (k + 0.25) + (k + 0.5); \
+	}
+
+SWITCH_FUNCTION(switch0, 0)
+SWITCH_FUNCTION(switch1, 100)
+SWITCH_FUNCTION(switch2, 200)
+SWITCH_FUNCTION(switch3, 300)
+SWITCH_FUNCTION(switch4, 400)
+SWITCH_FUNCTION(switch5, 500)
+SWITCH_FUNCTION(switch6, 600)
+SWITCH_FUNCTION(switch7, 700)
+
+FLOAT_FUNCTION(float0, 0)
+FLOAT_FUNCTION(float1, 1)
+FLOAT_FUNCTION(float2, 2)
+FLOAT_FUNCTION(float3, 3)
+FLOAT_FUNCTION(float4, 4)
+FLOAT_FUNCTION(float5, 5)
+FLOAT_FUNCTION(float6, 6)
+FLOAT_FUNCTION(float7, 7)
+
+typedef int    (*switch_func)(int);
+typedef double (*float_func)(double);
+
+static switch_func const switches[] = {
+	switch0, switch1, switch2, switch3, switch4, switch5, switch6, switch7
+};
+static float_func const floats[] = {
+	float0, float1, float2, float3, float4, float5, float6, float7
+};
+
+int main(void)
+{
+	int errors = 0;
+	for (int k = 0; k != 8; ++k) {
+		for (int x = 0; x != 9; ++x) {
+			int const expected = 100 * k + (x < 8 ? 11 * x + 10 : 0);
+			if (switches[k](x) != expected) {
+				printf("switch%d(%d) = %d, expected %d\n", k, x,
+				       switches[k](x), expected);
+				++errors;
+			}
+		}
+		double const expected = 2 * (k + 0.25) + (k + 0.5);
+		if (floats[k](2) != expected) {
+			printf("float%d(2) = %f, expected %f\n", k, floats[k](2),
+			       expected);
+			++errors;
+		}
+	}
+	if (Lglobal + L1 + Lstatic != 6) {
+		printf("symbols resembling labels were renamed\n");
+		++errors;
+	}
+	return errors != 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of cparser.
+ * Copyright (C) 2014 Matthias Braun <matze@braunis.de>
+ */
+
+/*
+ * Benchmarks loads removed because of restrict qualified parameters. The
+ * kernels only differ in the qualifiers: Without restrict, the stores to dst
+ * may modify *scale and *offset, so both are loaded again in every
+ * iteration; with restrict the loads are hoisted out of the loop.
+ *
+ *   cparser -O3 test/restrict.c -o restrict && ./restrict
+ *
+ * prints the time of both kernels and exits with status 0 if their results
+ * agree. cparser -O3 -S shows the loads left in the loops.
+ */
+#include <stdio.h>
+#include <time.h>
+
+#define N       4096
+#define REPEATS 20000
+
+static float src[N];
+static float dst_plain[N];
+static float dst_restrict[N];
+
+void scale_plain(float *dst, float const *src, float const *scale,
+                 float const *offset, int n)
+{
+	for (int i = 0; i < n; ++i)
+		dst[i] = src[i] * *scale + *offset;
+}
+
+void scale_restrict(float *restrict dst, float const *restrict src,
+                    float const *restrict scale,
+                    float const *restrict offset, int n)
+{
+	for (int i = 0; i < n; ++i)
+		dst[i] = src[i] * *scale + *offset;
+}
+
+static double measure(void (*kernel)(float*, float const*, float const*,
+                                     float const*, int),
+                      float *dst)
+{
+	float const   scale  = 1.5f;
+	float const   offset = 0.25f;
+	clock_t const start  = clock();
+	for (int r = 0; r != REPEATS; ++r)
+		kernel(dst, src, &scale, &offset, N);
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+	for (int i = 0; i != N; ++i)
+		src[i] = (float)i;
+
+	double const plain  = measure(scale_plain, dst_plain);
+	double const strict = measure(scale_restrict, dst_restrict);
+	printf("without restrict: %.3f s\n", plain);
+	printf("with restrict:    %.3f s\n", strict);
+
+	for (int i = 0; i != N; ++i) {
+		if (dst_plain[i] != dst_restrict[i]) {
+			printf("results differ at %d: %f != %f\n", i, dst_plain[i],
+			       dst_restrict[i]);
+			return 1;
+		}
+	}
+	return 0;
+}